@@ -26,8 +26,9 @@
 //
 //     * Managing updates to server data
 //
-//       The application is required to implement two delegates (`GGKServerDataGetter` and `GGKServerDataSetter`) for sharing data
-//       with the server. See standalone.cpp for an example of how this is done.
+//       The application either implements two delegates (`GGKServerDataGetter` and `GGKServerDataSetter`) for sharing data
+//       with the server, or passes null delegates and keeps its data in the server's built-in data store (see the
+//       `ggkDataStore...` methods.) See standalone.cpp for an example of how this is done.
 //
 //       In addition, the server provides a thread-safe queue for notifications of data updates to the server. Generally, the only
 //       methods an application will need to call are `ggkNofifyUpdatedCharacteristic` and `ggkNofifyUpdatedDescriptor`. The other
@@ -111,6 +112,55 @@ extern "C"
 	//   * Any other failure, as deemed by the delegate handler
 	typedef int (*GGKServerDataSetter)(const char *pName, const void *pData);
 
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// SERVER DATA STORE
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// Instead of providing a data getter and setter, an application may pass null delegates to `ggkStart()` and keep its data in
+	// the server's built-in data store. Values are looked up by integer keys rather than names, which makes reads considerably
+	// cheaper. These methods are thread-safe, and reads never block.
+
+	// Returns the key for a name (such as "battery/level"), adding it to the store if it isn't already there
+	//
+	// Returns the key (a non-negative value) on success or -1 on failure (the name is null or the store is full.)
+	int ggkDataStoreIntern(const char *pName);
+
+	// Stores a fixed-size value (such as an integer or a small struct) of up to 16 bytes
+	//
+	// Returns non-zero value on success or 0 on failure (the key is not valid, pData is null or the size is out of range.)
+	int ggkDataStoreSetValue(int key, const void *pData, int size);
+
+	// Retrieves a fixed-size value stored with `ggkDataStoreSetValue()` into `pData`
+	//
+	// Returns non-zero value on success or 0 on failure (the key is not valid, pData is null, or the value was not stored with the
+	// same size.)
+	int ggkDataStoreGetValue(int key, void *pData, int size);
+
+	// Stores a copy of a variable-size value (such as a blob)
+	//
+	// Returns non-zero value on success or 0 on failure (the key is not valid or pData is null.)
+	int ggkDataStoreSetBytes(int key, const void *pData, int size);
+
+	// Stores a copy of a null-terminated string
+	//
+	// Returns non-zero value on success or 0 on failure (the key is not valid or pString is null.)
+	int ggkDataStoreSetString(int key, const char *pString);
+
+	// Copies up to `bufferSize` bytes of a value stored with `ggkDataStoreSetBytes()` or `ggkDataStoreSetString()` into `pBuffer`
+	//
+	// Strings are not null-terminated in the buffer. Returns the full size of the value (which may be larger than `bufferSize`)
+	// or -1 on failure (the key is not valid or nothing has been stored.)
+	int ggkDataStoreGetBytes(int key, void *pBuffer, int bufferSize);
+
+	// Enables (non-zero) or disables (0) the shared-memory data plane, which is disabled by default
+	//
+	// When enabled, the data of each characteristic that is bound to the data store (see `bindData()` in Server.cpp) lives in a
+	// shared memory segment, where producers in other processes can publish it directly using include/GobbledegookShm.h. Reads
+	// and writes through the methods above keep working as before.
+	//
+	// This must be called before `ggkStart()`.
+	void ggkSetSharedDataPlane(int enabled);
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// SERVER DATA UPDATE MANAGEMENT
 	// -----------------------------------------------------------------------------------------------------------------------------
@@ -125,12 +175,43 @@ extern "C"
 	// Returns non-zero value on success or 0 on failure.
 	int ggkNofifyUpdatedDescriptor(const char *pObjectPath);
 
+	// Returns 1 if a central has subscribed to notifications (or indications) from the characteristic at the given object path,
+	// otherwise 0
+	//
+	// Updates to a notifying characteristic that nobody has subscribed to are skipped by the server without calling the data
+	// getter, so applications that produce data on a timer can use this to skip the work of producing it as well. When a central
+	// subscribes, the server brings it up to date with the characteristic's current value.
+	int ggkIsCharacteristicNotifying(const char *pObjectPath);
+
+	// Returns the number of notifications (or indications) the server has sent for the characteristic at the given object path,
+	// or 0 if there is no such characteristic
+	unsigned long long ggkGetNotificationCount(const char *pObjectPath);
+
 	// Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
 	// `ggkNofifyUpdatedCharacteristic()` instead.
 	//
+	// The queue is bounded. If it is full, the update is dropped and this method fails.
+	//
+	// The object path and interface name must belong to a characteristic or descriptor in the server's description. The server
+	// registers those when it starts; anything else is rejected.
+	//
 	// Returns non-zero value on success or 0 on failure.
 	int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName);
 
+	// Returns the update queue ID for the given object path and interface name
+	//
+	// Applications that push updates at high rates can retrieve the ID for each of their characteristics once, then use
+	// `ggkPushUpdateQueueById()` to skip the lookup of the object path and interface name on every update. As with
+	// `ggkPushUpdateQueue()`, the pair must belong to a characteristic or descriptor in the server's description.
+	//
+	// Returns the ID (a non-negative value) on success or -1 on failure.
+	int ggkUpdateQueueGetId(const char *pObjectPath, const char *pInterfaceName);
+
+	// Adds an update to the queue using an ID retrieved from `ggkUpdateQueueGetId()`
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkPushUpdateQueueById(int id);
+
 	// Get the next update from the back of the queue and returns the element in `element` as a string in the format:
 	//
 	//     "com/object/path|com.interface.name"
@@ -155,10 +236,174 @@ extern "C"
 	// Removes all entries from the queue
 	void ggkUpdateQueueClear();
 
+	// Sets the maximum number of queued updates the server will process in a single iteration of its main loop. Updates beyond
+	// this budget are processed on subsequent iterations, which keeps the server responsive to other events during a burst of
+	// updates.
+	//
+	// A value of 0 (or less) removes the limit. The default is 64.
+	void ggkUpdateQueueSetBatchBudget(int maxEntries);
+
+	// Returns the maximum number of queued updates the server will process in a single iteration of its main loop
+	int ggkUpdateQueueGetBatchBudget();
+
+	// Enables (non-zero) or disables (0) coalescing of pending updates
+	//
+	// With coalescing enabled, the queue holds at most one pending entry for each (object path, interface) pair. Pushing an update
+	// for data that already has a pending entry merges it into that entry rather than adding a new one. Since the server always
+	// reads the current value when it processes an entry, the result is the same, but with fewer notifications sent to BlueZ.
+	// Entries already in the queue when coalescing is enabled are left as they are.
+	//
+	// Coalescing is disabled by default.
+	void ggkUpdateQueueSetCoalescing(int enabled);
+
+	// Returns 1 if coalescing of pending updates is enabled, otherwise 0
+	int ggkUpdateQueueGetCoalescing();
+
+	// Counters describing how the server has been draining the update queue
+	//
+	// Batch counters describe the groups of entries taken from the queue in a single main loop iteration. Residency is the time
+	// an entry spent waiting in the queue before the server took it for processing. The merged count is the number of updates
+	// that were merged into an already-pending entry while coalescing was enabled. The dropped count is the number of updates that
+	// were discarded because the queue was full.
+	struct GGKUpdateQueueStats
+	{
+		unsigned long long batchCount;
+		unsigned long long entryCount;
+		unsigned long long lastBatchSize;
+		unsigned long long maxBatchSize;
+		unsigned long long totalResidencyMicroseconds;
+		unsigned long long maxResidencyMicroseconds;
+		unsigned long long mergedCount;
+		unsigned long long droppedCount;
+	};
+
+	// Retrieves the current update queue counters into `pStats`
+	//
+	// Returns non-zero value on success or 0 on failure (`pStats` is null.)
+	int ggkUpdateQueueGetStats(struct GGKUpdateQueueStats *pStats);
+
+	// Resets all update queue counters to zero
+	void ggkUpdateQueueResetStats();
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// CONNECTIONS
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// What the server knows about a central that has connected to it
+	//
+	// Entries outlive their connections, so counters accumulate across reconnections. Times are in milliseconds since the epoch
+	// (0 if it has not happened yet.) The disconnect reason is the Bluetooth Management API's reason code, or -1 if the central has
+	// not disconnected. Reads and writes are those made by the central. BlueZ doesn't tell us which centrals are subscribed to a
+	// characteristic, so notifications are counted per characteristic instead (see `ggkGetNotificationCount()`.)
+	struct GGKConnectionInfo
+	{
+		char address[18];
+		int addressType;
+		int controllerIndex;
+		int connected;
+		int disconnectReason;
+		unsigned int connectCount;
+		unsigned long long connectTimeMS;
+		unsigned long long disconnectTimeMS;
+		unsigned long long readCount;
+		unsigned long long writeCount;
+	};
+
+	// Returns the number of centrals the server is tracking, whether they are connected or not
+	//
+	// For the number of centrals currently connected, see `ggkGetActiveConnectionCount()`.
+	int ggkGetTrackedCentralCount();
+
+	// Copies up to `maxConnections` entries into `pConnections`, connected centrals first
+	//
+	// Returns the number of entries copied
+	int ggkGetConnections(struct GGKConnectionInfo *pConnections, int maxConnections);
+
+	// Retrieves the entry for the central with the given address (in the form "00:11:22:33:44:55") into `pConnection`
+	//
+	// Returns non-zero value on success or 0 on failure (the central is not known or a parameter is null.)
+	int ggkGetConnection(const char *pAddress, struct GGKConnectionInfo *pConnection);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// NOTIFICATION STREAMS
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// Counters describing a characteristic's high-rate stream event (see `GattCharacteristic::onStreamEvent()`)
+	//
+	// Latency is how late each firing was relative to its deadline; jitter is the change in latency from one firing to the next.
+	// The missed count is the number of deadlines that passed without a firing because the server was too busy to keep up. The
+	// skipped count is the number of firings that were skipped because nobody was subscribed to the characteristic.
+	struct GGKStreamStats
+	{
+		int rateHz;
+		unsigned long long fireCount;
+		unsigned long long skippedCount;
+		unsigned long long missedCount;
+		unsigned long long lastLatencyMicroseconds;
+		unsigned long long maxLatencyMicroseconds;
+		unsigned long long totalLatencyMicroseconds;
+		unsigned long long lastJitterMicroseconds;
+		unsigned long long maxJitterMicroseconds;
+		unsigned long long totalJitterMicroseconds;
+	};
+
+	// Retrieves the counters for the stream event on the characteristic at the given object path into `pStats`
+	//
+	// Returns non-zero value on success or 0 on failure (the characteristic has no running stream or a parameter is null.)
+	int ggkGetStreamStats(const char *pObjectPath, struct GGKStreamStats *pStats);
+
+	// Resets the counters for the stream event on the characteristic at the given object path
+	//
+	// Returns non-zero value on success or 0 on failure (the characteristic has no running stream or the path is null.)
+	int ggkResetStreamStats(const char *pObjectPath);
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// SERVER CONTROL
 	// -----------------------------------------------------------------------------------------------------------------------------
 
+	// Enables (non-zero) or disables (0) single-threaded HCI mode
+	//
+	// By default, events from the Bluetooth Management API's HCI socket are read on a dedicated thread. In single-threaded mode,
+	// the socket is watched by the server's main loop instead: events are processed inline and adapter commands complete through
+	// callbacks, saving a thread (and the handoffs between threads) on embedded targets where cores are scarce.
+	//
+	// This must be called before `ggkStart()`. Single-threaded mode is disabled by default.
+	//
+	// Returns non-zero value on success or 0 on failure (the HCI socket is already in use.)
+	int ggkSetSingleThreadedHci(int enabled);
+
+	// Returns 1 if single-threaded HCI mode is enabled, otherwise 0
+	int ggkGetSingleThreadedHci();
+
+	// A mask for `ggkSetAdapterMask()` that selects every adapter
+	#define GGK_ALL_ADAPTERS 0xffffffffu
+
+	// Selects the Bluetooth adapters that the server registers its GATT application with
+	//
+	// Bit N of `mask` selects the adapter with controller index N (BlueZ's "/org/bluez/hciN".) Each selected adapter is configured
+	// and serves the same GATT application, so connections can be spread across several adapters. Use GGK_ALL_ADAPTERS to serve
+	// every adapter present.
+	//
+	// A mask of 0 (the default) serves only the first adapter found. This must be called before `ggkStart()`.
+	void ggkSetAdapterMask(unsigned int mask);
+
+	// Returns the number of active connections on the adapter with controller index `controllerIndex`, or the total across all
+	// adapters if `controllerIndex` is negative
+	//
+	// Returns -1 if `controllerIndex` is too large to be a controller index
+	int ggkGetActiveConnectionCount(int controllerIndex);
+
+	// Sizes the worker pool that runs the handlers of characteristics marked with `offloadToPool()`
+	//
+	// `threadCount` is the number of worker threads and `queueDepth` is the maximum number of method calls that may wait for a
+	// worker; calls beyond that are refused with an error until the pool catches up. The defaults are 2 threads and a queue
+	// depth of 64. The pool's threads are only started if the server description uses `offloadToPool()`.
+	//
+	// This must be called before `ggkStart()`.
+	//
+	// Returns non-zero value on success or 0 on failure (a value is less than 1.)
+	int ggkSetWorkerPool(int threadCount, int queueDepth);
+
 	// Set the server state to 'EInitializing' and then immediately create a server thread and initiate the server's async
 	// processing on the server thread.
 	//
@@ -178,6 +423,9 @@ extern "C"
 	// Similarly, the pointer to data returned to the data getter should point to non-volatile memory so that the server can use it
 	// safely for an indefinite period of time.
 	//
+	// A null getter or setter is replaced by the server's built-in data store (see `ggkDataStoreIntern()` and
+	// friends.)
+	//
 	// serviceName: The name of our server (collectino of services)
 	//
 	//     !!!IMPORTANT!!!
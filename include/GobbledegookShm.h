@@ -0,0 +1,415 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The layout of the shared-memory data plane, and a small library for producers in other processes to publish values through it
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// An application that produces its data in a separate process (sensor acquisition, for example) can publish values directly to
+// the server through shared memory, without a hop through the process that called `ggkStart()`.
+//
+// The shared-memory data plane is enabled with `ggkSetSharedDataPlane()` before the server is started. The server then creates
+// a memory segment with one slot for each characteristic that is backed by the data store (see `bindData()` in Server.cpp),
+// named after its data (for example, "battery/level".) Values written to a slot are what clients read and what subscribers are
+// notified of.
+//
+// A producer attaches with `ggkShmAttach()`, which receives the segment and an eventfd from the server over a local socket. It
+// then looks up each slot by name once with `ggkShmFindSlot()`, and publishes values with `ggkShmPublish()`. Publishing copies
+// the value into the slot, marks the slot as changed and, if the server isn't already on its way, wakes it through the eventfd.
+// The server's main loop reads values straight out of the slots, both when a client reads a characteristic and when it notifies
+// subscribers.
+//
+// Each slot is guarded by a sequence lock: a writer makes the slot's sequence odd, copies the value in and makes it even again;
+// a reader copies the value out and tries again if the sequence was odd or changed while it was copying. Readers never block
+// writers. Writers to the same slot (the producer, or the server when a client writes to the characteristic) take turns. A
+// writer that dies in the middle of a write leaves the slot locked, so readers and writers give up after a number of retries
+// rather than wait forever. The server reads and writes slots from its main loop, so it gives up much sooner than producers do.
+//
+// The segment belongs to a single run of the server. The header's `alive` flag is set once the server is ready and cleared when
+// it stops, after which `ggkShmPublish()` fails. A producer that sees that should detach and attach again (once the server has
+// restarted) to get the new segment.
+//
+// Everything here is inline and written in C, so a producer only needs this file.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif //__cplusplus
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// LAYOUT
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// Identifies a segment, and the version of its layout
+	#define GGK_SHM_MAGIC 0x53474747u
+	#define GGK_SHM_VERSION 1
+
+	// The maximum number of slots in a segment
+	#define GGK_SHM_MAX_SLOTS 256
+
+	// The maximum length of a slot's name, including the null terminator
+	#define GGK_SHM_MAX_NAME 48
+
+	// The largest value a slot can hold (the largest value of a GATT attribute)
+	#define GGK_SHM_MAX_VALUE_SIZE 512
+
+	// The number of times a producer retries a locked slot before giving up
+	#define GGK_SHM_MAX_RETRIES 10000
+
+	// The number of times the server retries a locked slot before giving up
+	//
+	// This is much lower than a producer's budget since the server runs on its main loop. A write only takes as long as copying
+	// the value, so this is plenty unless the writer has died in the middle of one.
+	#define GGK_SHM_SERVER_MAX_RETRIES 64
+
+	// The server listens for producers on the abstract socket named by this prefix followed by the service name
+	#define GGK_SHM_SOCKET_PREFIX "gobbledegook-data."
+
+	// A single value
+	struct GGKShmSlot
+	{
+		// Sequence lock (odd while a write is in progress)
+		uint32_t sequence;
+
+		// The size of the value, in bytes
+		uint32_t size;
+
+		// The name of the data this slot holds (such as "battery/level")
+		char name[GGK_SHM_MAX_NAME];
+
+		uint8_t reserved[8];
+
+		uint8_t data[GGK_SHM_MAX_VALUE_SIZE];
+	};
+
+	// The start of a segment, which is followed immediately by `slotCount` slots
+	struct GGKShmHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+
+		// Equal to `sizeof(struct GGKShmSlot)`
+		uint32_t slotSize;
+
+		// Non-zero if the server has been woken and has not yet looked at the changed slots
+		uint32_t wakePending;
+
+		// Non-zero while the server is using this segment (cleared when it stops)
+		uint32_t alive;
+
+		uint32_t reserved[2];
+
+		// One bit for each slot that has changed since the server last looked
+		uint64_t changed[GGK_SHM_MAX_SLOTS / 64];
+	};
+
+	// Returns the first slot in a segment
+	static inline struct GGKShmSlot *ggkShmSlots(struct GGKShmHeader *pHeader)
+	{
+		return (struct GGKShmSlot *)(pHeader + 1);
+	}
+
+	// Returns the size (in bytes) of a segment with `slotCount` slots
+	static inline size_t ggkShmSegmentSize(uint32_t slotCount)
+	{
+		return sizeof(struct GGKShmHeader) + slotCount * sizeof(struct GGKShmSlot);
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// SLOT ACCESS
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// Copies `size` bytes from `pData` into a slot, retrying up to `maxRetries` times while another writer holds it
+	//
+	// Returns non-zero value on success or 0 on failure (the value is too large, or the slot stayed locked.)
+	static inline int ggkShmWrite(struct GGKShmSlot *pSlot, const void *pData, uint32_t size, int maxRetries)
+	{
+		if (size > GGK_SHM_MAX_VALUE_SIZE || (NULL == pData && 0 != size))
+		{
+			return 0;
+		}
+
+		// Take the write side of the sequence lock by making it odd
+		uint32_t sequence = __atomic_load_n(&pSlot->sequence, __ATOMIC_RELAXED);
+		int retries = 0;
+		for (;;)
+		{
+			if ((sequence & 1) == 0 &&
+				__atomic_compare_exchange_n(&pSlot->sequence, &sequence, sequence + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+
+			if (++retries > maxRetries)
+			{
+				return 0;
+			}
+
+			sched_yield();
+			sequence = __atomic_load_n(&pSlot->sequence, __ATOMIC_RELAXED);
+		}
+
+		// Readers must see the odd sequence before any of the new value
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		__atomic_store_n(&pSlot->size, size, __ATOMIC_RELAXED);
+		memcpy(pSlot->data, pData, size);
+
+		__atomic_store_n(&pSlot->sequence, sequence + 2, __ATOMIC_RELEASE);
+		return 1;
+	}
+
+	// Copies up to `bufferSize` bytes of a slot's value into `pBuffer`, retrying up to `maxRetries` times while a writer holds it
+	//
+	// Returns the full size of the value (which may be larger than `bufferSize`) or -1 on failure (the slot stayed locked.)
+	static inline int ggkShmRead(const struct GGKShmSlot *pSlot, void *pBuffer, uint32_t bufferSize, int maxRetries)
+	{
+		for (int retries = 0; retries <= maxRetries; ++retries)
+		{
+			uint32_t before = __atomic_load_n(&pSlot->sequence, __ATOMIC_ACQUIRE);
+			if ((before & 1) != 0)
+			{
+				sched_yield();
+				continue;
+			}
+
+			uint32_t size = __atomic_load_n(&pSlot->size, __ATOMIC_RELAXED);
+			if (size > GGK_SHM_MAX_VALUE_SIZE)
+			{
+				continue;
+			}
+
+			if (NULL != pBuffer)
+			{
+				memcpy(pBuffer, pSlot->data, size < bufferSize ? size : bufferSize);
+			}
+
+			// The copy only counts if no writer got in while we were making it
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&pSlot->sequence, __ATOMIC_RELAXED) == before)
+			{
+				return (int)size;
+			}
+		}
+
+		return -1;
+	}
+
+	// Marks a slot as changed and wakes the server through `eventFd`, unless it has already been woken
+	static inline void ggkShmSignal(struct GGKShmHeader *pHeader, int slot, int eventFd)
+	{
+		__atomic_fetch_or(&pHeader->changed[slot / 64], (uint64_t)1 << (slot % 64), __ATOMIC_RELEASE);
+
+		if (0 == __atomic_exchange_n(&pHeader->wakePending, 1, __ATOMIC_ACQ_REL))
+		{
+			uint64_t value = 1;
+			if (write(eventFd, &value, sizeof(value)) < 0)
+			{
+				// The eventfd only fails if its counter would overflow, in which case the server has plenty to wake it
+			}
+		}
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// PRODUCERS
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// A producer's connection to the server's shared-memory data plane
+	struct GGKShmProducer
+	{
+		struct GGKShmHeader *pHeader;
+		size_t mappedSize;
+		int memFd;
+		int eventFd;
+	};
+
+	// Detaches a producer from the server's shared-memory data plane
+	static inline void ggkShmDetach(struct GGKShmProducer *pProducer)
+	{
+		if (NULL != pProducer->pHeader)
+		{
+			munmap(pProducer->pHeader, pProducer->mappedSize);
+		}
+
+		if (pProducer->memFd >= 0) { close(pProducer->memFd); }
+		if (pProducer->eventFd >= 0) { close(pProducer->eventFd); }
+
+		pProducer->pHeader = NULL;
+		pProducer->mappedSize = 0;
+		pProducer->memFd = -1;
+		pProducer->eventFd = -1;
+	}
+
+	// Attaches a producer to the shared-memory data plane of the server started with the service name `pServiceName`
+	//
+	// The server must be running, with the shared-memory data plane enabled. When done, detach with `ggkShmDetach()`.
+	//
+	// Returns non-zero value on success or 0 on failure.
+	static inline int ggkShmAttach(const char *pServiceName, struct GGKShmProducer *pProducer)
+	{
+		pProducer->pHeader = NULL;
+		pProducer->mappedSize = 0;
+		pProducer->memFd = -1;
+		pProducer->eventFd = -1;
+
+		// Connect to the server's abstract socket
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		size_t nameLength = strlen(GGK_SHM_SOCKET_PREFIX) + strlen(pServiceName);
+		if (nameLength + 1 > sizeof(address.sun_path))
+		{
+			return 0;
+		}
+
+		memcpy(address.sun_path + 1, GGK_SHM_SOCKET_PREFIX, strlen(GGK_SHM_SOCKET_PREFIX));
+		memcpy(address.sun_path + 1 + strlen(GGK_SHM_SOCKET_PREFIX), pServiceName, strlen(pServiceName));
+
+		int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (sock < 0)
+		{
+			return 0;
+		}
+
+		if (connect(sock, (struct sockaddr *)&address, (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + nameLength)) < 0)
+		{
+			close(sock);
+			return 0;
+		}
+
+		// The server answers with the segment and its eventfd
+		char byte = 0;
+		struct iovec iov;
+		iov.iov_base = &byte;
+		iov.iov_len = 1;
+
+		union
+		{
+			struct cmsghdr align;
+			char buffer[CMSG_SPACE(2 * sizeof(int))];
+		} control;
+
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control.buffer;
+		message.msg_controllen = sizeof(control.buffer);
+
+		ssize_t received = recvmsg(sock, &message, MSG_CMSG_CLOEXEC);
+		close(sock);
+
+		struct cmsghdr *pControl = CMSG_FIRSTHDR(&message);
+		if (received != 1 || NULL == pControl || pControl->cmsg_level != SOL_SOCKET || pControl->cmsg_type != SCM_RIGHTS ||
+			pControl->cmsg_len != CMSG_LEN(2 * sizeof(int)))
+		{
+			return 0;
+		}
+
+		int fds[2];
+		memcpy(fds, CMSG_DATA(pControl), sizeof(fds));
+		pProducer->memFd = fds[0];
+		pProducer->eventFd = fds[1];
+
+		// Map the segment and make sure it's one we understand
+		struct stat info;
+		if (fstat(pProducer->memFd, &info) < 0 || (size_t)info.st_size < sizeof(struct GGKShmHeader))
+		{
+			ggkShmDetach(pProducer);
+			return 0;
+		}
+
+		void *pMapped = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, pProducer->memFd, 0);
+		if (MAP_FAILED == pMapped)
+		{
+			ggkShmDetach(pProducer);
+			return 0;
+		}
+
+		pProducer->pHeader = (struct GGKShmHeader *)pMapped;
+		pProducer->mappedSize = (size_t)info.st_size;
+
+		struct GGKShmHeader *pHeader = pProducer->pHeader;
+		if (pHeader->magic != GGK_SHM_MAGIC || pHeader->version != GGK_SHM_VERSION ||
+			pHeader->slotSize != sizeof(struct GGKShmSlot) || pHeader->slotCount > GGK_SHM_MAX_SLOTS ||
+			ggkShmSegmentSize(pHeader->slotCount) > pProducer->mappedSize)
+		{
+			ggkShmDetach(pProducer);
+			return 0;
+		}
+
+		return 1;
+	}
+
+	// Returns the index of the slot holding the data named `pName` (such as "battery/level"), or -1 if there isn't one
+	static inline int ggkShmFindSlot(const struct GGKShmProducer *pProducer, const char *pName)
+	{
+		struct GGKShmSlot *pSlots = ggkShmSlots(pProducer->pHeader);
+		for (uint32_t i = 0; i < pProducer->pHeader->slotCount; ++i)
+		{
+			if (strncmp(pSlots[i].name, pName, GGK_SHM_MAX_NAME) == 0)
+			{
+				return (int)i;
+			}
+		}
+
+		return -1;
+	}
+
+	// Returns non-zero if the server is still using the segment a producer is attached to
+	//
+	// Once this returns 0, the server has stopped and the producer should detach (and attach again when the server restarts.)
+	static inline int ggkShmIsAlive(const struct GGKShmProducer *pProducer)
+	{
+		return NULL != pProducer->pHeader && 0 != __atomic_load_n(&pProducer->pHeader->alive, __ATOMIC_ACQUIRE);
+	}
+
+	// Publishes a value of `size` bytes to a slot and lets the server know
+	//
+	// Returns non-zero value on success or 0 on failure (the server has stopped using the segment (see `ggkShmIsAlive()`), the
+	// slot is not valid, the value is too large, or the slot stayed locked.)
+	static inline int ggkShmPublish(struct GGKShmProducer *pProducer, int slot, const void *pData, int size)
+	{
+		if (!ggkShmIsAlive(pProducer) || slot < 0 || (uint32_t)slot >= pProducer->pHeader->slotCount || size < 0)
+		{
+			return 0;
+		}
+
+		if (!ggkShmWrite(&ggkShmSlots(pProducer->pHeader)[slot], pData, (uint32_t)size, GGK_SHM_MAX_RETRIES))
+		{
+			return 0;
+		}
+
+		ggkShmSignal(pProducer->pHeader, slot, pProducer->eventFd);
+		return 1;
+	}
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
@@ -0,0 +1,350 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A table of the centrals that have connected to us, with per-connection counters
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The HCI adapter sees a Device Connected event each time a central connects and a Device Disconnected event (with a reason
+// code) each time one leaves (see HciAdapter.cpp.) This table keeps what those events tell us about each central, along with
+// counters of the reads and writes that each one has made, so the application can see which centrals are driving the load (see
+// `ggkGetConnections()`.)
+//
+// Centrals are keyed by their Bluetooth address, packed into a 64-bit integer, in a small open-addressed hash table with linear
+// probing. The table is fixed in size and never allocates. Entries outlive their connection, so a central's counters accumulate
+// across reconnections and the reason it last disconnected stays visible; when the table is full, the central that disconnected
+// longest ago makes way for a new one. Removal uses backward-shift deletion, so the table never fills up with tombstones.
+//
+// Reads and writes are attributed using the "device" option that BlueZ passes to ReadValue and WriteValue (see Init.cpp.)
+// Notifications can't be attributed the same way: BlueZ sends each one to every subscribed central, but StartNotify doesn't
+// tell us which centrals those are. Notifications are counted per characteristic instead (see `ggkGetNotificationCount()`.)
+//
+// Events arrive on the HCI event thread (or the main loop in single-threaded mode), counters are bumped from the server thread and
+// the application may query the table from any thread, so all access is under a single mutex. Connections come and go rarely and
+// each read or write is a D-Bus round trip, so none of it is on a hot path that would benefit from anything cleverer.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <mutex>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "ConnectionTable.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// A single central
+struct ConnectionRecord
+{
+	bool used;
+	ConnectionTable::Key key;
+	GGKConnectionInfo info;
+};
+
+// Number of slots in our open-addressed hash table (a power of two, twice the maximum number of entries)
+static const size_t kConnectionSlots = ConnectionTable::kMaxEntries * 2;
+static const size_t kConnectionSlotMask = kConnectionSlots - 1;
+
+static ConnectionRecord connectionSlots[kConnectionSlots];
+static size_t connectionCount = 0;
+static std::mutex connectionMutex;
+
+// Returns the current wall-clock time in milliseconds since the epoch
+static unsigned long long nowMS()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Returns the home slot for a key
+static size_t homeSlot(ConnectionTable::Key key)
+{
+	return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & kConnectionSlotMask;
+}
+
+// Returns the slot holding `key`, or -1 if it is not in the table (the caller must hold connectionMutex)
+static int findSlot(ConnectionTable::Key key)
+{
+	for (size_t slot = homeSlot(key); connectionSlots[slot].used; slot = (slot + 1) & kConnectionSlotMask)
+	{
+		if (connectionSlots[slot].key == key)
+		{
+			return static_cast<int>(slot);
+		}
+	}
+
+	return -1;
+}
+
+// Removes the entry in `slot`, shifting back any entries that follow it in the same probe sequence (the caller must hold
+// connectionMutex)
+static void removeSlot(size_t slot)
+{
+	size_t hole = slot;
+	size_t next = slot;
+	connectionSlots[hole].used = false;
+
+	for (;;)
+	{
+		next = (next + 1) & kConnectionSlotMask;
+		if (!connectionSlots[next].used)
+		{
+			break;
+		}
+
+		// An entry can move back into the hole only if its home slot is not in the (cyclic) range (hole, next]
+		size_t home = homeSlot(connectionSlots[next].key);
+		bool homeInRange = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+		if (homeInRange)
+		{
+			continue;
+		}
+
+		connectionSlots[hole] = connectionSlots[next];
+		connectionSlots[next].used = false;
+		hole = next;
+	}
+
+	connectionCount -= 1;
+}
+
+// Makes room for a new entry by forgetting the central that disconnected longest ago (the caller must hold connectionMutex)
+//
+// Returns false if every central in the table is connected
+static bool evictOldest()
+{
+	int oldest = -1;
+	for (size_t slot = 0; slot < kConnectionSlots; ++slot)
+	{
+		const ConnectionRecord &record = connectionSlots[slot];
+		if (record.used && !record.info.connected &&
+			(oldest < 0 || record.info.disconnectTimeMS < connectionSlots[oldest].info.disconnectTimeMS))
+		{
+			oldest = static_cast<int>(slot);
+		}
+	}
+
+	if (oldest < 0)
+	{
+		return false;
+	}
+
+	Logger::debug(SSTR << "Connection table full, forgetting " << connectionSlots[oldest].info.address);
+	removeSlot(oldest);
+	return true;
+}
+
+// Returns the entry for `pAddress`, adding it if needed, or nullptr if there is no room (the caller must hold connectionMutex)
+static GGKConnectionInfo *findOrAdd(const uint8_t *pAddress)
+{
+	ConnectionTable::Key key = ConnectionTable::keyFromAddress(pAddress);
+
+	int existing = findSlot(key);
+	if (existing >= 0)
+	{
+		return &connectionSlots[existing].info;
+	}
+
+	if (connectionCount >= ConnectionTable::kMaxEntries && !evictOldest())
+	{
+		return nullptr;
+	}
+
+	size_t slot = homeSlot(key);
+	while (connectionSlots[slot].used)
+	{
+		slot = (slot + 1) & kConnectionSlotMask;
+	}
+
+	ConnectionRecord &record = connectionSlots[slot];
+	memset(&record.info, 0, sizeof(record.info));
+	record.used = true;
+	record.key = key;
+	record.info.disconnectReason = -1;
+
+	// Management API addresses are least significant byte first; we present them the usual way around
+	snprintf(record.info.address, sizeof(record.info.address), "%02X:%02X:%02X:%02X:%02X:%02X",
+		pAddress[5], pAddress[4], pAddress[3], pAddress[2], pAddress[1], pAddress[0]);
+
+	connectionCount += 1;
+	return &record.info;
+}
+
+// Returns the key for an address as it appears in Bluetooth Management API events (least significant byte first)
+ConnectionTable::Key ConnectionTable::keyFromAddress(const uint8_t *pAddress)
+{
+	Key key = 0;
+	for (int i = 5; i >= 0; --i)
+	{
+		key = (key << 8) | pAddress[i];
+	}
+
+	return key;
+}
+
+// Returns the key for a BlueZ device object path (such as "/org/bluez/hci0/dev_00_11_22_33_44_55"), or kInvalidKey if the
+// path does not name a device
+ConnectionTable::Key ConnectionTable::keyFromDevicePath(const char *pDevicePath)
+{
+	if (nullptr == pDevicePath)
+	{
+		return kInvalidKey;
+	}
+
+	const char *pDevice = strstr(pDevicePath, "/dev_");
+	if (nullptr == pDevice)
+	{
+		return kInvalidKey;
+	}
+
+	// The path names the address most significant byte first
+	unsigned int bytes[6];
+	char trailing = 0;
+	if (sscanf(pDevice, "/dev_%2x_%2x_%2x_%2x_%2x_%2x%c", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5], &trailing) < 6 ||
+		(trailing != 0 && trailing != '/'))
+	{
+		return kInvalidKey;
+	}
+
+	Key key = 0;
+	for (int i = 0; i < 6; ++i)
+	{
+		key = (key << 8) | bytes[i];
+	}
+
+	return key;
+}
+
+// Records a connection from the central at `pAddress` (in Bluetooth Management API order) on the given controller
+void ConnectionTable::onConnected(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	GGKConnectionInfo *pInfo = findOrAdd(pAddress);
+	if (nullptr == pInfo)
+	{
+		Logger::warn("Connection table is full of connected centrals, not tracking the new connection");
+		return;
+	}
+
+	pInfo->addressType = addressType;
+	pInfo->controllerIndex = controllerIndex;
+	pInfo->connected = 1;
+	pInfo->connectCount += 1;
+	pInfo->connectTimeMS = nowMS();
+}
+
+// Records a disconnection of the central at `pAddress` (in Bluetooth Management API order), along with the reason code
+void ConnectionTable::onDisconnected(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType, uint8_t reason)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	GGKConnectionInfo *pInfo = findOrAdd(pAddress);
+	if (nullptr == pInfo)
+	{
+		return;
+	}
+
+	pInfo->addressType = addressType;
+	pInfo->controllerIndex = controllerIndex;
+	pInfo->connected = 0;
+	pInfo->disconnectReason = reason;
+	pInfo->disconnectTimeMS = nowMS();
+}
+
+// Counts a read made by the central with the given key (unknown centrals are ignored)
+void ConnectionTable::countRead(Key key)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	int slot = findSlot(key);
+	if (slot >= 0)
+	{
+		connectionSlots[slot].info.readCount += 1;
+	}
+}
+
+// Counts a write made by the central with the given key (unknown centrals are ignored)
+void ConnectionTable::countWrite(Key key)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	int slot = findSlot(key);
+	if (slot >= 0)
+	{
+		connectionSlots[slot].info.writeCount += 1;
+	}
+}
+
+// Returns the number of centrals in the table (connected or not)
+size_t ConnectionTable::size()
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+	return connectionCount;
+}
+
+// Copies up to `maxConnections` entries into `pConnections`, connected centrals first
+//
+// Returns the number of entries copied
+size_t ConnectionTable::getConnections(GGKConnectionInfo *pConnections, size_t maxConnections)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	size_t count = 0;
+	for (int connected = 1; connected >= 0; --connected)
+	{
+		for (size_t slot = 0; slot < kConnectionSlots && count < maxConnections; ++slot)
+		{
+			if (connectionSlots[slot].used && connectionSlots[slot].info.connected == connected)
+			{
+				pConnections[count++] = connectionSlots[slot].info;
+			}
+		}
+	}
+
+	return count;
+}
+
+// Retrieves the entry for the central with the given key
+//
+// Returns true if the central was found, otherwise false
+bool ConnectionTable::getConnection(Key key, GGKConnectionInfo &connection)
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	int slot = findSlot(key);
+	if (slot < 0)
+	{
+		return false;
+	}
+
+	connection = connectionSlots[slot].info;
+	return true;
+}
+
+// Removes every entry from the table
+void ConnectionTable::clear()
+{
+	std::lock_guard<std::mutex> lock(connectionMutex);
+
+	for (size_t slot = 0; slot < kConnectionSlots; ++slot)
+	{
+		connectionSlots[slot].used = false;
+	}
+
+	connectionCount = 0;
+}
+
+}; // namespace ggk
@@ -0,0 +1,81 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A table of the centrals that have connected to us, with per-connection counters
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of ConnectionTable.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+struct ConnectionTable
+{
+	// A Bluetooth address packed into an integer (see `keyFromAddress()`)
+	typedef uint64_t Key;
+
+	// The key used to represent an invalid or unknown address
+	static const Key kInvalidKey = 0xffffffffffffffffULL;
+
+	// The maximum number of centrals the table tracks at once
+	//
+	// When the table is full, the central that disconnected longest ago is forgotten to make room for a new one.
+	static const size_t kMaxEntries = 64;
+
+	// Returns the key for an address as it appears in Bluetooth Management API events (least significant byte first)
+	static Key keyFromAddress(const uint8_t *pAddress);
+
+	// Returns the key for a BlueZ device object path (such as "/org/bluez/hci0/dev_00_11_22_33_44_55"), or kInvalidKey if the
+	// path does not name a device
+	static Key keyFromDevicePath(const char *pDevicePath);
+
+	// Records a connection from the central at `pAddress` (in Bluetooth Management API order) on the given controller
+	static void onConnected(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType);
+
+	// Records a disconnection of the central at `pAddress` (in Bluetooth Management API order), along with the reason code
+	static void onDisconnected(uint16_t controllerIndex, const uint8_t *pAddress, uint8_t addressType, uint8_t reason);
+
+	// Counts a read made by the central with the given key (unknown centrals are ignored)
+	static void countRead(Key key);
+
+	// Counts a write made by the central with the given key (unknown centrals are ignored)
+	static void countWrite(Key key);
+
+	// Returns the number of centrals in the table (connected or not)
+	static size_t size();
+
+	// Copies up to `maxConnections` entries into `pConnections`, connected centrals first
+	//
+	// Returns the number of entries copied
+	static size_t getConnections(GGKConnectionInfo *pConnections, size_t maxConnections);
+
+	// Retrieves the entry for the central with the given key
+	//
+	// Returns true if the central was found, otherwise false
+	static bool getConnection(Key key, GGKConnectionInfo &connection);
+
+	// Removes every entry from the table
+	static void clear();
+};
+
+}; // namespace ggk
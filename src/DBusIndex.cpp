@@ -0,0 +1,200 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A flat hash index of the server's D-Bus interfaces and properties
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every D-Bus method call and property get/set arrives with an object path, an interface name and a member name. Finding the
+// target by walking the object hierarchy means rebuilding each object's path (and comparing names linearly) at every node, for
+// every call. With a few hundred characteristics that adds up to a lot of string building for a single ReadValue.
+//
+// The hierarchy doesn't change once the server has been described, so we walk it once and record every interface and GATT
+// property in a flat, open-addressed hash table keyed by (path, interface) or (path, interface, property). A lookup is then a
+// hash of the incoming strings and a short probe, regardless of the size of the hierarchy, and it doesn't allocate.
+//
+// Methods are not indexed individually. Once the interface is found, the call goes through its (virtual) `callMethod()` so that
+// GATT interfaces can hand their callbacks a pointer of the right type. Interfaces only carry a handful of methods, so that last
+// step is cheap.
+//
+// The index holds pointers into the hierarchy (which is made of lists, so those pointers are stable), so it must be rebuilt if
+// the hierarchy changes.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <stdint.h>
+
+#include "DBusIndex.h"
+#include "DBusObject.h"
+#include "DBusInterface.h"
+#include "GattInterface.h"
+#include "GattService.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+#include "GattProperty.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Builds the index from the given object hierarchy, replacing any previous contents
+//
+// The index holds pointers into the hierarchy, so it must be rebuilt if the hierarchy changes.
+void DBusIndex::build(const std::list<DBusObject> &objects)
+{
+	entries.clear();
+	slots.clear();
+
+	for (const DBusObject &object : objects)
+	{
+		addObject(object, DBusObjectPath());
+	}
+
+	// Size our table to keep the load factor at or below 50%
+	size_t slotCount = 16;
+	while (slotCount < entries.size() * 2)
+	{
+		slotCount *= 2;
+	}
+
+	slots.assign(slotCount, -1);
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		size_t slot = entries[i].hash & (slotCount - 1);
+		while (slots[slot] >= 0)
+		{
+			slot = (slot + 1) & (slotCount - 1);
+		}
+
+		slots[slot] = static_cast<int>(i);
+	}
+
+	Logger::debug(SSTR << "Built D-Bus index with " << entries.size() << " entries");
+}
+
+// Finds an interface by object path and interface name
+//
+// If the interface was found, it is returned, otherwise nullptr is returned
+std::shared_ptr<const DBusInterface> DBusIndex::findInterface(const char *pObjectPath, const char *pInterfaceName) const
+{
+	const Entry *pEntry = find(Entry::EInterface, pObjectPath, pInterfaceName, "");
+	return nullptr == pEntry ? nullptr : pEntry->pInterface;
+}
+
+// Finds a GATT property by object path, interface name and property name
+//
+// If the property was found, it is returned, otherwise nullptr is returned
+const GattProperty *DBusIndex::findProperty(const char *pObjectPath, const char *pInterfaceName, const char *pPropertyName) const
+{
+	const Entry *pEntry = find(Entry::EProperty, pObjectPath, pInterfaceName, pPropertyName);
+	return nullptr == pEntry ? nullptr : pEntry->pProperty;
+}
+
+// Hashes a key (FNV-1a)
+size_t DBusIndex::hashKey(Entry::Kind kind, const char *pObjectPath, const char *pInterfaceName, const char *pMemberName)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = (hash ^ static_cast<uint8_t>(kind)) * 1099511628211ULL;
+	for (const char *p = pObjectPath; *p; ++p) { hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL; }
+	hash = (hash ^ '|') * 1099511628211ULL;
+	for (const char *p = pInterfaceName; *p; ++p) { hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL; }
+	hash = (hash ^ '|') * 1099511628211ULL;
+	for (const char *p = pMemberName; *p; ++p) { hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL; }
+	return static_cast<size_t>(hash);
+}
+
+// Adds an entry for each interface and property of an object and its children
+void DBusIndex::addObject(const DBusObject &object, const DBusObjectPath &basePath)
+{
+	DBusObjectPath path = basePath + object.getPathNode();
+
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+	{
+		addEntry(Entry::EInterface, path, pInterface, "", nullptr);
+		addProperties(path, pInterface);
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		addObject(child, path);
+	}
+}
+
+// Adds an entry for each property of a GATT interface
+void DBusIndex::addProperties(const DBusObjectPath &path, const std::shared_ptr<const DBusInterface> &pInterface)
+{
+	std::shared_ptr<const GattInterface> pGattInterface;
+	if (std::shared_ptr<const GattService> pService = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
+	{
+		pGattInterface = pService;
+	}
+	else if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+	{
+		pGattInterface = pCharacteristic;
+	}
+	else if (std::shared_ptr<const GattDescriptor> pDescriptor = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattDescriptor))
+	{
+		pGattInterface = pDescriptor;
+	}
+
+	if (nullptr == pGattInterface)
+	{
+		return;
+	}
+
+	for (const GattProperty &property : pGattInterface->getProperties())
+	{
+		addEntry(Entry::EProperty, path, pInterface, property.getName(), &property);
+	}
+}
+
+// Adds a single entry
+void DBusIndex::addEntry(Entry::Kind kind, const DBusObjectPath &path, const std::shared_ptr<const DBusInterface> &pInterface, const std::string &memberName, const GattProperty *pProperty)
+{
+	Entry entry;
+	entry.kind = kind;
+	entry.hash = hashKey(kind, path.c_str(), pInterface->getName().c_str(), memberName.c_str());
+	entry.objectPath = path.toString();
+	entry.interfaceName = pInterface->getName();
+	entry.memberName = memberName;
+	entry.pInterface = pInterface;
+	entry.pProperty = pProperty;
+	entries.push_back(entry);
+}
+
+// Finds an entry by key, returning nullptr if not found
+const DBusIndex::Entry *DBusIndex::find(Entry::Kind kind, const char *pObjectPath, const char *pInterfaceName, const char *pMemberName) const
+{
+	if (slots.empty() || nullptr == pObjectPath || nullptr == pInterfaceName || nullptr == pMemberName)
+	{
+		return nullptr;
+	}
+
+	size_t hash = hashKey(kind, pObjectPath, pInterfaceName, pMemberName);
+	size_t mask = slots.size() - 1;
+
+	for (size_t slot = hash & mask; slots[slot] >= 0; slot = (slot + 1) & mask)
+	{
+		const Entry &entry = entries[slots[slot]];
+		if (entry.hash == hash && entry.kind == kind && entry.objectPath == pObjectPath && entry.interfaceName == pInterfaceName &&
+			entry.memberName == pMemberName)
+		{
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+}; // namespace ggk
@@ -0,0 +1,100 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A flat hash index of the server's D-Bus interfaces and properties
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of DBusIndex.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+
+#include "DBusObjectPath.h"
+
+namespace ggk {
+
+struct DBusObject;
+struct DBusInterface;
+struct GattProperty;
+
+struct DBusIndex
+{
+	// Builds the index from the given object hierarchy, replacing any previous contents
+	//
+	// The index holds pointers into the hierarchy, so it must be rebuilt if the hierarchy changes.
+	void build(const std::list<DBusObject> &objects);
+
+	// Returns the number of entries (interfaces and properties) in the index
+	size_t size() const { return entries.size(); }
+
+	// Finds an interface by object path and interface name
+	//
+	// If the interface was found, it is returned, otherwise nullptr is returned
+	std::shared_ptr<const DBusInterface> findInterface(const char *pObjectPath, const char *pInterfaceName) const;
+
+	// Finds a GATT property by object path, interface name and property name
+	//
+	// If the property was found, it is returned, otherwise nullptr is returned
+	const GattProperty *findProperty(const char *pObjectPath, const char *pInterfaceName, const char *pPropertyName) const;
+
+private:
+
+	// A single entry in our index
+	struct Entry
+	{
+		enum Kind
+		{
+			EInterface,
+			EProperty
+		};
+
+		Kind kind;
+		size_t hash;
+		std::string objectPath;
+		std::string interfaceName;
+		std::string memberName;
+		std::shared_ptr<const DBusInterface> pInterface;
+		const GattProperty *pProperty;
+	};
+
+	// Hashes a key
+	static size_t hashKey(Entry::Kind kind, const char *pObjectPath, const char *pInterfaceName, const char *pMemberName);
+
+	// Adds an entry for each interface and property of an object and its children
+	void addObject(const DBusObject &object, const DBusObjectPath &basePath);
+
+	// Adds an entry for each property of a GATT interface
+	void addProperties(const DBusObjectPath &path, const std::shared_ptr<const DBusInterface> &pInterface);
+
+	// Adds a single entry
+	void addEntry(Entry::Kind kind, const DBusObjectPath &path, const std::shared_ptr<const DBusInterface> &pInterface, const std::string &memberName, const GattProperty *pProperty);
+
+	// Finds an entry by key, returning nullptr if not found
+	const Entry *find(Entry::Kind kind, const char *pObjectPath, const char *pInterfaceName, const char *pMemberName) const;
+
+	// Our entries
+	std::vector<Entry> entries;
+
+	// Open-addressed hash table of indices into `entries` (-1 for an empty slot), sized to a power of two
+	std::vector<int> slots;
+};
+
+}; // namespace ggk
@@ -145,24 +145,21 @@ bool DBusInterface::callMethod(const std::string &methodName, GDBusConnection *p
 // NOTE: Subclasses are encouraged to overload this method in order to support different callback types that are specific to
 // their subclass type. In addition, they should return their own type. This simplifies the server description by allowing
 // calls to chain.
-DBusInterface &DBusInterface::onEvent(int tickFrequency, void *pUserData, TickEvent::Callback callback)
+DBusInterface &DBusInterface::onEvent(int periodMS, void *pUserData, TickEvent::Callback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, callback, pUserData));
+	events.push_back(TickEvent(this, periodMS, callback, pUserData));
 	return *this;
 }
 
-// Ticks each event within this interface
+// Fires one of this interface's events
 //
 // For details on events, see TickEvent.cpp.
 //
 // NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
 // their subclass type.
-void DBusInterface::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+void DBusInterface::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
 {
-	for (const TickEvent &event : events)
-	{
-		event.tick<DBusInterface>(getPath(), pConnection, pUserData);
-	}
+	event.fire<DBusInterface>(getPath(), pConnection, pUserData);
 }
 
 // Internal method used to generate introspection XML used to describe our services on D-Bus
@@ -193,4 +190,27 @@ std::string DBusInterface::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to generate the introspection data used to register our services on D-Bus
+//
+// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+GDBusInterfaceInfo *DBusInterface::generateInterfaceInfo() const
+{
+	GDBusInterfaceInfo *pInfo = g_new0(GDBusInterfaceInfo, 1);
+	pInfo->ref_count = 1;
+	pInfo->name = g_strdup(getName().c_str());
+
+	// Describe our methods
+	pInfo->methods = g_new0(GDBusMethodInfo *, methods.size() + 1);
+	size_t index = 0;
+	for (const DBusMethod &method : methods)
+	{
+		pInfo->methods[index++] = method.generateMethodInfo();
+	}
+
+	pInfo->signals = g_new0(GDBusSignalInfo *, 1);
+	pInfo->properties = g_new0(GDBusPropertyInfo *, 1);
+	pInfo->annotations = g_new0(GDBusAnnotationInfo *, 1);
+	return pInfo;
+}
+
 }; // namespace ggk
\ No newline at end of file
@@ -115,15 +115,23 @@ struct DBusInterface
 	// NOTE: Subclasses are encouraged to overload this method in order to support different callback types that are specific to
 	// their subclass type. In addition, they should return their own type. This simplifies the server description by allowing
 	// calls to chain.
-	DBusInterface &onEvent(int tickFrequency, void *pUserData, TickEvent::Callback callback);
+	DBusInterface &onEvent(int periodMS, void *pUserData, TickEvent::Callback callback);
+
+	// Returns the events added to this interface (see `onEvent()`)
+	const std::list<TickEvent> &getEvents() const { return events; }
 
 	// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
 	// their subclass type.
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	virtual std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to generate the introspection data used to register our services on D-Bus
+	//
+	// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
+
 protected:
 	DBusObject &owner;
 	std::string name;
@@ -79,4 +79,43 @@ std::string DBusMethod::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to generate the introspection data used to register our services on D-Bus
+//
+// The caller owns the returned reference and must release it with `g_dbus_method_info_unref()`
+GDBusMethodInfo *DBusMethod::generateMethodInfo() const
+{
+	GDBusMethodInfo *pInfo = g_new0(GDBusMethodInfo, 1);
+	pInfo->ref_count = 1;
+	pInfo->name = g_strdup(getName().c_str());
+
+	// Add our input arguments
+	pInfo->in_args = g_new0(GDBusArgInfo *, getInArgs().size() + 1);
+	for (size_t i = 0; i < getInArgs().size(); ++i)
+	{
+		pInfo->in_args[i] = generateArgInfo(i, getInArgs()[i]);
+	}
+
+	// Add our output argument (if any)
+	const std::string &outArgs = getOutArgs();
+	pInfo->out_args = g_new0(GDBusArgInfo *, outArgs.empty() ? 1 : 2);
+	if (!outArgs.empty())
+	{
+		pInfo->out_args[0] = generateArgInfo(getInArgs().size(), outArgs);
+	}
+
+	pInfo->annotations = g_new0(GDBusAnnotationInfo *, 1);
+	return pInfo;
+}
+
+// Generates the introspection data for a single argument, named the way GDBus names unnamed arguments in introspection XML
+GDBusArgInfo *DBusMethod::generateArgInfo(size_t index, const std::string &signature)
+{
+	GDBusArgInfo *pInfo = g_new0(GDBusArgInfo, 1);
+	pInfo->ref_count = 1;
+	pInfo->name = g_strdup_printf("arg_%zu", index);
+	pInfo->signature = g_strdup(signature.c_str());
+	pInfo->annotations = g_new0(GDBusAnnotationInfo *, 1);
+	return pInfo;
+}
+
 }; // namespace ggk
\ No newline at end of file
@@ -61,6 +61,9 @@ struct DBusMethod
 	// This method should generally not be called directly. Rather, the name should be set by the constructor
 	DBusMethod &setName(const std::string &name) { this->name = name; return *this; }
 
+	// Returns the callback delegate (which may be null)
+	Callback getCallback() const { return callback; }
+
 	// Get the input argument type string (a GVariant type string format)
 	const std::vector<std::string> &getInArgs() const { return inArgs; }
 
@@ -102,7 +105,15 @@ struct DBusMethod
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to generate the introspection data used to register our services on D-Bus
+	//
+	// The caller owns the returned reference and must release it with `g_dbus_method_info_unref()`
+	GDBusMethodInfo *generateMethodInfo() const;
+
 private:
+	// Generates the introspection data for a single argument
+	static GDBusArgInfo *generateArgInfo(size_t index, const std::string &signature);
+
 	const DBusInterface *pOwner;
 	std::string name;
 	std::vector<std::string> inArgs;
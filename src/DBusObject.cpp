@@ -43,6 +43,7 @@
 #include "GattService.h"
 #include "DBusObject.h"
 #include "Utils.h"
+#include "TimerWheel.h"
 #include "GattUuid.h"
 #include "Logger.h"
 
@@ -137,6 +138,14 @@ GattService &DBusObject::gattServiceBegin(const std::string &pathElement, const
 	return service;
 }
 
+// Adds a GATT service to the hierarchy from its compile-time description (see GattSchema.h)
+//
+// To end a service, call `gattServiceEnd()`
+GattService &DBusObject::gattServiceBegin(const GattSchema::Service &schema)
+{
+	return gattServiceBegin(schema.pPathElement, GattUuid(schema.uuid));
+}
+
 //
 // Helpful routines for searching objects
 //
@@ -195,17 +204,21 @@ bool DBusObject::callMethod(const DBusObjectPath &path, const std::string &inter
 	return false;
 }
 
-// Periodic timer tick propagation
-void DBusObject::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+// Adds the events of this object's interfaces (and those of its children) to the timer wheel
+void DBusObject::scheduleEvents(TimerWheel &wheel, uint64_t nowMS, const DBusObjectPath &basePath) const
 {
 	for (std::shared_ptr<const DBusInterface> interface : interfaces)
 	{
-		interface->tickEvents(pConnection, pUserData);
+		for (const TickEvent &event : interface->getEvents())
+		{
+			Logger::debug(SSTR << "Scheduling event every " << event.getPeriodMS() << "ms at path '" << (basePath + getPathNode()) << "'");
+			wheel.add(*interface, event, nowMS);
+		}
 	}
 
 	for (const DBusObject &child : getChildren())
 	{
-		child.tickEvents(pConnection, pUserData);
+		child.scheduleEvents(wheel, nowMS, basePath + getPathNode());
 	}
 }
 
@@ -235,7 +248,7 @@ std::string DBusObject::generateIntrospectionXML(int depth) const
 		xml += interface->generateIntrospectionXML(depth + 1);
 	}
 
-	for (DBusObject child : getChildren())
+	for (const DBusObject &child : getChildren())
 	{
 		xml += child.generateIntrospectionXML(depth + 1);
 	}
@@ -26,8 +26,10 @@
 #include <string>
 #include <list>
 #include <memory>
+#include <stdint.h>
 
 #include "DBusObjectPath.h"
+#include "GattSchema.h"
 
 namespace ggk {
 
@@ -35,6 +37,7 @@ struct GattProperty;
 struct GattService;
 struct GattUuid;
 struct DBusInterface;
+struct TimerWheel;
 
 struct DBusObject
 {
@@ -98,6 +101,11 @@ struct DBusObject
 	// To end a service, call `gattServiceEnd()`
 	GattService &gattServiceBegin(const std::string &pathElement, const GattUuid &uuid);
 
+	// Adds a GATT service to the hierarchy from its compile-time description (see GattSchema.h)
+	//
+	// To end a service, call `gattServiceEnd()`
+	GattService &gattServiceBegin(const GattSchema::Service &schema);
+
 	//
 	// Helpful routines for searching objects
 	//
@@ -108,8 +116,8 @@ struct DBusObject
 	// Finds a BlueZ method by name within the specified D-Bus interface
 	bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData, const DBusObjectPath &basePath = DBusObjectPath()) const;
 
-	// Periodic timer tick propagation
-	void tickEvents(GDBusConnection *pConnection, void *pUserData = nullptr) const;
+	// Adds the events of this object's interfaces (and those of its children) to the timer wheel
+	void scheduleEvents(TimerWheel &wheel, uint64_t nowMS, const DBusObjectPath &basePath = DBusObjectPath()) const;
 
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// D-Bus signals
@@ -0,0 +1,671 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A built-in, typed store for server data, as an alternative to the application's data getter and setter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The server normally gets its data from the application through a getter and setter (see `GGKServerDataGetter` and
+// `GGKServerDataSetter`), which look values up by name. Every ReadValue ends up comparing strings in the application, on the
+// main loop, and reads far outnumber writes.
+//
+// Applications that would rather not write their own can pass null delegates to `ggkStart()` and use this store instead. Names
+// are interned once into integer keys (typically when the server description is built, see Server.cpp) and from then on a key is
+// simply an index into a fixed table of slots. Looking a value up by key involves no strings, no locks and no allocations.
+//
+// Each slot holds two kinds of value:
+//
+//     * Plain-old-data values (up to kMaxValueSize bytes) are stored inline, guarded by a sequence lock. A writer makes the
+//       sequence odd, stores the value and makes it even again. A reader copies the value out and retries if the sequence was odd
+//       or changed while it was copying. Readers never block writers, and never block each other.
+//
+//     * Strings and blobs are stored as a pointer to an immutable copy. A writer swaps in a new copy and frees the old one once
+//       no reader can still be looking at it (read-copy-update.) Readers announce themselves by bumping a counter for the
+//       current epoch; the writer moves the epoch on and waits for the old epoch's readers to leave before freeing. Readers only
+//       hold the copy long enough to copy it out, so the wait is short, and only writers ever wait.
+//
+// The interning table itself is guarded by a mutex, but it is only touched when interning or looking up a name, never when
+// reading or writing by key.
+//
+// A key may be bound to a characteristic (see `GattCharacteristic::bindData()`.) The server resolves the binding to an update
+// queue ID when it starts, so each write to a bound key simply pushes that ID onto the update queue. When the server thread gets
+// to it, the update queue already knows which characteristic it's for, and the characteristic sends the value straight from its
+// slot. Reading the value when the update is delivered (rather than copying it into the queue) means a string or blob never has
+// to fit in the queue, and an update that was coalesced with another still carries the latest value.
+//
+// A key may also be attached to a slot in the shared-memory data plane (see ShmDataPlane.cpp.) Its value then lives in shared
+// memory, where a producer in another process can publish it, and every read and write by key goes to the shared slot instead.
+// The shared slot is found through a pointer that is swapped with the same read-copy-update scheme as strings and blobs, so the
+// data plane can be torn down while readers are about.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include "DataStore.h"
+#include "Init.h"
+#include "Logger.h"
+#include "../include/GobbledegookShm.h"
+
+namespace ggk {
+
+// The number of 64-bit words needed to hold the largest plain-old-data value
+static const size_t kValueWords = (DataStore::kMaxValueSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+// The storage for a single key
+//
+// Slots live in static storage and are zero-initialized before anything runs, so keys can be interned from static initializers.
+struct Slot
+{
+	// Plain-old-data value, guarded by the sequence lock (odd while a write is in progress)
+	std::atomic<uint32_t> sequence;
+	std::atomic<uint32_t> valueSize;
+	std::atomic<uint64_t> valueWords[kValueWords];
+
+	// String or blob value, replaced by read-copy-update
+	std::atomic<const std::string *> pBytes;
+
+	// Which of the two was stored last (see SlotKind)
+	std::atomic<int> kind;
+
+	// The slot in the shared-memory data plane that holds the value instead, if attached (replaced by read-copy-update)
+	std::atomic<GGKShmSlot *> pShared;
+
+	// The update queue ID pushed on each write, if bound
+	std::atomic<bool> bound;
+	std::atomic<UpdateQueue::Id> boundId;
+};
+
+// What a slot holds
+enum SlotKind
+{
+	EEmpty = 0,
+	EValue,
+	EBytes
+};
+
+static Slot slots[DataStore::kMaxKeys];
+
+// The interned names, indexed by key. The strings are owned by the interning map, which never moves them.
+static const char *names[DataStore::kMaxKeys];
+static std::atomic<int> keyCount(0);
+
+// Read-copy-update state: the current epoch and the number of readers that entered during even and odd epochs
+static std::atomic<unsigned int> readEpoch(0);
+static std::atomic<int> readerCounts[2];
+static std::mutex bytesWriteMutex;
+
+// Returns the interning map and its mutex
+//
+// These are created on first use, so that keys can be interned safely from static initializers in other files.
+static std::unordered_map<std::string, DataStore::Key> &internMap()
+{
+	static std::unordered_map<std::string, DataStore::Key> map;
+	return map;
+}
+
+static std::mutex &internMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+// Returns the slot for a key, or nullptr if the key is not valid
+static Slot *getSlot(DataStore::Key key)
+{
+	if (key < 0 || key >= keyCount.load(std::memory_order_acquire))
+	{
+		return nullptr;
+	}
+
+	return &slots[key];
+}
+
+// Enters a read-side critical section, returning the epoch to pass to `readUnlock()`
+static unsigned int readLock()
+{
+	for (;;)
+	{
+		unsigned int epoch = readEpoch.load();
+		readerCounts[epoch & 1].fetch_add(1);
+
+		// If the epoch moved on while we were registering, a writer may not have seen us; try again in the new epoch
+		if (readEpoch.load() == epoch)
+		{
+			return epoch;
+		}
+
+		readerCounts[epoch & 1].fetch_sub(1);
+	}
+}
+
+// Leaves a read-side critical section
+static void readUnlock(unsigned int epoch)
+{
+	readerCounts[epoch & 1].fetch_sub(1, std::memory_order_release);
+}
+
+// Waits until every reader that might have seen a pointer that was just replaced has left (call with bytesWriteMutex held)
+static void waitForReaders()
+{
+	// Move to the next epoch, then wait for everybody who entered during the old one to leave
+	unsigned int epoch = readEpoch.fetch_add(1);
+	while (readerCounts[epoch & 1].load() != 0)
+	{
+		std::this_thread::yield();
+	}
+}
+
+// Calls `access` with the slot's shared-memory slot, if it is attached to one, keeping the shared slot from being detached until
+// it returns
+//
+// Returns false (without calling `access`) if the slot is not attached
+template<typename F>
+static bool withShared(Slot &slot, F access)
+{
+	// Most slots are never attached, so don't pay for the read lock unless this one might be
+	if (nullptr == slot.pShared.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	unsigned int epoch = readLock();
+	GGKShmSlot *pShared = slot.pShared.load();
+	if (nullptr != pShared)
+	{
+		access(*pShared);
+	}
+	readUnlock(epoch);
+
+	return nullptr != pShared;
+}
+
+// Writes a plain-old-data value of `size` bytes (up to kMaxValueSize) into a slot under its sequence lock
+static void writeInline(Slot &slot, const void *pData, size_t size)
+{
+	uint64_t words[kValueWords] = { 0 };
+	memcpy(words, pData, size);
+
+	// Take the write side of the sequence lock by making it odd
+	uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		if ((sequence & 1) != 0)
+		{
+			std::this_thread::yield();
+			sequence = slot.sequence.load(std::memory_order_relaxed);
+		}
+		else if (slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	// Readers must see the odd sequence before any of the new value
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.valueSize.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+	for (size_t i = 0; i < kValueWords; ++i)
+	{
+		slot.valueWords[i].store(words[i], std::memory_order_relaxed);
+	}
+
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Copies a slot's plain-old-data value into `words` and returns its size in `size`
+//
+// The value and its size are read together (from the shared-memory slot if the slot is attached, otherwise under the slot's
+// sequence lock) so they always agree, even while another thread writes a value of a different size.
+//
+// Returns false if the shared-memory slot could not be read
+static bool loadInline(Slot &slot, uint64_t (&words)[kValueWords], size_t &size)
+{
+	int sharedSize = -1;
+	if (withShared(slot, [&](GGKShmSlot &shared) { sharedSize = ggkShmRead(&shared, words, sizeof(words), GGK_SHM_SERVER_MAX_RETRIES); }))
+	{
+		if (sharedSize < 0)
+		{
+			return false;
+		}
+
+		size = static_cast<size_t>(sharedSize);
+		return true;
+	}
+
+	for (;;)
+	{
+		uint32_t before = slot.sequence.load(std::memory_order_acquire);
+		if ((before & 1) != 0)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		size = slot.valueSize.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < kValueWords; ++i)
+		{
+			words[i] = slot.valueWords[i].load(std::memory_order_relaxed);
+		}
+
+		// The copy only counts if no writer got in while we were making it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) == before)
+		{
+			return true;
+		}
+	}
+}
+
+// Lets the server know that a slot has been written to, if it is bound to a characteristic
+static void notifyBinding(Slot &slot)
+{
+	if (!slot.bound.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	// A merged update is already pending, so the server thread already knows
+	if (UpdateQueue::EAdded == UpdateQueue::push(slot.boundId.load(std::memory_order_relaxed)))
+	{
+		wakeUpdateQueue();
+	}
+}
+
+// Returns the key for a name, adding the name to the store if it isn't already there
+//
+// Keys never change once they've been handed out, so they can be looked up once (when the server description is built) and
+// used from then on. Returns kInvalidKey if the name is null or the store is full.
+DataStore::Key DataStore::intern(const char *pName)
+{
+	if (nullptr == pName)
+	{
+		return kInvalidKey;
+	}
+
+	std::lock_guard<std::mutex> lock(internMutex());
+
+	std::unordered_map<std::string, Key> &map = internMap();
+	auto iter = map.find(pName);
+	if (iter != map.end())
+	{
+		return iter->second;
+	}
+
+	Key key = keyCount.load(std::memory_order_relaxed);
+	if (key >= kMaxKeys)
+	{
+		Logger::error(SSTR << "Unable to add '" << pName << "' to the data store: the store is full (" << kMaxKeys << " keys)");
+		return kInvalidKey;
+	}
+
+	iter = map.insert(std::make_pair(std::string(pName), key)).first;
+	names[key] = iter->first.c_str();
+
+	// Publish the key only once its name is in place
+	keyCount.store(key + 1, std::memory_order_release);
+	return key;
+}
+
+// Returns the key for a name, or kInvalidKey if the name has not been interned
+DataStore::Key DataStore::find(const char *pName)
+{
+	if (nullptr == pName)
+	{
+		return kInvalidKey;
+	}
+
+	std::lock_guard<std::mutex> lock(internMutex());
+
+	std::unordered_map<std::string, Key> &map = internMap();
+	auto iter = map.find(pName);
+	return iter == map.end() ? kInvalidKey : iter->second;
+}
+
+// Returns the name for a key, or nullptr if the key is not valid
+const char *DataStore::getName(Key key)
+{
+	return nullptr == getSlot(key) ? nullptr : names[key];
+}
+
+// Returns the number of interned names
+int DataStore::size()
+{
+	return keyCount.load(std::memory_order_acquire);
+}
+
+// Stores a plain-old-data value of `size` bytes (up to kMaxValueSize) from `pData`
+//
+// This is the untyped form of `setValue()`. Returns false if the key is not valid or the size is out of range.
+bool DataStore::storeValue(Key key, const void *pData, size_t size)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot || nullptr == pData || 0 == size || size > kMaxValueSize)
+	{
+		return false;
+	}
+
+	bool written = false;
+	if (withShared(*pSlot, [&](GGKShmSlot &shared) { written = ggkShmWrite(&shared, pData, static_cast<uint32_t>(size), GGK_SHM_SERVER_MAX_RETRIES); }))
+	{
+		pSlot->kind.store(EValue, std::memory_order_release);
+		if (written)
+		{
+			notifyBinding(*pSlot);
+		}
+
+		return written;
+	}
+
+	writeInline(*pSlot, pData, size);
+	pSlot->kind.store(EValue, std::memory_order_release);
+
+	notifyBinding(*pSlot);
+	return true;
+}
+
+// Loads a plain-old-data value of `size` bytes into `pData`
+//
+// This is the untyped form of `getValue()`. Returns false if the key is not valid or the value has not been stored with the
+// same size.
+bool DataStore::loadValue(Key key, void *pData, size_t size)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot || nullptr == pData)
+	{
+		return false;
+	}
+
+	uint64_t words[kValueWords];
+	size_t valueSize = 0;
+	if (!loadInline(*pSlot, words, valueSize) || valueSize != size)
+	{
+		return false;
+	}
+
+	memcpy(pData, words, size);
+	return true;
+}
+
+// Stores a copy of a value of any size (such as a string or a blob)
+//
+// Returns false if the key is not valid
+bool DataStore::setBytes(Key key, const void *pData, size_t size)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot || (nullptr == pData && 0 != size))
+	{
+		return false;
+	}
+
+	bool written = false;
+	if (withShared(*pSlot, [&](GGKShmSlot &shared)
+	{
+		written = size <= GGK_SHM_MAX_VALUE_SIZE && ggkShmWrite(&shared, pData, static_cast<uint32_t>(size), GGK_SHM_SERVER_MAX_RETRIES);
+	}))
+	{
+		pSlot->kind.store(EBytes, std::memory_order_release);
+		if (written)
+		{
+			notifyBinding(*pSlot);
+		}
+
+		return written;
+	}
+
+	const std::string *pNew = new std::string(static_cast<const char *>(pData), size);
+
+	std::lock_guard<std::mutex> lock(bytesWriteMutex);
+
+	const std::string *pOld = pSlot->pBytes.exchange(pNew);
+	pSlot->kind.store(EBytes, std::memory_order_release);
+
+	waitForReaders();
+	delete pOld;
+
+	notifyBinding(*pSlot);
+	return true;
+}
+
+// Stores a copy of a null-terminated string
+//
+// Returns false if the key is not valid or `pString` is null
+bool DataStore::setString(Key key, const char *pString)
+{
+	return nullptr != pString && setBytes(key, pString, strlen(pString));
+}
+
+// Copies a value stored with `setBytes()` or `setString()` into `value`
+//
+// Returns false if the key is not valid or nothing has been stored
+bool DataStore::getString(Key key, std::string &value)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	int sharedSize = -1;
+	if (withShared(*pSlot, [&](GGKShmSlot &shared)
+	{
+		char buffer[GGK_SHM_MAX_VALUE_SIZE];
+		sharedSize = ggkShmRead(&shared, buffer, sizeof(buffer), GGK_SHM_SERVER_MAX_RETRIES);
+		if (sharedSize >= 0)
+		{
+			value.assign(buffer, sharedSize);
+		}
+	}))
+	{
+		return sharedSize >= 0;
+	}
+
+	unsigned int epoch = readLock();
+	const std::string *pBytes = pSlot->pBytes.load();
+	if (nullptr != pBytes)
+	{
+		value.assign(*pBytes);
+	}
+	readUnlock(epoch);
+
+	return nullptr != pBytes;
+}
+
+// Copies up to `bufferSize` bytes of a value stored with `setBytes()` or `setString()` into `pBuffer`
+//
+// Returns the full size of the value (which may be larger than `bufferSize`), or -1 if the key is not valid or nothing has
+// been stored
+int DataStore::getBytes(Key key, void *pBuffer, size_t bufferSize)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return -1;
+	}
+
+	int result = -1;
+	if (withShared(*pSlot, [&](GGKShmSlot &shared)
+	{
+		result = ggkShmRead(&shared, pBuffer, static_cast<uint32_t>(std::min(bufferSize, size_t(GGK_SHM_MAX_VALUE_SIZE))), GGK_SHM_SERVER_MAX_RETRIES);
+	}))
+	{
+		return result;
+	}
+
+	unsigned int epoch = readLock();
+	const std::string *pBytes = pSlot->pBytes.load();
+	if (nullptr != pBytes)
+	{
+		if (nullptr != pBuffer)
+		{
+			memcpy(pBuffer, pBytes->data(), std::min(bufferSize, pBytes->size()));
+		}
+
+		result = static_cast<int>(pBytes->size());
+	}
+	readUnlock(epoch);
+
+	return result;
+}
+
+// Copies the raw bytes of whichever value was stored last (by `setValue()`, `setBytes()` or `setString()`) into `bytes`
+//
+// Returns false if the key is not valid or nothing has been stored
+bool DataStore::getRaw(Key key, std::string &bytes)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	// A shared slot only ever holds raw bytes
+	if (nullptr != pSlot->pShared.load(std::memory_order_acquire))
+	{
+		return getString(key, bytes);
+	}
+
+	switch (pSlot->kind.load(std::memory_order_acquire))
+	{
+		case EValue:
+		{
+			// Whatever size the value was when we read it, not when we looked
+			uint64_t words[kValueWords];
+			size_t size = 0;
+			if (!loadInline(*pSlot, words, size))
+			{
+				return false;
+			}
+
+			bytes.assign(reinterpret_cast<const char *>(words), size);
+			return true;
+		}
+		case EBytes:
+			return getString(key, bytes);
+		default:
+			return false;
+	}
+}
+
+// Binds a key to an update queue ID (see `GattCharacteristic::bindData()`), or unbinds it with UpdateQueue::kInvalidId
+//
+// From then on, every write to the key pushes that ID onto the update queue, so subscribers are notified of the new value.
+// Returns false if the key is not valid.
+bool DataStore::bind(Key key, UpdateQueue::Id id)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	if (UpdateQueue::kInvalidId == id)
+	{
+		pSlot->bound.store(false, std::memory_order_release);
+		return true;
+	}
+
+	pSlot->boundId.store(id, std::memory_order_relaxed);
+	pSlot->bound.store(true, std::memory_order_release);
+	return true;
+}
+
+// Attaches a key to a slot in the shared-memory data plane (see ShmDataPlane.cpp), or detaches it with nullptr
+//
+// While attached, the key's value is read from and written to the shared slot. Detaching copies the shared slot's last value
+// back into the store and waits until nobody can still be using the shared slot, so it can be unmapped as soon as this returns.
+// Returns false if the key is not valid.
+bool DataStore::attachShared(Key key, GGKShmSlot *pShared)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(bytesWriteMutex);
+
+	GGKShmSlot *pOld = pSlot->pShared.exchange(pShared);
+	waitForReaders();
+
+	// Keep the last value that was published to the old shared slot
+	if (nullptr != pOld && nullptr == pShared)
+	{
+		char buffer[GGK_SHM_MAX_VALUE_SIZE];
+		int size = ggkShmRead(pOld, buffer, sizeof(buffer), GGK_SHM_SERVER_MAX_RETRIES);
+		if (size > 0 && EValue == pSlot->kind.load(std::memory_order_acquire) && static_cast<size_t>(size) <= kMaxValueSize)
+		{
+			writeInline(*pSlot, buffer, size);
+		}
+		else if (size >= 0)
+		{
+			const std::string *pBytes = pSlot->pBytes.exchange(new std::string(buffer, size));
+			pSlot->kind.store(EBytes, std::memory_order_release);
+			waitForReaders();
+			delete pBytes;
+		}
+	}
+
+	return true;
+}
+
+// Lets the server know that a key's value has changed without going through the store (such as when a producer publishes it
+// to the shared-memory data plane)
+//
+// Returns false if the key is not valid
+bool DataStore::touch(Key key)
+{
+	Slot *pSlot = getSlot(key);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	notifyBinding(*pSlot);
+	return true;
+}
+
+// Returns a pointer to a null-terminated copy of a value stored with `setBytes()` or `setString()`, or nullptr if the key is
+// not valid or nothing has been stored
+//
+// The copy belongs to the calling thread and remains valid until the next call to `getPointer()` for the same key on the same
+// thread. This is how the store stands in for the application's data getter (see `GattInterface::getDataPointer()`.)
+const void *DataStore::getPointer(Key key)
+{
+	// Each thread keeps its own copy of each value it reads. These are reused, so once they've grown large enough, reading
+	// doesn't allocate.
+	static thread_local std::vector<std::string> copies;
+
+	if (nullptr == getSlot(key))
+	{
+		return nullptr;
+	}
+
+	if (copies.size() <= static_cast<size_t>(key))
+	{
+		copies.resize(kMaxKeys);
+	}
+
+	std::string &copy = copies[key];
+	return getString(key, copy) ? copy.c_str() : nullptr;
+}
+
+}; // namespace ggk
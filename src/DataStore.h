@@ -0,0 +1,149 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A built-in, typed store for server data, as an alternative to the application's data getter and setter
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of DataStore.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <stddef.h>
+
+#include "UpdateQueue.h"
+
+struct GGKShmSlot;
+
+namespace ggk {
+
+struct DataStore
+{
+	// A handle to a named value in the store
+	typedef int Key;
+
+	// The key returned when a name can't be found (or interned)
+	static const Key kInvalidKey = -1;
+
+	// The maximum number of names the store can hold
+	static const int kMaxKeys = 256;
+
+	// The largest value (in bytes) that can be stored with `setValue()`
+	static const size_t kMaxValueSize = 16;
+
+	// Returns the key for a name, adding the name to the store if it isn't already there
+	//
+	// Keys never change once they've been handed out, so they can be looked up once (when the server description is built) and
+	// used from then on. Returns kInvalidKey if the name is null or the store is full.
+	static Key intern(const char *pName);
+
+	// Returns the key for a name, or kInvalidKey if the name has not been interned
+	static Key find(const char *pName);
+
+	// Returns the name for a key, or nullptr if the key is not valid
+	static const char *getName(Key key);
+
+	// Returns the number of interned names
+	static int size();
+
+	// Stores a plain-old-data value (up to kMaxValueSize bytes)
+	//
+	// Returns false if the key is not valid
+	template<typename T>
+	static bool setValue(Key key, const T &value)
+	{
+		static_assert(std::is_trivial<T>::value && sizeof(T) <= kMaxValueSize, "DataStore values must be trivial types of no more than kMaxValueSize bytes");
+		return storeValue(key, &value, sizeof(T));
+	}
+
+	// Retrieves a plain-old-data value stored with `setValue()`
+	//
+	// Returns `defaultValue` if the key is not valid or the value has not been stored with a type of the same size.
+	template<typename T>
+	static T getValue(Key key, const T defaultValue)
+	{
+		static_assert(std::is_trivial<T>::value && sizeof(T) <= kMaxValueSize, "DataStore values must be trivial types of no more than kMaxValueSize bytes");
+		T value;
+		return loadValue(key, &value, sizeof(T)) ? value : defaultValue;
+	}
+
+	// Stores a copy of a value of any size (such as a string or a blob)
+	//
+	// Returns false if the key is not valid
+	static bool setBytes(Key key, const void *pData, size_t size);
+
+	// Stores a copy of a null-terminated string
+	//
+	// Returns false if the key is not valid or `pString` is null
+	static bool setString(Key key, const char *pString);
+
+	// Copies a value stored with `setBytes()` or `setString()` into `value`
+	//
+	// Returns false if the key is not valid or nothing has been stored
+	static bool getString(Key key, std::string &value);
+
+	// Copies up to `bufferSize` bytes of a value stored with `setBytes()` or `setString()` into `pBuffer`
+	//
+	// Returns the full size of the value (which may be larger than `bufferSize`), or -1 if the key is not valid or nothing has
+	// been stored
+	static int getBytes(Key key, void *pBuffer, size_t bufferSize);
+
+	// Returns a pointer to a null-terminated copy of a value stored with `setBytes()` or `setString()`, or nullptr if the key is
+	// not valid or nothing has been stored
+	//
+	// The copy belongs to the calling thread and remains valid until the next call to `getPointer()` for the same key on the same
+	// thread. This is how the store stands in for the application's data getter (see `GattInterface::getDataPointer()`.)
+	static const void *getPointer(Key key);
+
+	// Copies the raw bytes of whichever value was stored last (by `setValue()`, `setBytes()` or `setString()`) into `bytes`
+	//
+	// Returns false if the key is not valid or nothing has been stored
+	static bool getRaw(Key key, std::string &bytes);
+
+	// Binds a key to an update queue ID (see `GattCharacteristic::bindData()`), or unbinds it with UpdateQueue::kInvalidId
+	//
+	// From then on, every write to the key pushes that ID onto the update queue, so subscribers are notified of the new value.
+	// Returns false if the key is not valid.
+	static bool bind(Key key, UpdateQueue::Id id);
+
+	// Attaches a key to a slot in the shared-memory data plane (see ShmDataPlane.cpp), or detaches it with nullptr
+	//
+	// While attached, the key's value is read from and written to the shared slot. Detaching copies the shared slot's last value
+	// back into the store and waits until nobody can still be using the shared slot, so it can be unmapped as soon as this returns.
+	// Returns false if the key is not valid.
+	static bool attachShared(Key key, GGKShmSlot *pShared);
+
+	// Lets the server know that a key's value has changed without going through the store (such as when a producer publishes it
+	// to the shared-memory data plane)
+	//
+	// Returns false if the key is not valid
+	static bool touch(Key key);
+
+	// Stores a plain-old-data value of `size` bytes (up to kMaxValueSize) from `pData`
+	//
+	// This is the untyped form of `setValue()`. Returns false if the key is not valid or the size is out of range.
+	static bool storeValue(Key key, const void *pData, size_t size);
+
+	// Loads a plain-old-data value of `size` bytes into `pData`
+	//
+	// This is the untyped form of `getValue()`. Returns false if the key is not valid or the value has not been stored with the
+	// same size.
+	static bool loadValue(Key key, void *pData, size_t size);
+};
+
+}; // namespace ggk
@@ -0,0 +1,210 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A handle for answering a D-Bus method call later, from any thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Method handlers in the server description run on the server's main loop, and normally reply (via `methodReturnValue()` and
+// friends) before returning. A handler whose data comes from somewhere slow (a sensor on an I2C bus, for example) holds up every
+// other D-Bus call and notification while it waits.
+//
+// D-Bus doesn't require the reply to be sent before the handler returns. A handler may instead call `deferReply()` to take
+// ownership of the method call, start the slow work elsewhere (on its own thread, or see `offloadToPool()`) and return right
+// away. Whatever does the work replies through the handle when it's done.
+//
+// The reply is built on the calling thread, then handed to the main context that the handle was created on, which sends it. So
+// the main loop only ever does the cheap part, and a slow read never blocks anything else.
+//
+// Handles are cheap to copy (so they can be captured by value in lambdas) and only the first reply through any copy counts. If
+// the last copy goes away without a reply, the method call is answered with an error rather than being left hanging until the
+// caller times out.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <atomic>
+
+#include "DeferredReply.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// A reply on its way to the main context
+struct PendingReply
+{
+	GDBusMethodInvocation *pInvocation;
+	GVariant *pVariant;
+	std::string errorName;
+	std::string errorMessage;
+};
+
+// Sends a reply; called on the main context
+static gboolean sendReply(gpointer pData)
+{
+	PendingReply *pReply = static_cast<PendingReply *>(pData);
+
+	// Either form of reply takes ownership of the invocation
+	if (nullptr != pReply->pVariant)
+	{
+		g_dbus_method_invocation_return_value(pReply->pInvocation, pReply->pVariant);
+		g_variant_unref(pReply->pVariant);
+	}
+	else
+	{
+		g_dbus_method_invocation_return_dbus_error(pReply->pInvocation, pReply->errorName.c_str(), pReply->errorMessage.c_str());
+	}
+
+	delete pReply;
+	return G_SOURCE_REMOVE;
+}
+
+// Hands a reply off to the main context
+static void handOff(GMainContext *pContext, GDBusMethodInvocation *pInvocation, GVariant *pVariant, const char *pErrorName, const char *pErrorMessage)
+{
+	PendingReply *pReply = new PendingReply;
+	pReply->pInvocation = pInvocation;
+	pReply->pVariant = pVariant;
+	pReply->errorName = nullptr == pErrorName ? "" : pErrorName;
+	pReply->errorMessage = nullptr == pErrorMessage ? "" : pErrorMessage;
+
+	// If we're already on the main context, this sends the reply immediately
+	g_main_context_invoke_full(pContext, G_PRIORITY_DEFAULT, sendReply, pReply, nullptr);
+}
+
+// The state shared between copies of a handle
+struct DeferredReply::State
+{
+	GDBusMethodInvocation *pInvocation;
+	GMainContext *pContext;
+	std::atomic<bool> replied;
+
+	State(GDBusMethodInvocation *pInvocation)
+	: pInvocation(pInvocation), pContext(g_main_context_ref_thread_default()), replied(false)
+	{
+	}
+
+	~State()
+	{
+		if (!replied.exchange(true))
+		{
+			Logger::warn(SSTR << "Deferred reply to '" << g_dbus_method_invocation_get_method_name(pInvocation) << "' was abandoned");
+			handOff(pContext, pInvocation, nullptr, "org.bluez.Error.Failed", "No reply");
+		}
+
+		g_main_context_unref(pContext);
+	}
+};
+
+// The handle whose method handler is running on this thread (see `findCurrent()`)
+static thread_local const DeferredReply *pCurrentReply = nullptr;
+
+// Construct an empty handle, which can't be replied to
+DeferredReply::DeferredReply()
+{
+}
+
+// Construct a handle that takes ownership of a method call's invocation
+//
+// This must be called on the thread running the server's main loop (typically from within a method handler.) Replies are
+// delivered on that thread's main context, whichever thread they are made from.
+DeferredReply::DeferredReply(GDBusMethodInvocation *pInvocation)
+: pState(nullptr == pInvocation ? nullptr : std::make_shared<State>(pInvocation))
+{
+}
+
+// Returns true if this handle refers to a method call that has not yet been replied to
+bool DeferredReply::isPending() const
+{
+	return nullptr != pState && !pState->replied;
+}
+
+// Replies to the method call with a GVariant, optionally wrapping it in a tuple (as required by ReadValue)
+//
+// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+bool DeferredReply::returnVariant(GVariant *pVariant, bool wrapInTuple) const
+{
+	if (wrapInTuple)
+	{
+		pVariant = g_variant_new_tuple(&pVariant, 1);
+	}
+
+	return complete(g_variant_ref_sink(pVariant), nullptr, nullptr);
+}
+
+// Replies to the method call with the contents of a `GBytes` buffer, without copying it
+//
+// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+bool DeferredReply::returnBytes(GBytes *pBytes, bool wrapInTuple) const
+{
+	return returnVariant(Utils::gvariantFromBytes(pBytes), wrapInTuple);
+}
+
+// Replies to the method call with `count` bytes copied from `pBytes`
+//
+// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+bool DeferredReply::returnBytes(const guint8 *pBytes, size_t count, bool wrapInTuple) const
+{
+	GBytes *pGbytes = g_bytes_new(pBytes, count);
+	bool result = returnBytes(pGbytes, wrapInTuple);
+	g_bytes_unref(pGbytes);
+	return result;
+}
+
+// Replies to the method call with a D-Bus error (such as "org.bluez.Error.Failed")
+//
+// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+bool DeferredReply::returnError(const std::string &errorName, const std::string &errorMessage) const
+{
+	return complete(nullptr, errorName.c_str(), errorMessage.c_str());
+}
+
+// Returns the handle for `pInvocation` if its handler is running on this thread with its replies deferred, otherwise nullptr
+//
+// This is how handlers running on the worker pool (see `GattCharacteristic::offloadToPool()`) can keep using
+// `methodReturnValue()` and friends: those methods look up the handle here and reply through it.
+const DeferredReply *DeferredReply::findCurrent(GDBusMethodInvocation *pInvocation)
+{
+	if (nullptr == pCurrentReply || nullptr == pCurrentReply->pState || pCurrentReply->pState->pInvocation != pInvocation)
+	{
+		return nullptr;
+	}
+
+	return pCurrentReply;
+}
+
+// Sets the handle returned by `findCurrent()` on this thread (or clears it, with nullptr)
+void DeferredReply::setCurrent(const DeferredReply *pReply)
+{
+	pCurrentReply = pReply;
+}
+
+// Hands the reply off to the main context. Takes ownership of `pVariant` (if any.)
+bool DeferredReply::complete(GVariant *pVariant, const char *pErrorName, const char *pErrorMessage) const
+{
+	if (nullptr == pState || pState->replied.exchange(true))
+	{
+		Logger::warn("Ignoring reply to a method call that has already been replied to");
+		if (nullptr != pVariant)
+		{
+			g_variant_unref(pVariant);
+		}
+
+		return false;
+	}
+
+	handOff(pState->pContext, pState->pInvocation, pVariant, pErrorName, pErrorMessage);
+	return true;
+}
+
+}; // namespace ggk
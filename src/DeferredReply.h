@@ -0,0 +1,99 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A handle for answering a D-Bus method call later, from any thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of DeferredReply.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <gio/gio.h>
+#include <string>
+#include <memory>
+
+#include "Utils.h"
+
+namespace ggk {
+
+struct DeferredReply
+{
+	// Construct an empty handle, which can't be replied to
+	DeferredReply();
+
+	// Construct a handle that takes ownership of a method call's invocation
+	//
+	// This must be called on the thread running the server's main loop (typically from within a method handler.) Replies are
+	// delivered on that thread's main context, whichever thread they are made from.
+	explicit DeferredReply(GDBusMethodInvocation *pInvocation);
+
+	// Returns true if this handle refers to a method call
+	bool isValid() const { return nullptr != pState; }
+
+	// Returns true if this handle refers to a method call that has not yet been replied to
+	bool isPending() const;
+
+	// Replies to the method call with a GVariant, optionally wrapping it in a tuple (as required by ReadValue)
+	//
+	// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+	bool returnVariant(GVariant *pVariant, bool wrapInTuple = false) const;
+
+	// Replies to the method call with one of the common types supported by `Utils::gvariantFromByteArray()`
+	//
+	// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+	template<typename T>
+	bool returnValue(T value, bool wrapInTuple = false) const
+	{
+		return returnVariant(Utils::gvariantFromByteArray(value), wrapInTuple);
+	}
+
+	// Replies to the method call with the contents of a `GBytes` buffer, without copying it
+	//
+	// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+	bool returnBytes(GBytes *pBytes, bool wrapInTuple = false) const;
+
+	// Replies to the method call with `count` bytes copied from `pBytes`
+	//
+	// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+	bool returnBytes(const guint8 *pBytes, size_t count, bool wrapInTuple = false) const;
+
+	// Replies to the method call with a D-Bus error (such as "org.bluez.Error.Failed")
+	//
+	// Returns false if there was nothing to reply to (the handle is empty or has already been replied to)
+	bool returnError(const std::string &errorName, const std::string &errorMessage) const;
+
+	// Returns the handle for `pInvocation` if its handler is running on this thread with its replies deferred, otherwise nullptr
+	//
+	// This is how handlers running on the worker pool (see `GattCharacteristic::offloadToPool()`) can keep using
+	// `methodReturnValue()` and friends: those methods look up the handle here and reply through it.
+	static const DeferredReply *findCurrent(GDBusMethodInvocation *pInvocation);
+
+	// Sets the handle returned by `findCurrent()` on this thread (or clears it, with nullptr)
+	static void setCurrent(const DeferredReply *pReply);
+
+private:
+
+	struct State;
+
+	// Hands the reply off to the main context. Takes ownership of `pVariant` (if any.)
+	bool complete(GVariant *pVariant, const char *pErrorName, const char *pErrorMessage) const;
+
+	// Shared between copies of the handle; the last copy to go away replies with an error if nobody else has
+	std::shared_ptr<State> pState;
+};
+
+}; // namespace ggk
@@ -20,8 +20,17 @@
 // A GATT characteristic is the component within the Bluetooth LE standard that holds and serves data over Bluetooth. This class
 // is intended to be used within the server description. For an explanation of how this class is used, see the detailed discussion
 // in Server.cpp.
+//
+// BlueZ calls StartNotify when the first central subscribes to a characteristic and StopNotify when the last one unsubscribes.
+// We track this for every characteristic (whether or not the server description handles those methods) so that updates to a
+// notifying characteristic nobody is listening to can be skipped before the data getter is called or a GVariant is built. If
+// an update was skipped, the next subscriber is sent the current value as soon as it subscribes. For that to work, BlueZ must be
+// able to call those methods, so a notifiable characteristic describes them on D-Bus even if the server description doesn't.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+#include <string.h>
+#include <memory>
+
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
 #include "GattProperty.h"
@@ -29,10 +38,25 @@
 #include "DBusObject.h"
 #include "GattService.h"
 #include "Utils.h"
+#include "DeferredReply.h"
+#include "WorkerPool.h"
 #include "Logger.h"
 
 namespace ggk {
 
+// Returns true if two notification values have identical raw (serialized) bytes
+static bool isSameNotifyValue(GVariant *pA, GVariant *pB)
+{
+	if (nullptr == pA || nullptr == pB)
+	{
+		return false;
+	}
+
+	gsize size = g_variant_get_size(pA);
+	return size == g_variant_get_size(pB) && g_variant_is_of_type(pB, g_variant_get_type(pA)) &&
+		(0 == size || 0 == memcmp(g_variant_get_data(pA), g_variant_get_data(pB), size));
+}
+
 //
 // Standard constructor
 //
@@ -42,10 +66,31 @@ namespace ggk {
 // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 // in `GattService`.
 GattCharacteristic::GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name)
-: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr)
+: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr), notifyMinIntervalMS(0), notifyOnlyOnChange(false),
+  pLastNotifiedValue(nullptr), lastNotifiedTimeUS(0), pPendingNotifyValue(nullptr), pPendingNotifyConnection(nullptr),
+  pendingNotifyTimerId(0), notifiable(false), notifying(false), updateSkipped(false), notificationCount(0), offloaded(false),
+  dataKey(DataStore::kInvalidKey)
 {
 }
 
+GattCharacteristic::~GattCharacteristic()
+{
+	if (0 != pendingNotifyTimerId)
+	{
+		g_source_remove(pendingNotifyTimerId);
+	}
+
+	if (nullptr != pPendingNotifyValue)
+	{
+		g_variant_unref(pPendingNotifyValue);
+	}
+
+	if (nullptr != pLastNotifiedValue)
+	{
+		g_variant_unref(pLastNotifiedValue);
+	}
+}
+
 // Returning the owner pops us one level up the hierarchy
 //
 // This method compliments `GattService::gattCharacteristicBegin()`
@@ -57,11 +102,23 @@ GattService &GattCharacteristic::gattCharacteristicEnd()
 // Locates a D-Bus method within this D-Bus interface and invokes the method
 bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
+	// We track subscriptions ourselves, whether or not the server description handles these
+	if (methodName == "StartNotify" || methodName == "StopNotify")
+	{
+		handleNotifyMethod(methodName == "StartNotify", methodName, pConnection, pParameters, pInvocation, pUserData);
+		return true;
+	}
+
 	for (const DBusMethod &method : methods)
 	{
 		if (methodName == method.getName())
 		{
-			method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+			bool offloadable = offloaded && (methodName == "ReadValue" || methodName == "WriteValue") && method.getCallback();
+			if (!offloadable || !offloadMethod(method, pConnection, pParameters, pInvocation, pUserData))
+			{
+				method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+			}
+
 			return true;
 		}
 	}
@@ -69,25 +126,234 @@ bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnecti
 	return false;
 }
 
+// Runs this characteristic's ReadValue and WriteValue handlers on the worker pool rather than the main loop, and returns a
+// reference to 'this` to enable method chaining in the server description
+//
+// This is for handlers that do real work (parsing, compressing, encrypting) and would otherwise hold up every other client.
+// Calls to the same characteristic are handled one at a time, in the order they arrived. Handlers reply as usual (through
+// `methodReturnValue()` and friends) and their replies and notifications are handed back to the main loop. Anything else
+// they touch (such as the server data getter and setter) must be safe to use from another thread.
+//
+// See WorkerPool.cpp for details and `ggkSetWorkerPool()` to size the pool.
+GattCharacteristic &GattCharacteristic::offloadToPool()
+{
+	offloaded = true;
+	return *this;
+}
+
+// Backs this characteristic with a value in the server's built-in data store, and returns a reference to 'this` to enable
+// method chaining in the server description
+//
+// Every write to the key (from any thread, through the store or `setDataValue()` and friends) notifies subscribers of the new
+// value, so the application doesn't need to call `ggkNofifyUpdatedCharacteristic()`. If the characteristic has no
+// `onUpdatedValue()` callback, the notification carries the stored value's raw bytes, read straight from the store. This
+// requires the server to be using the built-in data store (see DataStore.cpp.)
+GattCharacteristic &GattCharacteristic::bindData(const char *pName)
+{
+	dataKey = DataStore::intern(pName);
+	if (DataStore::kInvalidKey == dataKey)
+	{
+		Logger::warn(SSTR << "Unable to bind characteristic '" << getName() << "' to data '" << (nullptr == pName ? "" : pName) << "'");
+	}
+
+	return *this;
+}
+
+// Backs this characteristic with a value in the server's built-in data store, by a key that has already been interned (see
+// `DataStore::intern()`)
+GattCharacteristic &GattCharacteristic::bindData(DataStore::Key key)
+{
+	dataKey = key;
+	if (DataStore::kInvalidKey == dataKey)
+	{
+		Logger::warn(SSTR << "Unable to bind characteristic '" << getName() << "' to an invalid data key");
+	}
+
+	return *this;
+}
+
+// Submits a method call to the worker pool (see `offloadToPool()`)
+//
+// Returns false if the pool isn't available, in which case the caller should run the method itself.
+bool GattCharacteristic::offloadMethod(const DBusMethod &method, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+{
+	// The pool is only started once somebody needs it
+	if (!WorkerPool::start())
+	{
+		return false;
+	}
+
+	// The job holds on to everything it needs; the reply handle takes ownership of the invocation
+	DeferredReply reply(pInvocation);
+	std::shared_ptr<GVariant> parameters(g_variant_ref(pParameters), g_variant_unref);
+	std::shared_ptr<GDBusConnection> connection(static_cast<GDBusConnection *>(g_object_ref(pConnection)), g_object_unref);
+	const DBusMethod *pMethod = &method;
+
+	bool submitted = WorkerPool::submit(this, [this, pMethod, reply, parameters, connection, pInvocation, pUserData]()
+	{
+		DeferredReply::setCurrent(&reply);
+		pMethod->call<GattCharacteristic>(connection.get(), getPath(), getName(), pMethod->getName(), parameters.get(), pInvocation, pUserData);
+		DeferredReply::setCurrent(nullptr);
+	});
+
+	if (!submitted)
+	{
+		Logger::warn(SSTR << "Worker pool is full, refusing " << method.getName() << " on '" << getPath() << "'");
+		reply.returnError("org.bluez.Error.InProgress", "Server busy");
+	}
+
+	return true;
+}
+
+// Handles BlueZ's StartNotify and StopNotify calls, which tell us when the first central subscribes and the last one leaves
+//
+// Any method the server description added for these is called as well.
+void GattCharacteristic::handleNotifyMethod(bool start, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+{
+	bool wasNotifying = notifying.exchange(start);
+	if (wasNotifying != start)
+	{
+		Logger::debug(SSTR << (start ? "Central subscribed to" : "Last central unsubscribed from") << " characteristic at path '" << getPath() << "'");
+	}
+
+	bool handled = false;
+	for (const DBusMethod &method : methods)
+	{
+		if (methodName == method.getName())
+		{
+			method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
+			handled = true;
+			break;
+		}
+	}
+
+	if (!handled)
+	{
+		g_dbus_method_invocation_return_value(pInvocation, nullptr);
+	}
+
+	// If we skipped any updates while nobody was listening, bring the new subscriber up to date
+	if (start && updateSkipped)
+	{
+		updateSkipped = false;
+		callOnUpdatedValue(pConnection, pUserData);
+	}
+}
+
+// Returns the StartNotify and StopNotify methods that a notifiable characteristic needs but the server description didn't add
+//
+// These are only used to describe the characteristic; calls to them are handled by `handleNotifyMethod()`.
+std::vector<DBusMethod> GattCharacteristic::getImplicitNotifyMethods() const
+{
+	static const char *kNoArgs[] = { nullptr };
+	static const char *const kNotifyMethodNames[] = { "StartNotify", "StopNotify" };
+
+	std::vector<DBusMethod> implicitMethods;
+	if (!notifiable)
+	{
+		return implicitMethods;
+	}
+
+	for (const char *pName : kNotifyMethodNames)
+	{
+		bool declared = false;
+		for (const DBusMethod &method : methods)
+		{
+			declared = declared || method.getName() == pName;
+		}
+
+		if (!declared)
+		{
+			implicitMethods.push_back(DBusMethod(this, pName, kNoArgs, nullptr, nullptr));
+		}
+	}
+
+	return implicitMethods;
+}
+
+// Internal method used to generate introspection XML used to describe our services on D-Bus
+//
+// This includes StartNotify and StopNotify for a notifiable characteristic (see `generateInterfaceInfo()`.)
+std::string GattCharacteristic::generateIntrospectionXML(int depth) const
+{
+	std::string xml = GattInterface::generateIntrospectionXML(depth);
+
+	// A characteristic always has properties, so the interface element is never empty; our methods go right after it opens
+	size_t bodyStart = xml.find('\n') + 1;
+	for (const DBusMethod &method : getImplicitNotifyMethods())
+	{
+		std::string methodXml = method.generateIntrospectionXML(depth + 1);
+		xml.insert(bodyStart, methodXml);
+		bodyStart += methodXml.length();
+	}
+
+	return xml;
+}
+
+// Internal method used to generate the introspection data used to register our services on D-Bus
+//
+// A notifiable characteristic always has StartNotify and StopNotify methods, even if the server description didn't add them,
+// since that is how we learn about subscribers (see `handleNotifyMethod()`.) GDBus refuses calls to methods that aren't in
+// the introspection data before they reach us.
+//
+// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+GDBusInterfaceInfo *GattCharacteristic::generateInterfaceInfo() const
+{
+	GDBusInterfaceInfo *pInfo = GattInterface::generateInterfaceInfo();
+
+	std::vector<DBusMethod> implicitMethods = getImplicitNotifyMethods();
+	if (implicitMethods.empty())
+	{
+		return pInfo;
+	}
+
+	size_t count = 0;
+	while (nullptr != pInfo->methods[count])
+	{
+		count += 1;
+	}
+
+	GDBusMethodInfo **ppMethods = g_new0(GDBusMethodInfo *, count + implicitMethods.size() + 1);
+	memcpy(ppMethods, pInfo->methods, count * sizeof(GDBusMethodInfo *));
+	for (const DBusMethod &method : implicitMethods)
+	{
+		ppMethods[count++] = method.generateMethodInfo();
+	}
+
+	g_free(pInfo->methods);
+	pInfo->methods = ppMethods;
+	return pInfo;
+}
+
 // Adds an event to the characteristic and returns a refereence to 'this` to enable method chaining in the server description
 //
 // NOTE: We specifically overload this method in order to accept our custom EventCallback type and transform it into a
 // TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
-GattCharacteristic &GattCharacteristic::onEvent(int tickFrequency, void *pUserData, EventCallback callback)
+GattCharacteristic &GattCharacteristic::onEvent(int periodMS, void *pUserData, EventCallback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	events.push_back(TickEvent(this, periodMS, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
 	return *this;
 }
 
-// Ticks events within this characteristic
+// Adds a high-rate event to the characteristic, fired `rateHz` times per second, and returns a reference to 'this` to enable
+// method chaining in the server description
+//
+// Stream events are meant for steady streams of notifications (tens to hundreds per second.) Each one runs on its own
+// timerfd-driven main loop source rather than the timer wheel used by `onEvent()`, and is skipped while nobody is subscribed
+// to the characteristic. See StreamTimers.cpp for details and `ggkGetStreamStats()` for their jitter and missed deadlines.
+GattCharacteristic &GattCharacteristic::onStreamEvent(int rateHz, void *pUserData, EventCallback callback)
+{
+	int periodMS = rateHz > 0 ? 1000 / rateHz : 0;
+	streamEvents.push_back({rateHz, TickEvent(this, periodMS, reinterpret_cast<TickEvent::Callback>(callback), pUserData)});
+	return *this;
+}
+
+// Fires one of this characteristic's events
 //
 // Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-void GattCharacteristic::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+void GattCharacteristic::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
 {
-	for (const TickEvent &event : events)
-	{
-		event.tick<GattCharacteristic>(getPath(), pConnection, pUserData);
-	}
+	event.fire<GattCharacteristic>(getPath(), pConnection, pUserData);
 }
 
 // Specialized support for ReadlValue method
@@ -138,6 +404,26 @@ GattCharacteristic &GattCharacteristic::onUpdatedValue(UpdatedValueCallback call
 	return *this;
 }
 
+// Sets the pacing policy for change notifications sent from this characteristic
+//
+// By default, every call to `sendChangeNotificationVariant()` (and the other `sendChangeNotification...()` methods) emits a
+// `PropertiesChanged` signal. For values that change faster than BlueZ can forward them, those signals simply pile up on the
+// bus. Pacing limits this:
+//
+//     minIntervalMS - Send at most one notification every `minIntervalMS` milliseconds. Values sent more often are not
+//                     queued; the latest value is held back and sent once the interval has passed. Use 0 for no limit.
+//
+//     onlyOnChange  - Only send a notification if the value's raw bytes differ from those of the last value sent.
+//
+// Pacing relies on the server's main loop, so notifications must be sent from the server thread (as is the case for the
+// `onUpdatedValue` and `onEvent` callbacks.)
+GattCharacteristic &GattCharacteristic::notificationPacing(int minIntervalMS, bool onlyOnChange)
+{
+	notifyMinIntervalMS = minIntervalMS < 0 ? 0 : minIntervalMS;
+	notifyOnlyOnChange = onlyOnChange;
+	return *this;
+}
+
 // Calls the onUpdatedValue method, if one was set.
 //
 // Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -157,11 +443,39 @@ GattCharacteristic &GattCharacteristic::onUpdatedValue(UpdatedValueCallback call
 //      })
 bool GattCharacteristic::callOnUpdatedValue(GDBusConnection *pConnection, void *pUserData) const
 {
-	if (nullptr == pOnUpdatedValueFunc)
+	if (nullptr == pOnUpdatedValueFunc && DataStore::kInvalidKey == dataKey)
 	{
 		return false;
 	}
 
+	// Handlers running on the worker pool go through the update queue, so the update is processed on the main loop
+	if (WorkerPool::isWorkerThread())
+	{
+		return ggkNofifyUpdatedCharacteristic(getPath().c_str()) != 0;
+	}
+
+	// Nobody's subscribed, so don't bother fetching the data or building a notification for it
+	if (!wantsUpdates())
+	{
+		Logger::debug(SSTR << "Skipping OnUpdatedValue function for unsubscribed interface at path '" << getPath() << "'");
+		updateSkipped = true;
+		return false;
+	}
+
+	// Without an onUpdatedValue method, we send the value from the data store ourselves
+	if (nullptr == pOnUpdatedValueFunc)
+	{
+		std::string bytes;
+		if (!DataStore::getRaw(dataKey, bytes))
+		{
+			Logger::debug(SSTR << "No stored data to send for interface at path '" << getPath() << "'");
+			return false;
+		}
+
+		sendChangeNotificationVariant(pConnection, Utils::gvariantFromByteArray(bytes));
+		return true;
+	}
+
 	Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
 	return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
@@ -195,20 +509,184 @@ GattDescriptor &GattCharacteristic::gattDescriptorBegin(const std::string &pathE
 	return descriptor;
 }
 
+// Adds a GATT descriptor to the hierarchy from its compile-time description (see GattSchema.h)
+//
+// To end the descriptor, call `gattDescriptorEnd()`
+GattDescriptor &GattCharacteristic::gattDescriptorBegin(const GattSchema::Descriptor &schema)
+{
+	DBusObject &child = owner.addChild(DBusObjectPath(schema.pPathElement));
+	GattDescriptor &descriptor = *child.addInterface(std::make_shared<GattDescriptor>(child, *this, "org.bluez.GattDescriptor1"));
+	descriptor.addProperty<GattDescriptor>("UUID", GattUuid(schema.uuid));
+	descriptor.addProperty<GattDescriptor>("Characteristic", getPath());
+	descriptor.addProperty<GattDescriptor>("Flags", GattSchema::flagsToVariant(schema.flags));
+	return descriptor;
+}
+
 // Sends a change notification to subscribers to this characteristic
 //
 // This is a generalized method that accepts a `GVariant *`. A templated version is available that supports common types called
 // `sendChangeNotificationValue()`.
 //
+// Notifications are subject to the characteristic's pacing policy (see `notificationPacing()`).
+//
 // The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
 // active connections before sending a change notification.
 void GattCharacteristic::sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const
 {
+	// Handlers running on the worker pool hand their notifications to the main loop
+	if (WorkerPool::isWorkerThread())
+	{
+		postChangeNotification(pBusConnection, pNewValue);
+		return;
+	}
+
+	// Nobody's subscribed, so there's nobody to tell
+	if (!wantsUpdates())
+	{
+		g_variant_unref(g_variant_ref_sink(pNewValue));
+		updateSkipped = true;
+		return;
+	}
+
+	// Without a pacing policy, every value goes straight out
+	if (0 == notifyMinIntervalMS && !notifyOnlyOnChange)
+	{
+		emitChangeNotification(pBusConnection, pNewValue);
+		return;
+	}
+
+	// We may hold on to this value, so take ownership of it
+	pNewValue = g_variant_ref_sink(pNewValue);
+
+	// If a value is already being held back, the new value simply replaces it (it will be checked for changes when it's sent)
+	if (0 != pendingNotifyTimerId)
+	{
+		g_variant_unref(pPendingNotifyValue);
+		pPendingNotifyValue = pNewValue;
+		pPendingNotifyConnection = pBusConnection;
+		return;
+	}
+
+	if (notifyOnlyOnChange && isSameNotifyValue(pLastNotifiedValue, pNewValue))
+	{
+		g_variant_unref(pNewValue);
+		return;
+	}
+
+	gint64 elapsedMS = (g_get_monotonic_time() - lastNotifiedTimeUS) / 1000;
+	if (0 == lastNotifiedTimeUS || elapsedMS >= notifyMinIntervalMS)
+	{
+		emitChangeNotification(pBusConnection, pNewValue);
+		g_variant_unref(pNewValue);
+		return;
+	}
+
+	// Too soon - hold on to the value until the interval has passed
+	pPendingNotifyValue = pNewValue;
+	pPendingNotifyConnection = pBusConnection;
+	pendingNotifyTimerId = g_timeout_add(static_cast<guint>(notifyMinIntervalMS - elapsedMS), onPacedNotificationTimer, const_cast<GattCharacteristic *>(this));
+}
+
+// A change notification on its way from a worker thread to the main loop
+struct PostedChangeNotification
+{
+	const GattCharacteristic *pCharacteristic;
+	GDBusConnection *pBusConnection;
+	GVariant *pNewValue;
+};
+
+// Hands a change notification from a worker thread to the main loop
+void GattCharacteristic::postChangeNotification(GDBusConnection *pBusConnection, GVariant *pNewValue) const
+{
+	PostedChangeNotification *pPosted = new PostedChangeNotification;
+	pPosted->pCharacteristic = this;
+	pPosted->pBusConnection = static_cast<GDBusConnection *>(g_object_ref(pBusConnection));
+	pPosted->pNewValue = g_variant_ref_sink(pNewValue);
+
+	g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, [](gpointer pData) -> gboolean
+	{
+		PostedChangeNotification *pPosted = static_cast<PostedChangeNotification *>(pData);
+		pPosted->pCharacteristic->sendChangeNotificationVariant(pPosted->pBusConnection, pPosted->pNewValue);
+		g_variant_unref(pPosted->pNewValue);
+		g_object_unref(pPosted->pBusConnection);
+		delete pPosted;
+		return G_SOURCE_REMOVE;
+	}, pPosted, nullptr);
+}
+
+// Emits a change notification immediately, bypassing the pacing policy
+void GattCharacteristic::emitChangeNotification(GDBusConnection *pBusConnection, GVariant *pNewValue) const
+{
+	// Remember when (and, if we're looking for changes, what) we last sent
+	if (0 != notifyMinIntervalMS || notifyOnlyOnChange)
+	{
+		lastNotifiedTimeUS = g_get_monotonic_time();
+
+		if (notifyOnlyOnChange)
+		{
+			GVariant *pPrevious = pLastNotifiedValue;
+			pLastNotifiedValue = g_variant_ref_sink(pNewValue);
+			if (nullptr != pPrevious)
+			{
+				g_variant_unref(pPrevious);
+			}
+		}
+	}
+
 	g_auto(GVariantBuilder) builder;
 	g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
 	g_variant_builder_add(&builder, "{sv}", "Value", pNewValue);
 	GVariant *pSasv = g_variant_new("(sa{sv})", "org.bluez.GattCharacteristic1", &builder);
 	owner.emitSignal(pBusConnection, "org.freedesktop.DBus.Properties", "PropertiesChanged", pSasv);
+
+	notificationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Sends the notification held back by the pacing policy (if any); called from a main loop timer
+gboolean GattCharacteristic::onPacedNotificationTimer(gpointer pCharacteristic)
+{
+	const GattCharacteristic &self = *static_cast<const GattCharacteristic *>(pCharacteristic);
+
+	GVariant *pValue = self.pPendingNotifyValue;
+	self.pPendingNotifyValue = nullptr;
+	self.pendingNotifyTimerId = 0;
+
+	if (nullptr != pValue)
+	{
+		if (!self.notifyOnlyOnChange || !isSameNotifyValue(self.pLastNotifiedValue, pValue))
+		{
+			self.emitChangeNotification(self.pPendingNotifyConnection, pValue);
+		}
+
+		g_variant_unref(pValue);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+// Sends a change notification to subscribers to this characteristic
+//
+// This form wraps a `GBytes` buffer without copying it, which is the cheapest way to send large or frequent values. The
+// notification holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+//
+// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
+// active connections before sending a change notification.
+void GattCharacteristic::sendChangeNotificationBytes(GDBusConnection *pBusConnection, GBytes *pBytes) const
+{
+	sendChangeNotificationVariant(pBusConnection, Utils::gvariantFromBytes(pBytes));
+}
+
+// Sends a change notification to subscribers to this characteristic
+//
+// This form copies `count` bytes from `pBytes` exactly once.
+//
+// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
+// active connections before sending a change notification.
+void GattCharacteristic::sendChangeNotificationBytes(GDBusConnection *pBusConnection, const guint8 *pBytes, size_t count) const
+{
+	GBytes *pGbytes = g_bytes_new(pBytes, count);
+	sendChangeNotificationBytes(pBusConnection, pGbytes);
+	g_bytes_unref(pGbytes);
 }
 
 }; // namespace ggk
\ No newline at end of file
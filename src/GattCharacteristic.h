@@ -26,10 +26,13 @@
 #include <gio/gio.h>
 #include <string>
 #include <list>
+#include <vector>
+#include <atomic>
 
 #include "Utils.h"
 #include "TickEvent.h"
 #include "GattInterface.h"
+#include "DataStore.h"
 #include "HciAdapter.h"
 
 namespace ggk {
@@ -92,7 +95,12 @@ struct GattCharacteristic : GattInterface
 	// Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 	// in `GattService`.
 	GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name);
-	virtual ~GattCharacteristic() {}
+	virtual ~GattCharacteristic();
+
+	// Characteristics own references to GVariants and a pending main loop timer that points back at them, so they can't be
+	// copied (they live in their owner's list of interfaces, which holds them by pointer)
+	GattCharacteristic(const GattCharacteristic &) = delete;
+	GattCharacteristic &operator =(const GattCharacteristic &) = delete;
 
 	// Returns a string identifying the type of interface
 	virtual const std::string getInterfaceType() const { return GattCharacteristic::kInterfaceType; }
@@ -109,12 +117,60 @@ struct GattCharacteristic : GattInterface
 	//
 	// NOTE: We specifically overload this method in order to accept our custom EventCallback type and transform it into a
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
-	GattCharacteristic &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
+	GattCharacteristic &onEvent(int periodMS, void *pUserData, EventCallback callback);
 
-	// Ticks events within this characteristic
+	// Fires one of this characteristic's events
 	//
 	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
+
+	// A high-rate event (see `onStreamEvent()`)
+	struct StreamEvent
+	{
+		int rateHz;
+		TickEvent event;
+	};
+
+	// Adds a high-rate event to the characteristic, fired `rateHz` times per second, and returns a reference to 'this` to enable
+	// method chaining in the server description
+	//
+	// Stream events are meant for steady streams of notifications (tens to hundreds per second.) Each one runs on its own
+	// timerfd-driven main loop source rather than the timer wheel used by `onEvent()`, and is skipped while nobody is subscribed
+	// to the characteristic. See StreamTimers.cpp for details and `ggkGetStreamStats()` for their jitter and missed deadlines.
+	GattCharacteristic &onStreamEvent(int rateHz, void *pUserData, EventCallback callback);
+
+	// Returns the stream events added to this characteristic (see `onStreamEvent()`)
+	const std::list<StreamEvent> &getStreamEvents() const { return streamEvents; }
+
+	// Runs this characteristic's ReadValue and WriteValue handlers on the worker pool rather than the main loop, and returns a
+	// reference to 'this` to enable method chaining in the server description
+	//
+	// This is for handlers that do real work (parsing, compressing, encrypting) and would otherwise hold up every other client.
+	// Calls to the same characteristic are handled one at a time, in the order they arrived. Handlers reply as usual (through
+	// `methodReturnValue()` and friends) and their replies and notifications are handed back to the main loop. Anything else
+	// they touch (such as the server data getter and setter) must be safe to use from another thread.
+	//
+	// See WorkerPool.cpp for details and `ggkSetWorkerPool()` to size the pool.
+	GattCharacteristic &offloadToPool();
+
+	// Returns true if this characteristic's handlers run on the worker pool (see `offloadToPool()`)
+	bool isOffloadedToPool() const { return offloaded; }
+
+	// Backs this characteristic with a value in the server's built-in data store, and returns a reference to 'this` to enable
+	// method chaining in the server description
+	//
+	// Every write to the key (from any thread, through the store or `setDataValue()` and friends) notifies subscribers of the new
+	// value, so the application doesn't need to call `ggkNofifyUpdatedCharacteristic()`. If the characteristic has no
+	// `onUpdatedValue()` callback, the notification carries the stored value's raw bytes, read straight from the store. This
+	// requires the server to be using the built-in data store (see DataStore.cpp.)
+	GattCharacteristic &bindData(const char *pName);
+
+	// Backs this characteristic with a value in the server's built-in data store, by a key that has already been interned (see
+	// `DataStore::intern()`)
+	GattCharacteristic &bindData(DataStore::Key key);
+
+	// Returns the data store key backing this characteristic (see `bindData()`), or DataStore::kInvalidKey if it isn't bound
+	DataStore::Key getDataKey() const { return dataKey; }
 
 	// Specialized support for Characteristic ReadlValue method
 	//
@@ -151,7 +207,8 @@ struct GattCharacteristic : GattInterface
 
 	// Calls the onUpdatedValue method, if one was set.
 	//
-	// Returns false if there was no method set, otherwise, returns the boolean result of the method call.
+	// Returns false if there was no method set, otherwise, returns the boolean result of the method call. A characteristic backed
+	// by the data store (see `bindData()`) without an onUpdatedValue method sends its stored value instead.
 	//
 	// If you need to perform the same action(s) when a value is updated from the client (via onWriteValue) or from this server,
 	// then it may be beneficial to place those actions in the `onUpdatedValue` method and call it from from within your
@@ -168,6 +225,60 @@ struct GattCharacteristic : GattInterface
 	//      })
 	bool callOnUpdatedValue(GDBusConnection *pConnection, void *pUserData) const;
 
+	// Sets the pacing policy for change notifications sent from this characteristic
+	//
+	// By default, every call to `sendChangeNotificationVariant()` (and the other `sendChangeNotification...()` methods) emits a
+	// `PropertiesChanged` signal. For values that change faster than BlueZ can forward them, those signals simply pile up on the
+	// bus. Pacing limits this:
+	//
+	//     minIntervalMS - Send at most one notification every `minIntervalMS` milliseconds. Values sent more often are not
+	//                     queued; the latest value is held back and sent once the interval has passed. Use 0 for no limit.
+	//
+	//     onlyOnChange  - Only send a notification if the value's raw bytes differ from those of the last value sent.
+	//
+	// Pacing relies on the server's main loop, so notifications must be sent from the server thread (as is the case for the
+	// `onUpdatedValue` and `onEvent` callbacks.)
+	GattCharacteristic &notificationPacing(int minIntervalMS, bool onlyOnChange = false);
+
+	// Marks the characteristic as able to send notifications or indications
+	//
+	// This is called by `GattService::gattCharacteristicBegin()` based on the characteristic's flags ("notify" or "indicate".)
+	void setNotifiable(bool newNotifiable) { notifiable = newNotifiable; }
+
+	// Returns true if the characteristic is able to send notifications or indications
+	bool isNotifiable() const { return notifiable; }
+
+	// Returns true if a central has subscribed to this characteristic (BlueZ has called StartNotify and not yet StopNotify)
+	//
+	// This method is thread-safe.
+	bool isNotifying() const { return notifying; }
+
+	// Returns true if updates to this characteristic's value are of interest to anybody
+	//
+	// Updates to a notifiable characteristic that nobody has subscribed to are skipped by the server (see `callOnUpdatedValue()`
+	// and `sendChangeNotificationVariant()`.) Characteristics that can't notify always want their updates, since their
+	// `onUpdatedValue` callbacks may do other work.
+	bool wantsUpdates() const { return !notifiable || notifying; }
+
+	// Returns the number of notifications (or indications) sent for this characteristic
+	//
+	// This method is thread-safe.
+	uint64_t getNotificationCount() const { return notificationCount.load(std::memory_order_relaxed); }
+
+	// Internal method used to generate introspection XML used to describe our services on D-Bus
+	//
+	// This includes StartNotify and StopNotify for a notifiable characteristic (see `generateInterfaceInfo()`.)
+	virtual std::string generateIntrospectionXML(int depth) const;
+
+	// Internal method used to generate the introspection data used to register our services on D-Bus
+	//
+	// A notifiable characteristic always has StartNotify and StopNotify methods, even if the server description didn't add them,
+	// since that is how we learn about subscribers (see `handleNotifyMethod()`.) GDBus refuses calls to methods that aren't in
+	// the introspection data before they reach us.
+	//
+	// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
+
 	// Convenience functions to add a GATT descriptor to the hierarchy
 	//
 	// We simply add a new child at the given path and add an interface configured as a GATT descriptor to it. The
@@ -188,11 +299,18 @@ struct GattCharacteristic : GattInterface
 	// To end the descriptor, call `gattDescriptorEnd()`
 	GattDescriptor &gattDescriptorBegin(const std::string &pathElement, const GattUuid &uuid, const std::vector<const char *> &flags);
 
+	// Adds a GATT descriptor to the hierarchy from its compile-time description (see GattSchema.h)
+	//
+	// To end the descriptor, call `gattDescriptorEnd()`
+	GattDescriptor &gattDescriptorBegin(const GattSchema::Descriptor &schema);
+
 	// Sends a change notification to subscribers to this characteristic
 	//
 	// This is a generalized method that accepts a `GVariant *`. A templated version is available that supports common types called
 	// `sendChangeNotificationValue()`.
 	//
+	// Notifications are subject to the characteristic's pacing policy (see `notificationPacing()`).
+	//
 	// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
 	// active connections before sending a change notification.
 	void sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
@@ -211,10 +329,83 @@ struct GattCharacteristic : GattInterface
 		sendChangeNotificationVariant(pBusConnection, pVariant);
 	}
 
+	// Sends a change notification to subscribers to this characteristic
+	//
+	// This form wraps a `GBytes` buffer without copying it, which is the cheapest way to send large or frequent values. The
+	// notification holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+	//
+	// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
+	// active connections before sending a change notification.
+	void sendChangeNotificationBytes(GDBusConnection *pBusConnection, GBytes *pBytes) const;
+
+	// Sends a change notification to subscribers to this characteristic
+	//
+	// This form copies `count` bytes from `pBytes` exactly once.
+	//
+	// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
+	// active connections before sending a change notification.
+	void sendChangeNotificationBytes(GDBusConnection *pBusConnection, const guint8 *pBytes, size_t count) const;
+
 protected:
 
+	// Emits a change notification immediately, bypassing the pacing policy
+	void emitChangeNotification(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
+
+	// Sends the notification held back by the pacing policy (if any); called from a main loop timer
+	static gboolean onPacedNotificationTimer(gpointer pCharacteristic);
+
+	// Submits a method call to the worker pool (see `offloadToPool()`)
+	//
+	// Returns false if the pool isn't available, in which case the caller should run the method itself.
+	bool offloadMethod(const DBusMethod &method, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+
+	// Hands a change notification from a worker thread to the main loop
+	void postChangeNotification(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
+
+	// Handles BlueZ's StartNotify and StopNotify calls, which tell us when the first central subscribes and the last one leaves
+	//
+	// Any method the server description added for these is called as well.
+	void handleNotifyMethod(bool start, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+
+	// Returns the StartNotify and StopNotify methods that a notifiable characteristic needs but the server description didn't add
+	//
+	// These are only used to describe the characteristic; calls to them are handled by `handleNotifyMethod()`.
+	std::vector<DBusMethod> getImplicitNotifyMethods() const;
+
 	GattService &service;
 	UpdatedValueCallback pOnUpdatedValueFunc;
+
+	// Notification pacing policy (see `notificationPacing()`)
+	int notifyMinIntervalMS;
+	bool notifyOnlyOnChange;
+
+	// Notification pacing state, updated as notifications are sent
+	mutable GVariant *pLastNotifiedValue;
+	mutable gint64 lastNotifiedTimeUS;
+	mutable GVariant *pPendingNotifyValue;
+	mutable GDBusConnection *pPendingNotifyConnection;
+	mutable guint pendingNotifyTimerId;
+
+	// True if the characteristic can notify (see `setNotifiable()`)
+	bool notifiable;
+
+	// True while a central is subscribed (see `isNotifying()`)
+	mutable std::atomic<bool> notifying;
+
+	// True if an update was skipped because nobody was subscribed, so the next subscriber should be brought up to date
+	mutable bool updateSkipped;
+
+	// The number of notifications sent (see `getNotificationCount()`)
+	mutable std::atomic<uint64_t> notificationCount;
+
+	// Our high-rate events (see `onStreamEvent()`)
+	std::list<StreamEvent> streamEvents;
+
+	// True if our ReadValue and WriteValue handlers run on the worker pool (see `offloadToPool()`)
+	bool offloaded;
+
+	// The data store key backing this characteristic (see `bindData()`)
+	DataStore::Key dataKey;
 };
 
 }; // namespace ggk
\ No newline at end of file
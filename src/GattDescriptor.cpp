@@ -74,21 +74,18 @@ bool GattDescriptor::callMethod(const std::string &methodName, GDBusConnection *
 //
 // NOTE: We specifically overload this method in order to accept our custom EventCallback type and transform it into a
 // TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
-GattDescriptor &GattDescriptor::onEvent(int tickFrequency, void *pUserData, EventCallback callback)
+GattDescriptor &GattDescriptor::onEvent(int periodMS, void *pUserData, EventCallback callback)
 {
-	events.push_back(TickEvent(this, tickFrequency, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	events.push_back(TickEvent(this, periodMS, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
 	return *this;
 }
 
-// Ticks events within this descriptor
+// Fires one of this descriptor's events
 //
 // Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-void GattDescriptor::tickEvents(GDBusConnection *pConnection, void *pUserData) const
+void GattDescriptor::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
 {
-	for (const TickEvent &event : events)
-	{
-		event.tick<GattDescriptor>(getPath(), pConnection, pUserData);
-	}
+	event.fire<GattDescriptor>(getPath(), pConnection, pUserData);
 }
 
 // Specialized support for ReadlValue method
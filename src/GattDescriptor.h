@@ -109,12 +109,12 @@ struct GattDescriptor : GattInterface
 	//
 	// NOTE: We specifically overload this method in order to accept our custom EventCallback type and transform it into a
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
-	GattDescriptor &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
+	GattDescriptor &onEvent(int periodMS, void *pUserData, EventCallback callback);
 
-	// Ticks events within this descriptor
+	// Fires one of this descriptor's events
 	//
 	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
-	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
 
 	// Specialized support for Descriptor ReadlValue method
 	//
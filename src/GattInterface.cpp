@@ -57,6 +57,13 @@ const std::list<GattProperty> &GattInterface::getProperties() const
 // common types.
 void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVariant *pVariant, bool wrapInTuple) const
 {
+	// Handlers running on the worker pool reply through the main loop
+	if (const DeferredReply *pReply = DeferredReply::findCurrent(pInvocation))
+	{
+		pReply->returnVariant(pVariant, wrapInTuple);
+		return;
+	}
+
 	if (wrapInTuple)
 	{
 		pVariant = g_variant_new_tuple(&pVariant, 1);
@@ -64,6 +71,39 @@ void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVar
 	g_dbus_method_invocation_return_value(pInvocation, pVariant);
 }
 
+// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
+// bytes). This form wraps a `GBytes` buffer without copying it, which is the cheapest way to return large or frequent values.
+//
+// The response holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+void GattInterface::methodReturnBytes(GDBusMethodInvocation *pInvocation, GBytes *pBytes, bool wrapInTuple) const
+{
+	methodReturnVariant(pInvocation, Utils::gvariantFromBytes(pBytes), wrapInTuple);
+}
+
+// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
+// bytes). This form copies `count` bytes from `pBytes` exactly once.
+void GattInterface::methodReturnBytes(GDBusMethodInvocation *pInvocation, const guint8 *pBytes, size_t count, bool wrapInTuple) const
+{
+	GBytes *pGbytes = g_bytes_new(pBytes, count);
+	methodReturnBytes(pInvocation, pGbytes, wrapInTuple);
+	g_bytes_unref(pGbytes);
+}
+
+// Takes ownership of a method call so that it can be replied to later, from any thread
+//
+// A method handler whose data is slow to get can call this, start the work elsewhere and return right away, leaving the main
+// loop free. The reply is made through the returned handle (see DeferredReply.cpp) instead of `methodReturnValue()`.
+DeferredReply GattInterface::deferReply(GDBusMethodInvocation *pInvocation) const
+{
+	// Handlers running on the worker pool already have one
+	if (const DeferredReply *pReply = DeferredReply::findCurrent(pInvocation))
+	{
+		return *pReply;
+	}
+
+	return DeferredReply(pInvocation);
+}
+
 // Locates a `GattProperty` within the interface
 //
 // This method returns a pointer to the property or nullptr if not found
@@ -114,4 +154,23 @@ std::string GattInterface::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to generate the introspection data used to register our services on D-Bus
+//
+// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+GDBusInterfaceInfo *GattInterface::generateInterfaceInfo() const
+{
+	GDBusInterfaceInfo *pInfo = DBusInterface::generateInterfaceInfo();
+
+	// Describe our properties
+	g_free(pInfo->properties);
+	pInfo->properties = g_new0(GDBusPropertyInfo *, getProperties().size() + 1);
+	size_t index = 0;
+	for (const GattProperty &property : getProperties())
+	{
+		pInfo->properties[index++] = property.generatePropertyInfo();
+	}
+
+	return pInfo;
+}
+
 }; // namespace ggk
\ No newline at end of file
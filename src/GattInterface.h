@@ -32,6 +32,8 @@
 #include "GattUuid.h"
 #include "Server.h"
 #include "Utils.h"
+#include "DeferredReply.h"
+#include "DataStore.h"
 
 namespace ggk {
 
@@ -134,6 +136,8 @@ struct GattInterface : DBusInterface
 
 	// Return a data value from the server's registered data getter (GGKServerDataGetter)
 	//
+	// If the server was started without a data getter, the value comes from the built-in data store (see DataStore.cpp.)
+	//
 	// This method is for use with non-pointer types. For pointer types, use `getDataPointer()` instead.
 	//
 	// This method is intended to be used in the server description. An example usage would be:
@@ -142,12 +146,37 @@ struct GattInterface : DBusInterface
 	template<typename T>
 	T getDataValue(const char *pName, const T defaultValue) const
 	{
+		if (nullptr == TheServer->getDataGetter())
+		{
+			return DataStore::getValue<T>(DataStore::find(pName), defaultValue);
+		}
+
 		const void *pData = TheServer->getDataGetter()(pName);
 		return nullptr == pData ? defaultValue : *static_cast<const T *>(pData);
 	}
 
+	// Return a data value by its data store key (see `DataStore::intern()`)
+	//
+	// This reads straight from the built-in data store, without any string lookups. If the server was started with a data getter,
+	// the key's name is passed to it instead.
+	//
+	// This method is for use with non-pointer types. For pointer types, use `getDataPointer()` instead.
+	template<typename T>
+	T getDataValue(DataStore::Key key, const T defaultValue) const
+	{
+		if (nullptr != TheServer->getDataGetter())
+		{
+			return getDataValue<T>(DataStore::getName(key), defaultValue);
+		}
+
+		return DataStore::getValue<T>(key, defaultValue);
+	}
+
 	// Return a data pointer from the server's registered data getter (GGKServerDataGetter)
 	//
+	// If the server was started without a data getter, the value comes from the built-in data store (see DataStore.cpp.) In that
+	// case, the pointer remains valid until the value is next read on the same thread.
+	//
 	// This method is for use with pointer types. For non-pointer types, use `getDataValue()` instead.
 	//
 	// This method is intended to be used in the server description. An example usage would be:
@@ -156,13 +185,38 @@ struct GattInterface : DBusInterface
 	template<typename T>
 	T getDataPointer(const char *pName, const T defaultValue) const
 	{
+		if (nullptr == TheServer->getDataGetter())
+		{
+			return getDataPointer<T>(DataStore::find(pName), defaultValue);
+		}
+
 		const void *pData = TheServer->getDataGetter()(pName);
 		return nullptr == pData ? defaultValue : static_cast<const T>(pData);
 	}
 
+	// Return a data pointer by its data store key (see `DataStore::intern()`)
+	//
+	// This reads straight from the built-in data store, without any string lookups. If the server was started with a data getter,
+	// the key's name is passed to it instead.
+	//
+	// This method is for use with pointer types. For non-pointer types, use `getDataValue()` instead.
+	template<typename T>
+	T getDataPointer(DataStore::Key key, const T defaultValue) const
+	{
+		if (nullptr != TheServer->getDataGetter())
+		{
+			return getDataPointer<T>(DataStore::getName(key), defaultValue);
+		}
+
+		const void *pData = DataStore::getPointer(key);
+		return nullptr == pData ? defaultValue : static_cast<const T>(pData);
+	}
+
 	// Sends a data value from the server back to the application through the server's registered data setter
 	// (GGKServerDataSetter)
 	//
+	// If the server was started without a data setter, the value is stored in the built-in data store (see DataStore.cpp.)
+	//
 	// This method is for use with non-pointer types. For pointer types, use `setDataPointer()` instead.
 	//
 	// This method is intended to be used in the server description. An example usage would be:
@@ -171,12 +225,37 @@ struct GattInterface : DBusInterface
 	template<typename T>
 	bool setDataValue(const char *pName, const T value) const
 	{
+		if (nullptr == TheServer->getDataSetter())
+		{
+			return DataStore::setValue<T>(DataStore::find(pName), value);
+		}
+
 		return TheServer->getDataSetter()(pName, static_cast<const void *>(&value)) != 0;
 	}
 
+	// Sends a data value by its data store key (see `DataStore::intern()`)
+	//
+	// This writes straight to the built-in data store. If the server was started with a data setter, the key's name is passed to
+	// it instead.
+	//
+	// This method is for use with non-pointer types. For pointer types, use `setDataPointer()` instead.
+	template<typename T>
+	bool setDataValue(DataStore::Key key, const T value) const
+	{
+		if (nullptr != TheServer->getDataSetter())
+		{
+			return setDataValue<T>(DataStore::getName(key), value);
+		}
+
+		return DataStore::setValue<T>(key, value);
+	}
+
 	// Sends a data pointer from the server back to the application through the server's registered data setter
 	// (GGKServerDataSetter)
 	//
+	// If the server was started without a data setter, the pointer is taken to be a null-terminated string and a copy is stored in
+	// the built-in data store (see DataStore.cpp.)
+	//
 	// This method is for use with pointer types. For non-pointer types, use `setDataValue()` instead.
 	//
 	// This method is intended to be used in the server description. An example usage would be:
@@ -185,9 +264,31 @@ struct GattInterface : DBusInterface
 	template<typename T>
 	bool setDataPointer(const char *pName, const T pointer) const
 	{
+		if (nullptr == TheServer->getDataSetter())
+		{
+			return DataStore::setString(DataStore::find(pName), reinterpret_cast<const char *>(pointer));
+		}
+
 		return TheServer->getDataSetter()(pName, static_cast<const void *>(pointer)) != 0;
 	}
 
+	// Sends a data pointer by its data store key (see `DataStore::intern()`)
+	//
+	// This stores a copy of the null-terminated string straight into the built-in data store. If the server was started with a
+	// data setter, the key's name is passed to it instead.
+	//
+	// This method is for use with pointer types. For non-pointer types, use `setDataValue()` instead.
+	template<typename T>
+	bool setDataPointer(DataStore::Key key, const T pointer) const
+	{
+		if (nullptr != TheServer->getDataSetter())
+		{
+			return setDataPointer<T>(DataStore::getName(key), pointer);
+		}
+
+		return DataStore::setString(key, reinterpret_cast<const char *>(pointer));
+	}
+
 	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
 	// bytes). This method will simplify this slightly by wrapping a GVariant of the type "ay" and wrapping it in a tuple before
 	// sending it off as the method response.
@@ -209,6 +310,22 @@ struct GattInterface : DBusInterface
 		methodReturnVariant(pInvocation, pVariant, wrapInTuple);
 	}
 
+	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
+	// bytes). This form wraps a `GBytes` buffer without copying it, which is the cheapest way to return large or frequent values.
+	//
+	// The response holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+	void methodReturnBytes(GDBusMethodInvocation *pInvocation, GBytes *pBytes, bool wrapInTuple = false) const;
+
+	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
+	// bytes). This form copies `count` bytes from `pBytes` exactly once.
+	void methodReturnBytes(GDBusMethodInvocation *pInvocation, const guint8 *pBytes, size_t count, bool wrapInTuple = false) const;
+
+	// Takes ownership of a method call so that it can be replied to later, from any thread
+	//
+	// A method handler whose data is slow to get can call this, start the work elsewhere and return right away, leaving the main
+	// loop free. The reply is made through the returned handle (see DeferredReply.cpp) instead of `methodReturnValue()`.
+	DeferredReply deferReply(GDBusMethodInvocation *pInvocation) const;
+
 	// Locates a `GattProperty` within the interface
 	//
 	// This method returns a pointer to the property or nullptr if not found
@@ -217,6 +334,11 @@ struct GattInterface : DBusInterface
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	virtual std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to generate the introspection data used to register our services on D-Bus
+	//
+	// The caller owns the returned reference and must release it with `g_dbus_interface_info_unref()`
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
+
 protected:
 
 	std::list<GattProperty> properties;
@@ -26,6 +26,7 @@
 
 #include "Utils.h"
 #include "GattProperty.h"
+#include "ServerUtils.h"
 
 namespace ggk {
 
@@ -34,10 +35,37 @@ namespace ggk {
 // In general, properties should not be constructed directly as properties are typically instanticated by adding them to to an
 // interface using one of the the interface's `addProperty` methods.
 GattProperty::GattProperty(const std::string &name, GVariant *pValue, GDBusInterfaceGetPropertyFunc getter, GDBusInterfaceSetPropertyFunc setter)
-: name(name), pValue(pValue), getterFunc(getter), setterFunc(setter)
+: name(name), pValue(nullptr == pValue ? nullptr : g_variant_ref_sink(pValue)), getterFunc(getter), setterFunc(setter)
 {
 }
 
+// Copies share the value, each holding its own reference
+GattProperty::GattProperty(const GattProperty &other)
+: name(other.name), pValue(nullptr == other.pValue ? nullptr : g_variant_ref(other.pValue)), getterFunc(other.getterFunc),
+  setterFunc(other.setterFunc)
+{
+}
+
+// Copies share the value, each holding its own reference
+GattProperty &GattProperty::operator =(const GattProperty &other)
+{
+	// Take the new reference first, in case we are assigned to ourselves
+	GVariant *pOldValue = pValue;
+	pValue = nullptr == other.pValue ? nullptr : g_variant_ref(other.pValue);
+	if (nullptr != pOldValue) { g_variant_unref(pOldValue); }
+
+	name = other.name;
+	getterFunc = other.getterFunc;
+	setterFunc = other.setterFunc;
+	return *this;
+}
+
+// Releases our reference to the value
+GattProperty::~GattProperty()
+{
+	if (nullptr != pValue) { g_variant_unref(pValue); }
+}
+
 //
 // Name
 //
@@ -74,7 +102,13 @@ const GVariant *GattProperty::getValue() const
 // interface's `addProperty` methods.
 GattProperty &GattProperty::setValue(GVariant *pValue)
 {
-	this->pValue = pValue;
+	// Take the new reference first, in case the new value is the one we already hold
+	GVariant *pOldValue = this->pValue;
+	this->pValue = nullptr == pValue ? nullptr : g_variant_ref_sink(pValue);
+	if (nullptr != pOldValue) { g_variant_unref(pOldValue); }
+
+	// The cached `GetManagedObjects` reply includes our value
+	ServerUtils::invalidateManagedObjects();
 	return *this;
 }
 
@@ -176,4 +210,18 @@ std::string GattProperty::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to generate the introspection data used to register our services on D-Bus
+//
+// The caller owns the returned reference and must release it with `g_dbus_property_info_unref()`
+GDBusPropertyInfo *GattProperty::generatePropertyInfo() const
+{
+	GDBusPropertyInfo *pInfo = g_new0(GDBusPropertyInfo, 1);
+	pInfo->ref_count = 1;
+	pInfo->name = g_strdup(getName().c_str());
+	pInfo->signature = g_strdup(g_variant_get_type_string(const_cast<GVariant *>(getValue())));
+	pInfo->flags = G_DBUS_PROPERTY_INFO_FLAGS_READABLE;
+	pInfo->annotations = g_new0(GDBusAnnotationInfo *, 1);
+	return pInfo;
+}
+
 }; // namespace ggk
\ No newline at end of file
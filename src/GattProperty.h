@@ -38,6 +38,13 @@ struct GattProperty
 	// interface using one of the the interface's `addProperty` methods.
 	GattProperty(const std::string &name, GVariant *pValue, GDBusInterfaceGetPropertyFunc getter = nullptr, GDBusInterfaceSetPropertyFunc setter = nullptr);
 
+	// Copies share the value, each holding its own reference
+	GattProperty(const GattProperty &other);
+	GattProperty &operator =(const GattProperty &other);
+
+	// Releases our reference to the value
+	~GattProperty();
+
 	//
 	// Name
 	//
@@ -89,6 +96,11 @@ struct GattProperty
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to generate the introspection data used to register our services on D-Bus
+	//
+	// The caller owns the returned reference and must release it with `g_dbus_property_info_unref()`
+	GDBusPropertyInfo *generatePropertyInfo() const;
+
 private:
 
 	std::string name;
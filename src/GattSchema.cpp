@@ -0,0 +1,123 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A compile-time description of the static layout of GATT services, characteristics and descriptors
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The server description (see Server.cpp) mixes two kinds of information: the static layout of each service (path elements,
+// UUIDs and flags) and the behavior attached to it (the lambdas.) The behavior has to be built at runtime, but the layout is
+// known when the server is compiled. Written as strings, it was also checked only at runtime: every UUID was cleaned and
+// re-dashed on startup, and a UUID with a missing digit became an empty UUID that only BlueZ would complain about.
+//
+// A `GattSchema::Service`, `Characteristic` or `Descriptor` holds the static layout of one entry. Their constructors are
+// constexpr, so an entry declared constexpr is built entirely by the compiler and lives in read-only data:
+//
+//     * UUIDs are parsed into 128-bit values. A UUID may be written as 4, 8 or 32 hex digits, with or without dashes. 16- and
+//       32-bit UUIDs are expanded with the Bluetooth Base UUID.
+//
+//     * Flags are bitsets of `GattSchema::Flag`, rather than lists of strings. Descriptors only accept the flags that BlueZ
+//       allows on descriptors.
+//
+//     * Path elements are checked against the characters D-Bus allows in an object path.
+//
+// Anything that fails a check ends up calling one of the `invalid...()` methods, which are not constexpr. In a constexpr entry,
+// that is a compile error naming the method (and therefore the problem), pointing at the offending entry. The methods are still
+// defined, so an entry built at runtime from bad input logs an error instead, and ends up with a nil UUID.
+//
+// Entries are passed to the same `gattServiceBegin()`, `gattCharacteristicBegin()` and `gattDescriptorBegin()` methods as the
+// string forms, which remain available.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "GattSchema.h"
+#include "Logger.h"
+
+namespace ggk {
+
+constexpr uint64_t GattSchema::kBaseUuidHigh;
+constexpr uint64_t GattSchema::kBaseUuidLow;
+
+// The BlueZ name of each flag, in bit order
+static const char *const kFlagNames[] =
+{
+	"broadcast",
+	"read",
+	"write-without-response",
+	"write",
+	"notify",
+	"indicate",
+	"authenticated-signed-writes",
+	"reliable-write",
+	"writable-auxiliaries",
+	"encrypt-read",
+	"encrypt-write",
+	"encrypt-authenticated-read",
+	"encrypt-authenticated-write",
+	"secure-read",
+	"secure-write"
+};
+
+static const int kFlagCount = sizeof(kFlagNames) / sizeof(kFlagNames[0]);
+
+// Returns the flags as an array of strings ("as"), in the form BlueZ expects for the "Flags" property
+GVariant *GattSchema::flagsToVariant(uint32_t flags)
+{
+	GVariantBuilder builder;
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("as"));
+
+	for (int bit = 0; bit < kFlagCount; ++bit)
+	{
+		if ((flags & (1u << bit)) != 0)
+		{
+			g_variant_builder_add(&builder, "s", kFlagNames[bit]);
+		}
+	}
+
+	return g_variant_builder_end(&builder);
+}
+
+// Returns the BlueZ name of a single flag (such as "read"), or nullptr if `flag` is not exactly one flag
+const char *GattSchema::flagName(uint32_t flag)
+{
+	for (int bit = 0; bit < kFlagCount; ++bit)
+	{
+		if (flag == (1u << bit))
+		{
+			return kFlagNames[bit];
+		}
+	}
+
+	return nullptr;
+}
+
+const char *GattSchema::invalidUuid(const char *pUuid)
+{
+	Logger::error(SSTR << "Invalid GATT UUID '" << pUuid << "' (must be 4, 8 or 32 hex digits); using the nil UUID");
+	return "00000000000000000000000000000000";
+}
+
+const char *GattSchema::invalidPathElement(const char *pPathElement)
+{
+	Logger::error(SSTR << "Invalid path element '" << pPathElement << "' (must be one or more of [A-Za-z0-9_])");
+	return pPathElement;
+}
+
+uint32_t GattSchema::invalidFlags(uint32_t flags)
+{
+	Logger::error(SSTR << "Invalid GATT flags 0x" << std::hex << flags << " for this kind of attribute");
+	return flags;
+}
+
+}; // namespace ggk
@@ -0,0 +1,220 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A compile-time description of the static layout of GATT services, characteristics and descriptors
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of GattSchema.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <glib.h>
+#include <stdint.h>
+
+namespace ggk {
+
+struct GattSchema
+{
+	// GATT flags, one bit each (see the list in `GattService::gattCharacteristicBegin()`)
+	enum Flag
+	{
+		EBroadcast = 1 << 0,
+		ERead = 1 << 1,
+		EWriteWithoutResponse = 1 << 2,
+		EWrite = 1 << 3,
+		ENotify = 1 << 4,
+		EIndicate = 1 << 5,
+		EAuthenticatedSignedWrites = 1 << 6,
+		EReliableWrite = 1 << 7,
+		EWritableAuxiliaries = 1 << 8,
+		EEncryptRead = 1 << 9,
+		EEncryptWrite = 1 << 10,
+		EEncryptAuthenticatedRead = 1 << 11,
+		EEncryptAuthenticatedWrite = 1 << 12,
+		ESecureRead = 1 << 13,
+		ESecureWrite = 1 << 14,
+
+		// Every flag a characteristic may have
+		ECharacteristicFlags = (1 << 15) - 1,
+
+		// Every flag a descriptor may have
+		EDescriptorFlags = ERead | EWrite | EEncryptRead | EEncryptWrite | EEncryptAuthenticatedRead | EEncryptAuthenticatedWrite |
+			ESecureRead | ESecureWrite
+	};
+
+	// A UUID, as a 128-bit value
+	//
+	// `bitCount` is the length of the form it was written in (16, 32 or 128), which is the form it is displayed in.
+	struct Uuid
+	{
+		uint64_t high;
+		uint64_t low;
+		int bitCount;
+
+		// Parses a UUID written as 4, 8 or 32 hex digits (optionally separated by dashes)
+		//
+		// 16- and 32-bit UUIDs are expanded with the Bluetooth Base UUID. When the result is constexpr, a string that isn't a
+		// valid UUID is a compile error.
+		constexpr Uuid(const char *pUuid)
+		: high(parseHigh(checkUuid(pUuid))), low(parseLow(validUuid(pUuid))), bitCount(isUuid(pUuid) ? digitCount(pUuid) * 4 : 0)
+		{
+		}
+	};
+
+	// A service's path element and UUID
+	struct Service
+	{
+		const char *pPathElement;
+		Uuid uuid;
+
+		constexpr Service(const char *pPathElement, const char *pUuid)
+		: pPathElement(checkPathElement(pPathElement)), uuid(pUuid)
+		{
+		}
+	};
+
+	// A characteristic's path element, UUID and flags
+	struct Characteristic
+	{
+		const char *pPathElement;
+		Uuid uuid;
+		uint32_t flags;
+
+		constexpr Characteristic(const char *pPathElement, const char *pUuid, uint32_t flags)
+		: pPathElement(checkPathElement(pPathElement)), uuid(pUuid), flags(checkFlags(flags, ECharacteristicFlags))
+		{
+		}
+	};
+
+	// A descriptor's path element, UUID and flags
+	struct Descriptor
+	{
+		const char *pPathElement;
+		Uuid uuid;
+		uint32_t flags;
+
+		constexpr Descriptor(const char *pPathElement, const char *pUuid, uint32_t flags)
+		: pPathElement(checkPathElement(pPathElement)), uuid(pUuid), flags(checkFlags(flags, EDescriptorFlags))
+		{
+		}
+	};
+
+	// The Bluetooth Base UUID (00000000-0000-1000-8000-00805f9b34fb), into which 16- and 32-bit UUIDs are inserted
+	static constexpr uint64_t kBaseUuidHigh = 0x0000000000001000ULL;
+	static constexpr uint64_t kBaseUuidLow = 0x800000805f9b34fbULL;
+
+	// Returns the flags as an array of strings ("as"), in the form BlueZ expects for the "Flags" property
+	static GVariant *flagsToVariant(uint32_t flags);
+
+	// Returns the BlueZ name of a single flag (such as "read"), or nullptr if `flag` is not exactly one flag
+	static const char *flagName(uint32_t flag);
+
+	//
+	// Compile-time checks
+	//
+	// The constructors above run these on every entry. Each one either returns its input or calls one of the `invalid...()`
+	// methods, which are deliberately not constexpr: in a constexpr entry, the call is a compile error that names the problem.
+	//
+
+	static constexpr bool isHexDigit(char c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+	}
+
+	static constexpr uint64_t hexValue(char c)
+	{
+		return c <= '9' ? c - '0' : c <= 'F' ? c - 'A' + 10 : c - 'a' + 10;
+	}
+
+	// Returns the number of hex digits in a UUID (plus `count`), or -1 if it contains anything other than hex digits and dashes
+	static constexpr int digitCount(const char *pUuid, int count = 0)
+	{
+		return *pUuid == 0 ? count :
+			isHexDigit(*pUuid) ? digitCount(pUuid + 1, count + 1) :
+			*pUuid == '-' ? digitCount(pUuid + 1, count) :
+			-1;
+	}
+
+	// Accumulates `count` hex digits of a UUID (skipping dashes) onto `value`
+	static constexpr uint64_t accumulate(const char *pUuid, int count, uint64_t value)
+	{
+		return count == 0 ? value :
+			*pUuid == '-' ? accumulate(pUuid + 1, count, value) :
+			accumulate(pUuid + 1, count - 1, (value << 4) | hexValue(*pUuid));
+	}
+
+	// Returns a UUID with its first `count` hex digits (and any dashes among them) skipped
+	static constexpr const char *skipDigits(const char *pUuid, int count)
+	{
+		return count == 0 ? pUuid :
+			*pUuid == '-' ? skipDigits(pUuid + 1, count) :
+			skipDigits(pUuid + 1, count - 1);
+	}
+
+	static constexpr uint64_t parseHigh(const char *pUuid)
+	{
+		return digitCount(pUuid) == 32 ? accumulate(pUuid, 16, 0) : (accumulate(pUuid, digitCount(pUuid), 0) << 32) | kBaseUuidHigh;
+	}
+
+	static constexpr uint64_t parseLow(const char *pUuid)
+	{
+		return digitCount(pUuid) == 32 ? accumulate(skipDigits(pUuid, 16), 16, 0) : kBaseUuidLow;
+	}
+
+	static constexpr bool isUuid(const char *pUuid)
+	{
+		return digitCount(pUuid) == 4 || digitCount(pUuid) == 8 || digitCount(pUuid) == 32;
+	}
+
+	// Returns the UUID if it is valid, otherwise the nil UUID
+	static constexpr const char *validUuid(const char *pUuid)
+	{
+		return isUuid(pUuid) ? pUuid : "00000000000000000000000000000000";
+	}
+
+	static constexpr const char *checkUuid(const char *pUuid)
+	{
+		return isUuid(pUuid) ? pUuid : invalidUuid(pUuid);
+	}
+
+	// D-Bus object path elements may only contain [A-Za-z0-9_]
+	static constexpr bool isPathCharacter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	static constexpr bool isPathElement(const char *pPathElement)
+	{
+		return *pPathElement == 0 || (isPathCharacter(*pPathElement) && isPathElement(pPathElement + 1));
+	}
+
+	static constexpr const char *checkPathElement(const char *pPathElement)
+	{
+		return *pPathElement != 0 && isPathElement(pPathElement) ? pPathElement : invalidPathElement(pPathElement);
+	}
+
+	static constexpr uint32_t checkFlags(uint32_t flags, uint32_t allowed)
+	{
+		return (flags & ~allowed) == 0 ? flags : invalidFlags(flags);
+	}
+
+	static const char *invalidUuid(const char *pUuid);
+	static const char *invalidPathElement(const char *pPathElement);
+	static uint32_t invalidFlags(uint32_t flags);
+};
+
+}; // namespace ggk
@@ -26,6 +26,7 @@
 #include <gio/gio.h>
 #include <string>
 #include <list>
+#include <string.h>
 
 #include "GattService.h"
 #include "GattInterface.h"
@@ -81,6 +82,29 @@ GattCharacteristic &GattService::gattCharacteristicBegin(const std::string &path
 	characteristic.addProperty<GattCharacteristic>("UUID", uuid);
 	characteristic.addProperty<GattCharacteristic>("Service", owner.getPath());
 	characteristic.addProperty<GattCharacteristic>("Flags", flags);
+
+	for (const char *pFlag : flags)
+	{
+		if (0 == strcmp(pFlag, "notify") || 0 == strcmp(pFlag, "indicate"))
+		{
+			characteristic.setNotifiable(true);
+		}
+	}
+
+	return characteristic;
+}
+
+// Adds a GATT characteristic to the hierarchy from its compile-time description (see GattSchema.h)
+//
+// To end the characteristic, call `gattCharacteristicEnd()`
+GattCharacteristic &GattService::gattCharacteristicBegin(const GattSchema::Characteristic &schema)
+{
+	DBusObject &child = owner.addChild(DBusObjectPath(schema.pPathElement));
+	GattCharacteristic &characteristic = *child.addInterface(std::make_shared<GattCharacteristic>(child, *this, "org.bluez.GattCharacteristic1"));
+	characteristic.addProperty<GattCharacteristic>("UUID", GattUuid(schema.uuid));
+	characteristic.addProperty<GattCharacteristic>("Service", owner.getPath());
+	characteristic.addProperty<GattCharacteristic>("Flags", GattSchema::flagsToVariant(schema.flags));
+	characteristic.setNotifiable((schema.flags & (GattSchema::ENotify | GattSchema::EIndicate)) != 0);
 	return characteristic;
 }
 
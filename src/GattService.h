@@ -86,6 +86,11 @@ struct GattService : GattInterface
 	//
 	GattCharacteristic &gattCharacteristicBegin(const std::string &pathElement, const GattUuid &uuid, const std::vector<const char *> &flags);
 
+	// Adds a GATT characteristic to the hierarchy from its compile-time description (see GattSchema.h)
+	//
+	// To end the characteristic, call `gattCharacteristicEnd()`
+	GattCharacteristic &gattCharacteristicBegin(const GattSchema::Characteristic &schema);
+
 	// Returns a string identifying the type of interface
 	virtual const std::string getInterfaceType() const { return GattService::kInterfaceType; }
 };
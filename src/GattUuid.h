@@ -47,80 +47,62 @@
 //
 // By represetng a UUID in a custom class like this, we are able to give a UUID its own type, and use type safety to ensure that we
 // don't confuse regular strings with GATT UUIDs throughout the codebase.
+//
+// Internally, a GattUuid is its 128-bit value (two 64-bit halves), the bit count it was created with and whether it is based on
+// the Base UUID (so it has a 16- or 32-bit short form.) Comparing or hashing UUIDs only looks at the value and whether the UUID is
+// valid, so UUIDs can key containers cheaply, and "180A" equals "0000180a-0000-1000-8000-00805f9b34fb". An invalid UUID has a
+// value of zero but is never equal to the (valid) nil UUID "00000000-0000-0000-0000-000000000000". The string forms are rendered
+// from the value when asked for; the full form is kept once rendered, since it is the one asked for repeatedly (for D-Bus
+// properties.) The rendered string is not guarded, so a GattUuid that is shared between threads should be rendered before it is
+// shared.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #pragma once
 
 #include <string>
-#include <algorithm>
+#include <functional>
 #include <stdint.h>
-#include <ctype.h>
+#include <string.h>
 
 #include <iostream>
 #include "Logger.h"
+#include "GattSchema.h"
 
 namespace ggk {
 
 // "0000180A-0000-1000-8000-00805f9b34fb"
 struct GattUuid
 {
-	static constexpr const char *kGattStandardUuidPart1Prefix = "0000";
-	static constexpr const char *kGattStandardUuidSuffix = "-0000-1000-8000-00805f9b34fb";
-
 	// Construct a GattUuid from a partial or complete string UUID
 	//
-	// This constructor will do the best it can with the data it is given. It will first clean the input by removing all non-hex
-	// characters (see `clean`) and the remaining characters are processed in the following way:
+	// This constructor will do the best it can with the data it is given. It will skip all non-hex characters in the input and
+	// the remaining characters are processed in the following way:
 	//
 	//     4-character string is treated as a 16-bit UUID
 	//     8-character string is treated as a 32-bit UUID
 	//     32-character string is treated as a 128-bit UUID
 	//
-	// If the input string is not one of the above lengths, the  UUID will be left uninitialized as an empty string with a bit
-	// count of 0.
-	//
-	// Finally, dashes are inserted into the string at the appropriate locations (see `dashify`).
+	// If the input string is not one of the above lengths, the UUID will be invalid (see `isValid()`): an empty string with a
+	// bit count of 0.
 	GattUuid(const char *strUuid)
 	{
-		*this = GattUuid(std::string(strUuid));
+		parse(strUuid, nullptr == strUuid ? 0 : strlen(strUuid));
 	}
 
 	// Construct a GattUuid from a partial or complete string UUID
 	//
-	// This constructor will do the best it can with the data it is given. It will first clean the input by removing all non-hex
-	// characters (see `clean`) and the remaining characters are processed in the following way:
+	// This constructor will do the best it can with the data it is given. It will skip all non-hex characters in the input and
+	// the remaining characters are processed in the following way:
 	//
 	//     4-character string is treated as a 16-bit UUID
 	//     8-character string is treated as a 32-bit UUID
 	//     32-character string is treated as a 128-bit UUID
 	//
-	// If the input string is not one of the above lengths, the  UUID will be left uninitialized as an empty string with a bit
-	// count of 0.
-	//
-	// Finally, dashes are inserted into the string at the appropriate locations (see `dashify`).
-	GattUuid(std::string strUuid)
+	// If the input string is not one of the above lengths, the UUID will be invalid (see `isValid()`): an empty string with a
+	// bit count of 0.
+	GattUuid(const std::string &strUuid)
 	{
-		// Clean the string
-		strUuid = clean(strUuid);
-
-		// It's hex, so each character represents 4 bits
-		bitCount = strUuid.length() * 4;
-
-		if (bitCount == 16)
-		{
-			strUuid = kGattStandardUuidPart1Prefix + strUuid + kGattStandardUuidSuffix;
-		}
-		else if (bitCount == 32)
-		{
-			strUuid += kGattStandardUuidSuffix;
-		}
-		else if (bitCount != 128)
-		{
-			bitCount = 0;
-			strUuid = "";
-		}
-
-		uuid = dashify(strUuid);
+		parse(strUuid.data(), strUuid.length());
 	}
 
 	// Constructs a GattUuid from a 16-bit Uuid value
@@ -132,10 +114,7 @@ struct GattUuid
 	// ...where "????" is replaced by the 4-digit hex value of `part`
 	GattUuid(const uint16_t part)
 	{
-		bitCount = 16;
-		char partStr[5];
-		snprintf(partStr, sizeof(partStr), "%04x", part);
-		uuid = std::string(kGattStandardUuidPart1Prefix) + partStr + kGattStandardUuidSuffix;
+		assign((static_cast<uint64_t>(part) << 32) | GattSchema::kBaseUuidHigh, GattSchema::kBaseUuidLow, 16);
 	}
 
 	// Constructs a GattUuid from a 32-bit Uuid value
@@ -147,10 +126,7 @@ struct GattUuid
 	// ...where "????????" is replaced by the 8-digit hex value of `part`
 	GattUuid(const uint32_t part)
 	{
-		bitCount = 32;
-		char partStr[9];
-		snprintf(partStr, sizeof(partStr), "%08x", part);
-		uuid = std::string(partStr) + kGattStandardUuidSuffix;
+		assign((static_cast<uint64_t>(part) << 32) | GattSchema::kBaseUuidHigh, GattSchema::kBaseUuidLow, 32);
 	}
 
 	// Constructs a GattUuid from a 5-part set of input values
@@ -165,12 +141,15 @@ struct GattUuid
 	// bits ignored.
 	GattUuid(const uint32_t part1, const uint16_t part2, const uint16_t part3, const uint16_t part4, const uint64_t part5)
 	{
-		bitCount = 128;
-		char partsStr[37];
-		uint32_t part5a = (part5 >> 4) & 0xffffffff;
-		uint32_t part5b = part5 & 0xffff;
-		snprintf(partsStr, sizeof(partsStr), "%08x-%04x-%04x-%04x-%08x%04x", part1, part2, part3, part4, part5a, part5b);
-		uuid = std::string(partsStr);
+		uint64_t high = (static_cast<uint64_t>(part1) << 32) | (static_cast<uint64_t>(part2) << 16) | part3;
+		uint64_t low = (static_cast<uint64_t>(part4) << 48) | (part5 & 0xffffffffffffULL);
+		assign(high, low, 128);
+	}
+
+	// Constructs a GattUuid from a UUID that was parsed at compile time (see GattSchema.h)
+	GattUuid(const GattSchema::Uuid &schemaUuid)
+	{
+		assign(schemaUuid.high, schemaUuid.low, schemaUuid.bitCount);
 	}
 
 	// Returns the bit count of the input when the GattUuid was constructed. Valid values are 16, 32, 128.
@@ -181,14 +160,42 @@ struct GattUuid
 		return bitCount;
 	}
 
+	// Returns true if the UUID was created correctly (its bit count is not 0)
+	bool isValid() const
+	{
+		return bitCount != 0;
+	}
+
+	// Returns true if the UUID is based on the Bluetooth Base UUID, and so has a 16- or 32-bit short form (whichever form it was
+	// created with)
+	bool isShortForm() const
+	{
+		return shortForm;
+	}
+
+	// Returns the most significant 64 bits of the UUID (the first 16 hex digits)
+	uint64_t getHigh() const
+	{
+		return high;
+	}
+
+	// Returns the least significant 64 bits of the UUID (the last 16 hex digits)
+	uint64_t getLow() const
+	{
+		return low;
+	}
+
 	// Returns the 16-bit portion of the GATT UUID or an empty string if the GattUuid was not created correctly
 	//
 	// Note that a 16-bit GATT UUID is only valid for standarg GATT UUIDs (prefixed with "0000" and ending with
 	// "0000-1000-8000-00805f9b34fb").
 	std::string toString16() const
 	{
-		if (uuid.empty()) { return uuid; }
-		return uuid.substr(4, 4);
+		if (bitCount == 0) { return std::string(); }
+
+		char str[4];
+		writeHex(str, high >> 32, 4);
+		return std::string(str, sizeof(str));
 	}
 
 	// Returns the 32-bit portion of the GATT UUID or an empty string if the GattUuid was not created correctly
@@ -196,13 +203,34 @@ struct GattUuid
 	// Note that a 32-bit GATT UUID is only valid for standarg GATT UUIDs (ending with "0000-1000-8000-00805f9b34fb").
 	std::string toString32() const
 	{
-		if (uuid.empty()) { return uuid; }
-		return uuid.substr(0, 8);
+		if (bitCount == 0) { return std::string(); }
+
+		char str[8];
+		writeHex(str, high >> 32, 8);
+		return std::string(str, sizeof(str));
 	}
 
 	// Returns the full 128-bit GATT UUID or an empty string if the GattUuid was not created correctly
-	std::string toString128() const
+	//
+	// The string is rendered on the first call and kept for later ones.
+	const std::string &toString128() const
 	{
+		if (uuid.empty() && bitCount != 0)
+		{
+			// xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+			char str[36];
+			writeHex(str, high >> 32, 8);
+			str[8] = '-';
+			writeHex(str + 9, high >> 16, 4);
+			str[13] = '-';
+			writeHex(str + 14, high, 4);
+			str[18] = '-';
+			writeHex(str + 19, low >> 48, 4);
+			str[23] = '-';
+			writeHex(str + 24, low, 12);
+			uuid.assign(str, sizeof(str));
+		}
+
 		return uuid;
 	}
 
@@ -216,61 +244,111 @@ struct GattUuid
 		return toString128();
 	}
 
-	// Returns a new string containing the lower case contents of `strUuid` with all non-hex characters (0-9, A-F) removed
-	static std::string clean(const std::string &strUuid)
+	// Comparisons look only at the 128-bit value and whether the UUID is valid, so the same UUID compares equal whichever form it
+	// was created with. Invalid UUIDs are all equal to each other and order before every valid UUID; valid UUIDs order as their
+	// full string forms would.
+	bool operator ==(const GattUuid &other) const { return isValid() == other.isValid() && high == other.high && low == other.low; }
+	bool operator !=(const GattUuid &other) const { return !(*this == other); }
+	bool operator <(const GattUuid &other) const
 	{
-		if (strUuid.empty()) return strUuid;
-
-		// Lower case
-		std::string cleanStr = strUuid;
-		std::transform(cleanStr.begin(), cleanStr.end(), cleanStr.begin(), ::tolower);
-
-		// Remove all non-hex characters
-		cleanStr.erase
-		(
-			std::remove_if
-			(
-				cleanStr.begin(), 
-				cleanStr.end(),
-				[](char c)
-				{
-					return !((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'));
-				}
-			), cleanStr.end()
-		);
-
-		return cleanStr;
+		if (isValid() != other.isValid()) { return other.isValid(); }
+		return high < other.high || (high == other.high && low < other.low);
 	}
+	bool operator >(const GattUuid &other) const { return other < *this; }
+	bool operator <=(const GattUuid &other) const { return !(other < *this); }
+	bool operator >=(const GattUuid &other) const { return !(*this < other); }
 
-	// Returns a clean string (see `clean`) that has dashes ('-') inserted at the proper locations. If the string is not a full
-	// UUID, this routine will cleanup and add as many dashes as possible until it runs out of characters.
-	//
-	// Example transforms:
-	//
-	//     "0000180A-0000-1000-8000-00805f9b34fb"        -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A00001000800000805f9b34fb"            -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A/0000.1000_zzzzzz_8000+00805f9b34fb" -> "0000180a-0000-1000-8000-00805f9b34fb"
-	//     "0000180A"                                    -> "0000180a"
-	//     "0000180A.0000.100"                           -> "0000180a-0000-100"
-	//     "rqzp"                                        -> ""
-	//
-	static std::string dashify(const std::string &str)
+private:
+
+	// Sets the value, the bit count it was created with (0 if not valid) and whether it has a short form
+	void assign(uint64_t newHigh, uint64_t newLow, int newBitCount)
 	{
-		// Ensure we have a clean string to start with
-		std::string dashed = clean(str);
-
-		// Add each dash, provided there are enough characters
-		if (dashed.length() > 8) { dashed.insert(8, 1, '-'); }
-		if (dashed.length() > 13) { dashed.insert(13, 1, '-'); }
-		if (dashed.length() > 18) { dashed.insert(18, 1, '-'); }
-		if (dashed.length() > 23) { dashed.insert(23, 1, '-'); }
-		return dashed;
+		high = newHigh;
+		low = newLow;
+		bitCount = newBitCount;
+		shortForm = newBitCount != 0 && low == GattSchema::kBaseUuidLow && (high & 0xffffffffULL) == GattSchema::kBaseUuidHigh;
+		uuid.clear();
 	}
 
-private:
+	// Parses `length` characters of a string UUID in a single pass, skipping anything that isn't a hex digit (see the string
+	// constructors)
+	void parse(const char *pStr, size_t length)
+	{
+		uint64_t halves[2] = { 0, 0 };
+		int digitCount = 0;
+		for (size_t i = 0; i < length; ++i)
+		{
+			char c = pStr[i];
+			if (!GattSchema::isHexDigit(c))
+			{
+				continue;
+			}
+
+			if (digitCount < 32)
+			{
+				halves[digitCount / 16] = (halves[digitCount / 16] << 4) | GattSchema::hexValue(c);
+			}
+
+			++digitCount;
+		}
+
+		if (digitCount == 4 || digitCount == 8)
+		{
+			assign((halves[0] << 32) | GattSchema::kBaseUuidHigh, GattSchema::kBaseUuidLow, digitCount * 4);
+		}
+		else if (digitCount == 32)
+		{
+			assign(halves[0], halves[1], 128);
+		}
+		else
+		{
+			assign(0, 0, 0);
+		}
+	}
 
-	std::string uuid;
+	// Writes the lowest `digitCount` hex digits of `value` to `pStr` (in lower case, without a terminator)
+	static void writeHex(char *pStr, uint64_t value, int digitCount)
+	{
+		static const char kHexDigits[] = "0123456789abcdef";
+		for (int i = digitCount - 1; i >= 0; --i)
+		{
+			pStr[i] = kHexDigits[value & 0xf];
+			value >>= 4;
+		}
+	}
+
+	// The 128-bit value
+	uint64_t high;
+	uint64_t low;
+
+	// The bit count the UUID was created with (16, 32 or 128), or 0 if it was not created correctly
 	int bitCount;
+
+	// True if the value is based on the Bluetooth Base UUID
+	bool shortForm;
+
+	// The full string form, rendered on first use (see `toString128()`)
+	mutable std::string uuid;
+};
+
+}; // namespace ggk
+
+namespace std {
+
+// Hashes a GattUuid by its 128-bit value and validity (consistent with `GattUuid::operator ==`), so UUIDs can key unordered
+// containers
+template<>
+struct hash<ggk::GattUuid>
+{
+	size_t operator()(const ggk::GattUuid &uuid) const
+	{
+		// Standard UUIDs only differ in a few bits of the high half, so mix everything into every bit of the result
+		uint64_t value = uuid.getHigh() ^ (uuid.getLow() * 0x9e3779b97f4a7c15ULL) ^ (uuid.isValid() ? 0 : 0xc2b2ae3d27d4eb4fULL);
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		return static_cast<size_t>(value);
+	}
 };
 
-}; // namespace ggk
\ No newline at end of file
+}; // namespace std
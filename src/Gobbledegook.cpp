@@ -38,12 +38,18 @@
 #include <string>
 #include <thread>
 #include <memory>
-#include <deque>
-#include <mutex>
 
 #include "Init.h"
 #include "Logger.h"
 #include "Server.h"
+#include "UpdateQueue.h"
+#include "HciAdapter.h"
+#include "ConnectionTable.h"
+#include "DataStore.h"
+#include "StreamTimers.h"
+#include "WorkerPool.h"
+#include "ShmDataPlane.h"
+#include "GattCharacteristic.h"
 
 namespace ggk
 {
@@ -64,11 +70,6 @@ namespace ggk
 	static GPrintFunc printerrHandlerGLib;
 	static GLogFunc logHandlerGLib;
 
-	// Our update queue
-	typedef std::tuple<std::string, std::string> QueueEntry;
-	std::deque<QueueEntry> updateQueue;
-	std::mutex updateQueueMutex;
-
 	// Internal method to set the run state of the server
 	void setServerRunState(GGKServerRunState newState)
 	{
@@ -105,6 +106,87 @@ void ggkLogRegisterFatal(GGKLogReceiver receiver) { Logger::registerFatalReceive
 void ggkLogRegisterTrace(GGKLogReceiver receiver) { Logger::registerTraceReceiver(receiver); }
 void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysReceiver(receiver); }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____        _                _
+// |  _ \  __ _| |_ __ _     ___| |_ ___  _ __ ___
+// | | | |/ _` | __/ _` |   / __| __/ _ \| '__/ _ )
+// | |_| | (_| | || (_| |   \__ \ || (_) | | |  __/
+// |____/ \__,_|\__\__,_|   |___/\__\___/|_|  \___|
+//
+// The server's built-in data store (see DataStore.cpp), for applications that don't provide their own data getter and setter.
+// These methods are thread-safe.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the key for a name (such as "battery/level"), adding it to the store if it isn't already there
+//
+// Returns the key (a non-negative value) on success or -1 on failure (the name is null or the store is full.)
+int ggkDataStoreIntern(const char *pName)
+{
+	return DataStore::intern(pName);
+}
+
+// Stores a fixed-size value (such as an integer or a small struct) of up to 16 bytes
+//
+// Returns non-zero value on success or 0 on failure (the key is not valid, pData is null or the size is out of range.)
+int ggkDataStoreSetValue(int key, const void *pData, int size)
+{
+	if (size <= 0) { return 0; }
+
+	return DataStore::storeValue(key, pData, static_cast<size_t>(size)) ? 1 : 0;
+}
+
+// Retrieves a fixed-size value stored with `ggkDataStoreSetValue()` into `pData`
+//
+// Returns non-zero value on success or 0 on failure (the key is not valid, pData is null, or the value was not stored with the
+// same size.)
+int ggkDataStoreGetValue(int key, void *pData, int size)
+{
+	if (size <= 0) { return 0; }
+
+	return DataStore::loadValue(key, pData, static_cast<size_t>(size)) ? 1 : 0;
+}
+
+// Stores a copy of a variable-size value (such as a blob)
+//
+// Returns non-zero value on success or 0 on failure (the key is not valid or pData is null.)
+int ggkDataStoreSetBytes(int key, const void *pData, int size)
+{
+	if (nullptr == pData || size < 0) { return 0; }
+
+	return DataStore::setBytes(key, pData, static_cast<size_t>(size)) ? 1 : 0;
+}
+
+// Stores a copy of a null-terminated string
+//
+// Returns non-zero value on success or 0 on failure (the key is not valid or pString is null.)
+int ggkDataStoreSetString(int key, const char *pString)
+{
+	return DataStore::setString(key, pString) ? 1 : 0;
+}
+
+// Copies up to `bufferSize` bytes of a value stored with `ggkDataStoreSetBytes()` or `ggkDataStoreSetString()` into `pBuffer`
+//
+// Strings are not null-terminated in the buffer. Returns the full size of the value (which may be larger than `bufferSize`)
+// or -1 on failure (the key is not valid or nothing has been stored.)
+int ggkDataStoreGetBytes(int key, void *pBuffer, int bufferSize)
+{
+	if (bufferSize < 0) { return -1; }
+
+	return DataStore::getBytes(key, pBuffer, static_cast<size_t>(bufferSize));
+}
+
+// Enables (non-zero) or disables (0) the shared-memory data plane, which is disabled by default
+//
+// When enabled, the data of each characteristic that is bound to the data store (see `bindData()` in Server.cpp) lives in a
+// shared memory segment, where producers in other processes can publish it directly using include/GobbledegookShm.h. Reads
+// and writes through the methods above keep working as before.
+//
+// This must be called before `ggkStart()`.
+void ggkSetSharedDataPlane(int enabled)
+{
+	ShmDataPlane::setEnabled(enabled != 0);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  _   _           _       _                                                                                                     _
 // | | | |_ __   __| | __ _| |_ ___     __ _ _   _  ___ _   _  ___    _ __ ___   __ _ _ __   __ _  __ _  ___ _ __ ___   ___ _ __ | |_
@@ -133,17 +215,101 @@ int ggkNofifyUpdatedDescriptor(const char *pObjectPath)
 	return ggkPushUpdateQueue(pObjectPath, "org.bluez.GattDescriptor1") != 0;
 }
 
+// Returns 1 if a central has subscribed to notifications (or indications) from the characteristic at the given object path,
+// otherwise 0
+//
+// Updates to a notifying characteristic that nobody has subscribed to are skipped by the server without calling the data
+// getter, so applications that produce data on a timer can use this to skip the work of producing it as well. When a central
+// subscribes, the server brings it up to date with the characteristic's current value.
+int ggkIsCharacteristicNotifying(const char *pObjectPath)
+{
+	if (nullptr == TheServer || nullptr == pObjectPath)
+	{
+		return 0;
+	}
+
+	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(DBusObjectPath(pObjectPath), "org.bluez.GattCharacteristic1");
+	if (nullptr == pInterface)
+	{
+		return 0;
+	}
+
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+	return nullptr != pCharacteristic && pCharacteristic->isNotifying() ? 1 : 0;
+}
+
+// Returns the number of notifications (or indications) the server has sent for the characteristic at the given object path,
+// or 0 if there is no such characteristic
+unsigned long long ggkGetNotificationCount(const char *pObjectPath)
+{
+	if (nullptr == TheServer || nullptr == pObjectPath)
+	{
+		return 0;
+	}
+
+	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(DBusObjectPath(pObjectPath), "org.bluez.GattCharacteristic1");
+	if (nullptr == pInterface)
+	{
+		return 0;
+	}
+
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+	return nullptr == pCharacteristic ? 0 : pCharacteristic->getNotificationCount();
+}
+
 // Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
 // `ggkNofifyUpdatedCharacteristic()` instead.
 //
+// The object path and interface name must belong to a characteristic or descriptor in the server's description. The server
+// registers those when it starts; anything else is rejected.
+//
 // Returns non-zero value on success or 0 on failure.
 int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 {
-	QueueEntry t(pObjectPath, pInterfaceName);
+	UpdateQueue::Id id = UpdateQueue::find(pObjectPath, pInterfaceName);
+	if (UpdateQueue::kInvalidId == id)
+	{
+		Logger::warn(SSTR << "Ignoring update for unknown interface: path[" << (nullptr == pObjectPath ? "" : pObjectPath) << "], name[" << (nullptr == pInterfaceName ? "" : pInterfaceName) << "]");
+		return 0;
+	}
 
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.push_front(t);
-	return 1;
+	return ggkPushUpdateQueueById(static_cast<int>(id));
+}
+
+// Returns the update queue ID for the given object path and interface name
+//
+// Pushing updates by ID (see `ggkPushUpdateQueueById()`) skips the lookup of the object path and interface name. As with
+// `ggkPushUpdateQueue()`, the pair must belong to a characteristic or descriptor in the server's description.
+//
+// Returns the ID (a non-negative value) on success or -1 on failure.
+int ggkUpdateQueueGetId(const char *pObjectPath, const char *pInterfaceName)
+{
+	UpdateQueue::Id id = UpdateQueue::find(pObjectPath, pInterfaceName);
+	return UpdateQueue::kInvalidId == id ? -1 : static_cast<int>(id);
+}
+
+// Adds an update to the queue using an ID retrieved from `ggkUpdateQueueGetId()`
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkPushUpdateQueueById(int id)
+{
+	if (id < 0)
+	{
+		return 0;
+	}
+
+	switch(UpdateQueue::push(static_cast<UpdateQueue::Id>(id)))
+	{
+		case UpdateQueue::EAdded:
+			// Let the server thread know there's work to do
+			wakeUpdateQueue();
+			return 1;
+		case UpdateQueue::EMerged:
+			// Merged into an update that's already pending, so the server thread already knows
+			return 1;
+		default:
+			return 0;
+	}
 }
 
 // Get the next update from the back of the queue and returns the element in `element` as a string in the format:
@@ -161,31 +327,19 @@ int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 // Returns 1 on success, 0 if the queue is empty, -1 on error (such as the length too small to store the element)
 int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 {
-	std::string result;
-
+	// The entry is only removed if the resulting string will fit in the caller's buffer
+	UpdateQueue::Entry entry;
+	int result = UpdateQueue::pop(entry, keep != 0, [](const UpdateQueue::Entry &entry, void *pContext) -> bool
 	{
-		std::lock_guard<std::mutex> guard(updateQueueMutex);
+		size_t length = UpdateQueue::getObjectPath(entry.id).length() + 1 + UpdateQueue::getInterfaceName(entry.id).length();
+		return length + 1 <= static_cast<size_t>(*static_cast<int *>(pContext));
+	}, &elementLen);
 
-		// Check for an empty queue
-		if (updateQueue.empty()) { return 0; }
-
-		// Get the last element
-		QueueEntry t = updateQueue.back();
-
-		// Get the result string
-		result = std::get<0>(t) + "|" + std::get<1>(t);
-
-		// Ensure there's enough room for it
-		if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
-
-		if (keep == 0)
-		{
-			updateQueue.pop_back();
-		}
-	}
+	if (result != 1) { return result; }
 
 	// Copy the element string
-	memcpy(pElementBuffer, result.c_str(), result.length() + 1);
+	std::string element = UpdateQueue::getObjectPath(entry.id) + "|" + UpdateQueue::getInterfaceName(entry.id);
+	memcpy(pElementBuffer, element.c_str(), element.length() + 1);
 
 	return 1;
 }
@@ -193,22 +347,142 @@ int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 // Returns 1 if the queue is empty, otherwise 0
 int ggkUpdateQueueIsEmpty()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.empty() ? 1 : 0;
+	return UpdateQueue::isEmpty() ? 1 : 0;
 }
 
 // Returns the number of entries waiting in the queue
 int ggkUpdateQueueSize()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.size();
+	return static_cast<int>(UpdateQueue::size());
 }
 
 // Removes all entries from the queue
 void ggkUpdateQueueClear()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.clear();
+	UpdateQueue::clear();
+}
+
+// Sets the maximum number of queued updates the server will process in a single iteration of its main loop
+//
+// A value of 0 (or less) removes the limit.
+void ggkUpdateQueueSetBatchBudget(int maxEntries)
+{
+	UpdateQueue::setBatchBudget(maxEntries);
+}
+
+// Returns the maximum number of queued updates the server will process in a single iteration of its main loop
+int ggkUpdateQueueGetBatchBudget()
+{
+	return UpdateQueue::getBatchBudget();
+}
+
+// Enables (non-zero) or disables (0) coalescing of pending updates
+//
+// With coalescing enabled, the queue holds at most one pending entry for each (object path, interface) pair.
+void ggkUpdateQueueSetCoalescing(int enabled)
+{
+	UpdateQueue::setCoalescing(enabled != 0);
+}
+
+// Returns 1 if coalescing of pending updates is enabled, otherwise 0
+int ggkUpdateQueueGetCoalescing()
+{
+	return UpdateQueue::getCoalescing() ? 1 : 0;
+}
+
+// Retrieves the current update queue counters into `pStats`
+//
+// Returns non-zero value on success or 0 on failure (`pStats` is null.)
+int ggkUpdateQueueGetStats(struct GGKUpdateQueueStats *pStats)
+{
+	if (nullptr == pStats) { return 0; }
+
+	UpdateQueue::getStats(*pStats);
+	return 1;
+}
+
+// Resets all update queue counters to zero
+void ggkUpdateQueueResetStats()
+{
+	UpdateQueue::resetStats();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//   ____                            _   _
+//  / ___|___  _ __  _ __   ___  ___| |_(_) ___  _ __  ___
+// | |   / _ \| '_ \| '_ \ / _ \/ __| __| |/ _ \| '_ \/ __|
+// | |__| (_) | | | | | | |  __/ (__| |_| | (_) | | | \__ )
+//  \____\___/|_| |_|_| |_|\___|\___|\__|_|\___/|_| |_|___/
+//
+// What we know about the centrals that have connected to us (see ConnectionTable.cpp.) These methods are thread-safe.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the number of centrals the server is tracking, whether they are connected or not
+//
+// For the number of centrals currently connected, see `ggkGetActiveConnectionCount()`.
+int ggkGetTrackedCentralCount()
+{
+	return static_cast<int>(ConnectionTable::size());
+}
+
+// Copies up to `maxConnections` entries into `pConnections`, connected centrals first
+//
+// Returns the number of entries copied
+int ggkGetConnections(struct GGKConnectionInfo *pConnections, int maxConnections)
+{
+	if (nullptr == pConnections || maxConnections <= 0) { return 0; }
+
+	return static_cast<int>(ConnectionTable::getConnections(pConnections, static_cast<size_t>(maxConnections)));
+}
+
+// Retrieves the entry for the central with the given address (in the form "00:11:22:33:44:55") into `pConnection`
+//
+// Returns non-zero value on success or 0 on failure (the central is not known or a parameter is null.)
+int ggkGetConnection(const char *pAddress, struct GGKConnectionInfo *pConnection)
+{
+	if (nullptr == pAddress || nullptr == pConnection) { return 0; }
+
+	// Reuse the device path parser by putting the address in BlueZ's device path form
+	std::string devicePath = std::string("/dev_") + pAddress;
+	for (char &c : devicePath)
+	{
+		if (c == ':') { c = '_'; }
+	}
+
+	ConnectionTable::Key key = ConnectionTable::keyFromDevicePath(devicePath.c_str());
+	if (ConnectionTable::kInvalidKey == key) { return 0; }
+
+	return ConnectionTable::getConnection(key, *pConnection) ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____  _
+// / ___|| |_ _ __ ___  __ _ _ __ ___  ___
+// \___ \| __| '__/ _ \/ _` | '_ ` _ \/ __|
+//  ___) | |_| | |  __/ (_| | | | | | \__ )
+// |____/ \__|_|  \___|\__,_|_| |_| |_|___/
+//
+// Counters for the high-rate stream events in the server description (see StreamTimers.cpp.) These methods are thread-safe.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Retrieves the counters for the stream event on the characteristic at the given object path into `pStats`
+//
+// Returns non-zero value on success or 0 on failure (the characteristic has no running stream or a parameter is null.)
+int ggkGetStreamStats(const char *pObjectPath, struct GGKStreamStats *pStats)
+{
+	if (nullptr == pObjectPath || nullptr == pStats) { return 0; }
+
+	return StreamTimers::getStats(pObjectPath, *pStats) ? 1 : 0;
+}
+
+// Resets the counters for the stream event on the characteristic at the given object path
+//
+// Returns non-zero value on success or 0 on failure (the characteristic has no running stream or the path is null.)
+int ggkResetStreamStats(const char *pObjectPath)
+{
+	if (nullptr == pObjectPath) { return 0; }
+
+	return StreamTimers::resetStats(pObjectPath) ? 1 : 0;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -387,6 +661,59 @@ int ggkWait()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Enables (non-zero) or disables (0) single-threaded HCI mode
+//
+// In single-threaded mode, the HCI socket is watched by the server's main loop rather than a dedicated thread. This must be called
+// before `ggkStart()`.
+//
+// Returns non-zero value on success or 0 on failure (the HCI socket is already in use.)
+int ggkSetSingleThreadedHci(int enabled)
+{
+	return HciAdapter::getInstance().setSingleThreaded(enabled != 0) ? 1 : 0;
+}
+
+// Returns 1 if single-threaded HCI mode is enabled, otherwise 0
+int ggkGetSingleThreadedHci()
+{
+	return HciAdapter::getInstance().isSingleThreaded() ? 1 : 0;
+}
+
+// Sizes the worker pool that runs the handlers of characteristics marked with `offloadToPool()`
+//
+// This must be called before `ggkStart()`. Returns non-zero value on success or 0 on failure (a value is less than 1.)
+int ggkSetWorkerPool(int threadCount, int queueDepth)
+{
+	return WorkerPool::configure(threadCount, queueDepth) ? 1 : 0;
+}
+
+// Selects the Bluetooth adapters that the server registers its GATT application with
+//
+// Bit N of `mask` selects the adapter with controller index N. A mask of 0 (the default) serves only the first adapter found.
+// This must be called before `ggkStart()`.
+void ggkSetAdapterMask(unsigned int mask)
+{
+	setAdapterMask(mask);
+}
+
+// Returns the number of active connections on the adapter with controller index `controllerIndex`, or the total across all
+// adapters if `controllerIndex` is negative
+//
+// Returns -1 if `controllerIndex` is too large to be a controller index
+int ggkGetActiveConnectionCount(int controllerIndex)
+{
+	if (controllerIndex < 0)
+	{
+		return HciAdapter::getInstance().getActiveConnectionCount();
+	}
+
+	if (controllerIndex >= HciAdapter::kNonController)
+	{
+		return -1;
+	}
+
+	return HciAdapter::getInstance().getActiveConnectionCount(static_cast<uint16_t>(controllerIndex));
+}
+
 // Set the server state to 'EInitializing' and then immediately create a server thread and initiate the server's async
 // processing on the server thread.
 //
@@ -406,6 +733,9 @@ int ggkWait()
 // Similarly, the pointer to data returned to the data getter should point to non-volatile memory so that the server can use it
 // safely for an indefinite period of time.
 //
+// A null getter or setter is replaced by the server's built-in data store (see `ggkDataStoreIntern()` and
+// friends.)
+//
 // pServiceName: The name of our server (collectino of services)
 //
 //     !!!IMPORTANT!!!
@@ -40,16 +40,31 @@
 // However, for initialization, it seems to be generally safe to treat them as "nearly 1:1". The solution below is to consume all
 // events and look for the event that we're waiting on. This seems to work in my environment (Raspberry Pi) fairly well, but please
 // do use this with caution.
+//
+// Commands can be pipelined: `submitCommand()` registers each command in a table of pending commands (keyed by controller index
+// and command code) and sends it without waiting. The event thread completes the oldest matching entry as each Command Complete
+// or Command Status event arrives, and callers collect the results with `waitForCommand()`. Since the kernel processes commands in
+// the order they were sent, a series of commands costs about one round trip rather than one round trip per command.
+//
+// SINGLE-THREADED MODE:
+//
+// On embedded targets where cores are scarce, the event thread and its handoffs to the server thread can be avoided altogether
+// (see `setSingleThreaded()`.) The HCI socket is then watched by a GSource on the main context the server thread runs, each event
+// is processed inline as it arrives and commands are completed through callbacks, with their timeouts also run by the main loop.
+// The price is that nothing in this mode may wait on a response, since the wait would keep the main loop from ever reading it.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
 #include <chrono>
 #include <future>
+#include <memory>
+#include <glib-unix.h>
 
 #include "HciAdapter.h"
 #include "HciSocket.h"
 #include "Utils.h"
 #include "Mgmt.h"
+#include "ConnectionTable.h"
 #include "Logger.h"
 
 namespace ggk {
@@ -217,162 +232,268 @@ void HciAdapter::runEventThread()
 
 	while (ggkGetServerRunState() <= ERunning && hciSocket.isConnected())
 	{
-		// Read the next event, waiting until one arrives
-		std::vector<uint8_t> responsePacket = std::vector<uint8_t>();
-		if (!hciSocket.read(responsePacket))
+		// Read the next event, waiting until one arrives (the packet lives in the socket's receive buffer until the next read)
+		const uint8_t *pPacket = nullptr;
+		size_t packetSize = 0;
+		if (!hciSocket.read(pPacket, packetSize))
 		{
 			break;
 		}
 
-		// Do we have enough to check the event code?
-		if (responsePacket.size() < 2)
-		{
-			Logger::error(SSTR << "Invalid command response: too short");
-			continue;
-		}
+		processEvent(pPacket, packetSize);
+	}
 
-		// Our response, as a usable object type
-		uint16_t eventCode = Utils::endianToHost(*reinterpret_cast<uint16_t *>(responsePacket.data()));
+	// Make sure we're disconnected before we leave
+	hciSocket.disconnect();
 
-		// Ensure our event code is valid
-		if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
-		{
-			Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
-			continue;
-		}
+	Logger::trace("Leaving the HciAdapter event thread");
+}
 
-		switch(eventCode)
+// Processes a single event packet received from the adapter
+void HciAdapter::processEvent(const uint8_t *pPacket, size_t packetSize)
+{
+	// Do we have enough to check the event code?
+	if (packetSize < sizeof(HciHeader))
+	{
+		Logger::error(SSTR << "Invalid command response: too short");
+		return;
+	}
+
+	// Our response, as a usable object type
+	uint16_t eventCode = Utils::endianToHost(*reinterpret_cast<const uint16_t *>(pPacket));
+
+	// Ensure our event code is valid
+	if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
+	{
+		Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
+		return;
+	}
+
+	switch(eventCode)
+	{
+		// Command complete event
+		case Mgmt::ECommandCompleteEvent:
 		{
-			// Command complete event
-			case Mgmt::ECommandCompleteEvent:
-			{
-				// Extract our event
-				CommandCompleteEvent event(responsePacket);
+			// Extract our event
+			CommandCompleteEvent event(pPacket);
 
-				// Point to the data following the event
-				uint8_t *data = responsePacket.data() + sizeof(CommandCompleteEvent);
-				size_t dataLen = responsePacket.size() - sizeof(CommandCompleteEvent);
+			// Point to the data following the event
+			const uint8_t *data = pPacket + sizeof(CommandCompleteEvent);
+			size_t dataLen = packetSize - sizeof(CommandCompleteEvent);
 
-				switch(event.commandCode)
+			switch(event.commandCode)
+			{
+				// We just log the version/revision info
+				case Mgmt::EReadVersionInformationCommand:
 				{
-					// We just log the version/revision info
-					case Mgmt::EReadVersionInformationCommand:
+					// Verify the size is what we expect
+					if (dataLen != sizeof(VersionInformation))
 					{
-						// Verify the size is what we expect
-						if (dataLen != sizeof(VersionInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						versionInformation = *reinterpret_cast<VersionInformation *>(data);
-						versionInformation.toHost();
-						Logger::debug(versionInformation.debugText());
-						break;
+						Logger::error("Invalid data length");
+						return;
 					}
-					case Mgmt::EReadControllerInformationCommand:
+
+					versionInformation = *reinterpret_cast<const VersionInformation *>(data);
+					versionInformation.toHost();
+					Logger::debug(versionInformation.debugText());
+					break;
+				}
+				case Mgmt::EReadControllerInformationCommand:
+				{
+					if (dataLen != sizeof(ControllerInformation))
 					{
-						if (dataLen != sizeof(ControllerInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						controllerInformation = *reinterpret_cast<ControllerInformation *>(data);
-						controllerInformation.toHost();
-						Logger::debug(controllerInformation.debugText());
-						break;
+						Logger::error("Invalid data length");
+						return;
 					}
-					case Mgmt::ESetLocalNameCommand:
+
+					std::lock_guard<std::mutex> lock(controllersMutex);
+					ControllerInformation &controllerInformation = getControllerState(event.header.controllerId).controllerInformation;
+					controllerInformation = *reinterpret_cast<const ControllerInformation *>(data);
+					controllerInformation.toHost();
+					Logger::debug(controllerInformation.debugText());
+					break;
+				}
+				case Mgmt::ESetLocalNameCommand:
+				{
+					if (dataLen != sizeof(LocalName))
 					{
-						if (dataLen != sizeof(LocalName))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						localName = *reinterpret_cast<LocalName *>(data);
-						Logger::info(localName.debugText());
-						break;
+						Logger::error("Invalid data length");
+						return;
 					}
-					case Mgmt::ESetPoweredCommand:
-					case Mgmt::ESetBREDRCommand:
-					case Mgmt::ESetSecureConnectionsCommand:
-					case Mgmt::ESetBondableCommand:
-					case Mgmt::ESetConnectableCommand:
-					case Mgmt::ESetLowEnergyCommand:
-					case Mgmt::ESetAdvertisingCommand:
+
+					std::lock_guard<std::mutex> lock(controllersMutex);
+					LocalName &localName = getControllerState(event.header.controllerId).localName;
+					localName = *reinterpret_cast<const LocalName *>(data);
+					Logger::info(localName.debugText());
+					break;
+				}
+				case Mgmt::ESetPoweredCommand:
+				case Mgmt::ESetBREDRCommand:
+				case Mgmt::ESetSecureConnectionsCommand:
+				case Mgmt::ESetBondableCommand:
+				case Mgmt::ESetConnectableCommand:
+				case Mgmt::ESetLowEnergyCommand:
+				case Mgmt::ESetAdvertisingCommand:
+				{
+					if (dataLen != sizeof(AdapterSettings))
 					{
-						if (dataLen != sizeof(AdapterSettings))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
+						Logger::error("Invalid data length");
+						return;
+					}
 
-						adapterSettings = *reinterpret_cast<AdapterSettings *>(data);
-						adapterSettings.toHost();
+					std::lock_guard<std::mutex> lock(controllersMutex);
+					AdapterSettings &adapterSettings = getControllerState(event.header.controllerId).adapterSettings;
+					adapterSettings = *reinterpret_cast<const AdapterSettings *>(data);
+					adapterSettings.toHost();
 
-						Logger::debug(adapterSettings.debugText());
-						break;
-					}
+					Logger::debug(adapterSettings.debugText());
+					break;
 				}
+			}
 
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
+			// Notify anybody waiting that we received a response to their command code
+			setCommandResponse(event.header.controllerId, event.commandCode, event.status);
 
-				break;
-			}
-			// Command status event
-			case Mgmt::ECommandStatusEvent:
-			{
-				CommandStatusEvent event(responsePacket);
+			break;
+		}
+		// Command status event
+		case Mgmt::ECommandStatusEvent:
+		{
+			CommandStatusEvent event(pPacket);
+
+			// Notify anybody waiting that we received a response to their command code
+			setCommandResponse(event.header.controllerId, event.commandCode, event.status);
+			break;
+		}
+		// Command status event
+		case Mgmt::EDeviceConnectedEvent:
+		{
+			DeviceConnectedEvent event(pPacket);
+			ConnectionTable::onConnected(event.header.controllerId, event.address, event.addressType);
 
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
-				break;
+			std::lock_guard<std::mutex> lock(controllersMutex);
+			int &activeConnections = getControllerState(event.header.controllerId).activeConnections;
+			activeConnections += 1;
+			Logger::debug(SSTR << "  > Connection count on controller " << event.header.controllerId << " incremented to " << activeConnections);
+			break;
+		}
+		// Command status event
+		case Mgmt::EDeviceDisconnectedEvent:
+		{
+			DeviceDisconnectedEvent event(pPacket);
+			ConnectionTable::onDisconnected(event.header.controllerId, event.address, event.addressType, event.reason);
+
+			std::lock_guard<std::mutex> lock(controllersMutex);
+			int &activeConnections = getControllerState(event.header.controllerId).activeConnections;
+			if (activeConnections > 0)
+			{
+				activeConnections -= 1;
+				Logger::debug(SSTR << "  > Connection count on controller " << event.header.controllerId << " decremented to " << activeConnections);
 			}
-			// Command status event
-			case Mgmt::EDeviceConnectedEvent:
+			else
 			{
-				DeviceConnectedEvent event(responsePacket);
-				activeConnections += 1;
-				Logger::debug(SSTR << "  > Connection count incremented to " << activeConnections);
-				break;
+				Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
 			}
-			// Command status event
-			case Mgmt::EDeviceDisconnectedEvent:
+			break;
+		}
+		// Unsupported
+		default:
+		{
+			if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
 			{
-				DeviceDisconnectedEvent event(responsePacket);
-				if (activeConnections > 0)
-				{
-					activeConnections -= 1;
-					Logger::debug(SSTR << "  > Connection count decremented to " << activeConnections);
-				}
-				else
-				{
-					Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
-				}
-				break;
+				Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
 			}
-			// Unsupported
-			default:
+			else
 			{
-				if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
-				{
-					Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
-				}
-				else
-				{
-					Logger::error("Invalid event type response: " + Utils::hex(eventCode));					
-				}
+				Logger::error("Invalid event type response: " + Utils::hex(eventCode));					
 			}
 		}
 	}
+}
 
-	// Make sure we're disconnected before we leave
-	hciSocket.disconnect();
+// Called from the main loop when the HCI socket has data waiting (single-threaded mode)
+gboolean HciAdapter::onSocketReady(gint /*fd*/, GIOCondition condition, gpointer pUserData)
+{
+	HciAdapter &adapter = *static_cast<HciAdapter *>(pUserData);
 
-	Logger::trace("Leaving the HciAdapter event thread");
+	if ((condition & (G_IO_HUP | G_IO_ERR | G_IO_NVAL)) != 0)
+	{
+		Logger::error("HCI socket closed or failed, removing its event source");
+		adapter.eventSourceId = 0;
+		adapter.hciSocket.disconnect();
+		return G_SOURCE_REMOVE;
+	}
+
+	// Drain everything that's waiting, so a burst of events costs a single main loop iteration
+	const uint8_t *pPacket = nullptr;
+	size_t packetSize = 0;
+	while (adapter.hciSocket.readAvailable(pPacket, packetSize))
+	{
+		adapter.processEvent(pPacket, packetSize);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Called from the main loop when a command sent with a callback has not received its response in time (single-threaded mode)
+gboolean HciAdapter::onCommandTimeout(gpointer pUserData)
+{
+	const PendingCommand &command = *static_cast<const PendingCommand *>(pUserData);
+	HciAdapter &adapter = HciAdapter::getInstance();
+
+	CommandCallback callback;
+	if (adapter.cancelCommand(command, &callback))
+	{
+		Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(command.code) << " (" << kCommandCodeNames[command.code] << ")");
+		if (callback)
+		{
+			callback(false);
+		}
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+// Returns the most recent adapter settings received for the controller at `controllerIndex`
+HciAdapter::AdapterSettings HciAdapter::getAdapterSettings(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return findControllerState(controllerIndex).adapterSettings;
+}
+
+// Returns the most recent controller information received for the controller at `controllerIndex`
+HciAdapter::ControllerInformation HciAdapter::getControllerInformation(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return findControllerState(controllerIndex).controllerInformation;
+}
+
+// Returns the most recent local name received for the controller at `controllerIndex`
+HciAdapter::LocalName HciAdapter::getLocalName(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return findControllerState(controllerIndex).localName;
+}
+
+// Returns the number of active connections on the controller at `controllerIndex`
+int HciAdapter::getActiveConnectionCount(uint16_t controllerIndex)
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+	return findControllerState(controllerIndex).activeConnections;
+}
+
+// Returns the number of active connections across all controllers
+int HciAdapter::getActiveConnectionCount()
+{
+	std::lock_guard<std::mutex> lock(controllersMutex);
+
+	int count = 0;
+	for (const auto &controller : controllers)
+	{
+		count += controller.second.activeConnections;
+	}
+
+	return count;
 }
 
 // Reads current values from the controller
@@ -381,28 +502,105 @@ void HciAdapter::runEventThread()
 // milliseconds. Therefore, it is not recommended attempt to retrieve the results from their accessors immediately.
 void HciAdapter::sync(uint16_t controllerIndex)
 {
-	Logger::debug("Synchronizing version information");
+	Logger::debug("Synchronizing version and controller information");
 
+	// Both requests are sent before waiting on either response
 	HciAdapter::HciHeader request;
 	request.code = Mgmt::EReadVersionInformationCommand;
 	request.controllerId = HciAdapter::kNonController;
 	request.dataSize = 0;
+	PendingCommand versionCommand = submitCommand(request);
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	request.code = Mgmt::EReadControllerInformationCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = 0;
+	PendingCommand controllerCommand = submitCommand(request);
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kMaxEventWaitTimeMS);
+
+	if (!waitForCommand(versionCommand, deadline))
 	{
 		Logger::error("Failed to get version information");
 	}
 
-	Logger::debug("Synchronizing controller information");
+	if (!waitForCommand(controllerCommand, deadline))
+	{
+		Logger::error("Failed to get current settings");
+	}
+}
+
+// Reads current values from the controller, calling `callback` once both responses have arrived (or timed out)
+//
+// This is the form of `sync()` for single-threaded mode, where nothing may block the main loop. The callback receives true
+// only if both responses were received.
+void HciAdapter::sync(uint16_t controllerIndex, CommandCallback callback)
+{
+	Logger::debug("Synchronizing version and controller information");
+
+	// Callbacks are only ever called from the main loop, so the shared state needs no locking
+	struct SyncState
+	{
+		int outstanding;
+		bool success;
+		CommandCallback callback;
+	};
+
+	std::shared_ptr<SyncState> pState = std::make_shared<SyncState>();
+	pState->outstanding = 2;
+	pState->success = true;
+	pState->callback = callback;
+
+	auto complete = [pState](bool success, const char *pFailure)
+	{
+		if (!success)
+		{
+			Logger::error(pFailure);
+			pState->success = false;
+		}
+
+		if (--pState->outstanding == 0 && pState->callback)
+		{
+			pState->callback(pState->success);
+		}
+	};
+
+	HciAdapter::HciHeader request;
+	request.code = Mgmt::EReadVersionInformationCommand;
+	request.controllerId = HciAdapter::kNonController;
+	request.dataSize = 0;
+	if (!submitCommand(request, [complete](bool success) { complete(success, "Failed to get version information"); }))
+	{
+		complete(false, "Failed to get version information");
+	}
 
 	request.code = Mgmt::EReadControllerInformationCommand;
 	request.controllerId = controllerIndex;
 	request.dataSize = 0;
+	if (!submitCommand(request, [complete](bool success) { complete(success, "Failed to get current settings"); }))
+	{
+		complete(false, "Failed to get current settings");
+	}
+}
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+// Selects single-threaded mode, in which events are dispatched from the server's main loop rather than an event thread
+//
+// In single-threaded mode, the HCI socket is watched by a GSource on the default main context (the one the server thread
+// runs), so events are processed inline and commands are completed through callbacks. Blocking calls (`sendCommand()`,
+// `waitForCommand()` and the non-callback form of `sync()`) are not available in this mode.
+//
+// This must be set before the adapter is started.
+//
+// Returns true on success, or false if the adapter has already been started
+bool HciAdapter::setSingleThreaded(bool enabled)
+{
+	if (isStarted())
 	{
-		Logger::error("Failed to get current settings");
+		Logger::warn("HciAdapter threading mode cannot be changed once started");
+		return false;
 	}
+
+	singleThreaded = enabled;
+	return true;
 }
 
 // Connects the HCI socket if a connection does not already exist and starts the run thread
@@ -415,7 +613,7 @@ void HciAdapter::sync(uint16_t controllerIndex)
 bool HciAdapter::start()
 {
 	// If the thread is already running, return failure
-	if (eventThread.joinable())
+	if (isStarted())
 	{
 		return false;
 	}
@@ -430,6 +628,13 @@ bool HciAdapter::start()
 		}
 	}
 
+	// In single-threaded mode, the main loop reads the data from the socket as it arrives
+	if (singleThreaded)
+	{
+		eventSourceId = g_unix_fd_add_full(G_PRIORITY_DEFAULT, hciSocket.getFd(), static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR), onSocketReady, this, nullptr);
+		return true;
+	}
+
 	// Create a thread to read the data from the socket
 	try
 	{
@@ -449,8 +654,20 @@ bool HciAdapter::start()
 // This method will block until the thread joins
 void HciAdapter::stop()
 {
+	// In single-threaded mode, there's no thread; just stop watching the socket
+	if (0 != eventSourceId)
+	{
+		Logger::trace("HciAdapter removing its event source");
+		g_source_remove(eventSourceId);
+		eventSourceId = 0;
+		return;
+	}
+
 	Logger::trace("HciAdapter waiting for thread termination");
 
+	// Wake the event thread if it's waiting on the socket
+	hciSocket.cancelRead();
+
 	try
 	{
 		if (eventThread.joinable())
@@ -490,25 +707,96 @@ void HciAdapter::stop()
 // If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 // a failure is returned.
 //
+// This method blocks until the response event arrives (or `kMaxEventWaitTimeMS` passes.) To have several commands in flight
+// at once, use `submitCommand()` and `waitForCommand()` instead.
+//
 // Returns true on success, otherwise false
 bool HciAdapter::sendCommand(HciHeader &request)
 {
+	return waitForCommand(submitCommand(request));
+}
+
+// Sends a command over the HCI socket without waiting for its response
+//
+// Any number of commands may be in flight at once. The adapter processes them in the order they were sent, and each response
+// event is matched to the oldest pending command with the same controller index and command code. Use `waitForCommand()` to
+// collect the result.
+//
+// If the command could not be sent, the returned command's response is already set to false.
+HciAdapter::PendingCommand HciAdapter::submitCommand(HciHeader &request)
+{
+	PendingCommand command;
+	if (singleThreaded)
+	{
+		Logger::error("HciAdapter cannot wait on commands in single-threaded mode");
+	}
+	else if (sendPendingCommand(request, command, nullptr))
+	{
+		return command;
+	}
+
+	std::promise<bool> failed;
+	failed.set_value(false);
+	command.response = failed.get_future().share();
+	return command;
+}
+
+// Sends a command over the HCI socket, calling `callback` with the result once its response event arrives
+//
+// This is the form of `submitCommand()` for single-threaded mode: the callback is called from the main loop, either when the
+// response event is processed or after `kMaxEventWaitTimeMS` without one.
+//
+// Returns true if the command was sent. If it returns false, the callback is not called.
+bool HciAdapter::submitCommand(HciHeader &request, CommandCallback callback)
+{
+	if (!singleThreaded)
+	{
+		Logger::error("HciAdapter command callbacks are only available in single-threaded mode");
+		return false;
+	}
+
+	PendingCommand command;
+	return sendPendingCommand(request, command, callback);
+}
+
+// Registers a command as pending and sends it (the implementation of both forms of `submitCommand()`)
+//
+// Returns false if the command could not be sent, in which case it is no longer pending
+bool HciAdapter::sendPendingCommand(HciHeader &request, PendingCommand &command, CommandCallback callback)
+{
+	command.code = request.code;
+	command.controllerId = request.controllerId;
+	command.serial = 0;
+
 	// Auto-connect
-	if (!eventThread.joinable() && !start())
+	if (!isStarted() && !start())
 	{
 		Logger::error("HciAdapter failed to start");
 		return false;
 	}
 
-	uint16_t code = request.code;
-	uint16_t dataSize = request.dataSize;
-
-	conditionalValue = -1;
-	std::future<bool> fut = std::async(std::launch::async,
-	[&]() mutable
+	// Register the command before it is sent, so that we can't miss its response
 	{
-		return waitForCommandResponse(code, kMaxEventWaitTimeMS);
-	});
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+		command.serial = ++nextCommandSerial;
+
+		PendingEntry entry;
+		entry.serial = command.serial;
+		command.response = entry.promise.get_future().share();
+		entry.callback = callback;
+		entry.timeoutId = 0;
+
+		// Our timeout runs on the main loop along with everything else
+		if (callback)
+		{
+			entry.timeoutId = g_timeout_add_full(G_PRIORITY_DEFAULT, kMaxEventWaitTimeMS, onCommandTimeout, new PendingCommand(command),
+				[](gpointer pData) { delete static_cast<PendingCommand *>(pData); });
+		}
+
+		pendingCommands[pendingCommandKey(command.controllerId, command.code)].push_back(std::move(entry));
+	}
+
+	uint16_t dataSize = request.dataSize;
 
 	// Prepare the request to be sent (endianness correction)
 	request.toNetwork();
@@ -517,46 +805,134 @@ bool HciAdapter::sendCommand(HciHeader &request)
 	std::vector<uint8_t> requestPacket = std::vector<uint8_t>(pRequest, pRequest + sizeof(request) + dataSize);
 	if (!hciSocket.write(requestPacket))
 	{
+		// It was never sent, so don't leave it waiting on a response
+		cancelCommand(command);
 		return false;
 	}
 
-	return fut.get();
+	return true;
 }
 
-// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+// Waits until `deadline` for the response to a command sent with `submitCommand()`
 //
-// Returns true if the response event was received for `commandCode` or false if the timeout expired.
-//
-// Command responses are set via `setCommandResponse()`
-bool HciAdapter::waitForCommandResponse(uint16_t commandCode, int timeoutMS)
+// Returns true if the response event was received and reported success, otherwise false
+bool HciAdapter::waitForCommand(const PendingCommand &command, std::chrono::steady_clock::time_point deadline)
 {
-	Logger::debug(SSTR << "  + Waiting on command code " << commandCode << " for up to " << timeoutMS << "ms");
+	// Nobody else could read the response while we wait for it
+	if (singleThreaded && std::future_status::ready != command.response.wait_for(std::chrono::seconds(0)))
+	{
+		Logger::error("HciAdapter cannot wait on commands in single-threaded mode");
+		cancelCommand(command);
+		return false;
+	}
 
-	bool success = cvCommandResponse.wait_for(commandResponseLock, std::chrono::milliseconds(timeoutMS),
-		[&]
+	if (std::future_status::ready == command.response.wait_until(deadline))
+	{
+		// A failure has already been logged along with its status (see `setCommandResponse()`)
+		bool success = command.response.get();
+		if (success)
 		{
-			return conditionalValue == commandCode;
+			Logger::debug(SSTR << "  + Received the command code we were waiting for: " << Utils::hex(command.code) << " (" << kCommandCodeNames[command.code] << ")");
 		}
-	);
 
-	if (!success)
+		return success;
+	}
+
+	// Give up on the command, unless its response arrived while we weren't looking
+	if (cancelCommand(command))
+	{
+		Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(command.code) << " (" << kCommandCodeNames[command.code] << ")");
+		return false;
+	}
+
+	return command.response.get();
+}
+
+// Waits up to `kMaxEventWaitTimeMS` for the response to a command sent with `submitCommand()`
+//
+// Returns true if the response event was received and reported success, otherwise false
+bool HciAdapter::waitForCommand(const PendingCommand &command)
+{
+	return waitForCommand(command, std::chrono::steady_clock::now() + std::chrono::milliseconds(kMaxEventWaitTimeMS));
+}
+
+// Removes a command from the pending commands, so that it no longer waits on a response
+//
+// Returns true if the command was removed, or false if it was no longer pending (its response has already arrived)
+//
+// If the command was sent with a callback, that callback is moved into `pCallback` (when provided) rather than being called.
+bool HciAdapter::cancelCommand(const PendingCommand &command, CommandCallback *pCallback)
+{
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+
+	auto it = pendingCommands.find(pendingCommandKey(command.controllerId, command.code));
+	if (it == pendingCommands.end())
 	{
-		Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		return false;
 	}
-	else
+
+	for (auto entry = it->second.begin(); entry != it->second.end(); ++entry)
 	{
-		Logger::debug(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		if (entry->serial == command.serial)
+		{
+			// Unless we're being called from the timeout itself, it's no longer needed
+			if (0 != entry->timeoutId && nullptr == pCallback)
+			{
+				g_source_remove(entry->timeoutId);
+			}
+
+			if (nullptr != pCallback)
+			{
+				*pCallback = std::move(entry->callback);
+			}
+
+			it->second.erase(entry);
+			return true;
+		}
 	}
 
-	return success;
+	return false;
 }
 
-// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-void HciAdapter::setCommandResponse(uint16_t commandCode)
+// Completes the oldest pending command with the given controller index and command code (see `submitCommand()`)
+//
+// The command succeeded only if `status` is zero. Anything else (including a busy adapter) fails the command.
+void HciAdapter::setCommandResponse(uint16_t controllerId, uint16_t commandCode, uint8_t status)
 {
-	std::lock_guard<std::mutex> lk(commandResponseMutex);
-	conditionalValue = commandCode;
-	cvCommandResponse.notify_one();
+	bool success = 0 == status;
+	if (!success)
+	{
+		Logger::warn(SSTR << "  + Command code " << Utils::hex(commandCode) << " (" << (commandCode <= kMaxCommandCode ? kCommandCodeNames[commandCode] : "Unknown") << ") failed with status " << Utils::hex(status) << " (" << (status <= kMaxStatusCode ? kStatusCodes[status] : "Unknown") << ")");
+	}
+
+	CommandCallback callback;
+
+	{
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+
+		auto it = pendingCommands.find(pendingCommandKey(controllerId, commandCode));
+		if (it == pendingCommands.end() || it->second.empty())
+		{
+			Logger::debug(SSTR << "  + Ignoring response to command code " << Utils::hex(commandCode) << " that nobody is waiting on");
+			return;
+		}
+
+		PendingEntry &entry = it->second.front();
+		if (0 != entry.timeoutId)
+		{
+			g_source_remove(entry.timeoutId);
+		}
+
+		entry.promise.set_value(success);
+		callback = std::move(entry.callback);
+		it->second.pop_front();
+	}
+
+	// The callback may well send more commands, so it's called without the lock
+	if (callback)
+	{
+		callback(success);
+	}
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -25,10 +25,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <vector>
+#include <deque>
+#include <map>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <glib.h>
 
 #include "HciSocket.h"
 #include "Utils.h"
@@ -45,11 +51,16 @@ public:
 	//
 
 	// How long to wait for a response event for commands sent to the adapter
+	//
+	// When several commands are in flight at once (see `submitCommand()`), they share this budget.
 	static const int kMaxEventWaitTimeMS = 1000;
 
 	// A constant referring to a 'non-controller' (for commands that do not require a controller index)
 	static const uint16_t kNonController = 0xffff;
 
+	// The index of the first controller, used when no controller index is given
+	static const uint16_t kDefaultControllerIndex = 0;
+
 	// Command code names
 	static const int kMinCommandCode = 0x0001;
 	static const int kMaxCommandCode = 0x0043;
@@ -126,9 +137,9 @@ public:
 		uint16_t commandCode;
 		uint8_t status;
 
-		CommandCompleteEvent(const std::vector<uint8_t> &data)
+		CommandCompleteEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const CommandCompleteEvent *>(data.data());
+			*this = *reinterpret_cast<const CommandCompleteEvent *>(pData);
 			toHost();
 
 			// Log it
@@ -166,9 +177,9 @@ public:
 		uint16_t commandCode;
 		uint8_t status;
 
-		CommandStatusEvent(const std::vector<uint8_t> &data)
+		CommandStatusEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const CommandStatusEvent *>(data.data());
+			*this = *reinterpret_cast<const CommandStatusEvent *>(pData);
 			toHost();
 
 			// Log it
@@ -208,9 +219,9 @@ public:
 		uint32_t flags;
 		uint16_t eirDataLength;
 
-		DeviceConnectedEvent(const std::vector<uint8_t> &data)
+		DeviceConnectedEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const DeviceConnectedEvent *>(data.data());
+			*this = *reinterpret_cast<const DeviceConnectedEvent *>(pData);
 			toHost();
 
 			// Log it
@@ -258,9 +269,9 @@ public:
 		uint8_t addressType;
 		uint8_t reason;
 
-		DeviceDisconnectedEvent(const std::vector<uint8_t> &data)
+		DeviceDisconnectedEvent(const uint8_t *pData)
 		{
-			*this = *reinterpret_cast<const DeviceDisconnectedEvent *>(data.data());
+			*this = *reinterpret_cast<const DeviceDisconnectedEvent *>(pData);
 			toHost();
 
 			// Log it
@@ -416,6 +427,19 @@ public:
 		}
 	} __attribute__((packed));
 
+	// A command that has been sent to the adapter and is awaiting its response event (see `submitCommand()`)
+	struct PendingCommand
+	{
+		uint16_t code;
+		uint16_t controllerId;
+		uint64_t serial;
+		std::shared_future<bool> response;
+	};
+
+	// Called with the result of a command sent with a callback (see `submitCommand()`): true if the response event was received
+	// and reported success, false if the command failed, could not be sent or timed out
+	typedef std::function<void(bool success)> CommandCallback;
+
 	//
 	// Accessors
 	//
@@ -427,11 +451,16 @@ public:
 		return instance;
 	}
 
-	AdapterSettings getAdapterSettings() { return adapterSettings; }
-	ControllerInformation getControllerInformation() { return controllerInformation; }
+	// The per-controller accessors below return the most recent values received for the controller at `controllerIndex` (the
+	// zero-based index of the device as recognized by the OS), or zeroed values if nothing has been received for it yet
+	AdapterSettings getAdapterSettings(uint16_t controllerIndex = kDefaultControllerIndex);
+	ControllerInformation getControllerInformation(uint16_t controllerIndex = kDefaultControllerIndex);
+	LocalName getLocalName(uint16_t controllerIndex = kDefaultControllerIndex);
+	int getActiveConnectionCount(uint16_t controllerIndex);
 	VersionInformation getVersionInformation() { return versionInformation; }
-	LocalName getLocalName() { return localName; }
-	int getActiveConnectionCount() { return activeConnections; }
+
+	// Returns the number of active connections across all controllers
+	int getActiveConnectionCount();
 
 	//
 	// Disallow copies of our singleton (c++11)
@@ -446,7 +475,28 @@ public:
 	// milliseconds. Therefore, it is not recommended attempt to retrieve the results from their accessors immediately.
 	void sync(uint16_t controllerIndex);
 
-	// Connects the HCI socket if a connection does not already exist and starts the run thread
+	// Reads current values from the controller, calling `callback` once both responses have arrived (or timed out)
+	//
+	// This is the form of `sync()` for single-threaded mode, where nothing may block the main loop. The callback receives true
+	// only if both responses were received.
+	void sync(uint16_t controllerIndex, CommandCallback callback);
+
+	// Selects single-threaded mode, in which events are dispatched from the server's main loop rather than an event thread
+	//
+	// In single-threaded mode, the HCI socket is watched by a GSource on the default main context (the one the server thread
+	// runs), so events are processed inline and commands are completed through callbacks. Blocking calls (`sendCommand()`,
+	// `waitForCommand()` and the non-callback form of `sync()`) are not available in this mode.
+	//
+	// This must be set before the adapter is started.
+	//
+	// Returns true on success, or false if the adapter has already been started
+	bool setSingleThreaded(bool enabled);
+
+	// Returns true if single-threaded mode is selected (see `setSingleThreaded()`)
+	bool isSingleThreaded() const { return singleThreaded; }
+
+	// Connects the HCI socket if a connection does not already exist and starts the run thread (or, in single-threaded mode,
+	// attaches the socket's event source to the main loop)
 	//
 	// If a connection already exists, this method will fail
 	//
@@ -457,7 +507,8 @@ public:
 
 	// Waits for the HciAdapter run thread to join
 	//
-	// This method will block until the thread joins
+	// This method will block until the thread joins. In single-threaded mode, the socket's event source is removed from the main
+	// loop instead.
 	void stop();
 
 	// Sends a command over the HCI socket
@@ -465,9 +516,39 @@ public:
 	// If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 	// a failure is returned.
 	//
+	// This method blocks until the response event arrives (or `kMaxEventWaitTimeMS` passes.) To have several commands in flight
+	// at once, use `submitCommand()` and `waitForCommand()` instead.
+	//
 	// Returns true on success, otherwise false
 	bool sendCommand(HciHeader &request);
 
+	// Sends a command over the HCI socket without waiting for its response
+	//
+	// Any number of commands may be in flight at once. The adapter processes them in the order they were sent, and each response
+	// event is matched to the oldest pending command with the same controller index and command code. Use `waitForCommand()` to
+	// collect the result.
+	//
+	// If the command could not be sent, the returned command's response is already set to false.
+	PendingCommand submitCommand(HciHeader &request);
+
+	// Sends a command over the HCI socket, calling `callback` with the result once its response event arrives
+	//
+	// This is the form of `submitCommand()` for single-threaded mode: the callback is called from the main loop, either when the
+	// response event is processed or after `kMaxEventWaitTimeMS` without one.
+	//
+	// Returns true if the command was sent. If it returns false, the callback is not called.
+	bool submitCommand(HciHeader &request, CommandCallback callback);
+
+	// Waits until `deadline` for the response to a command sent with `submitCommand()`
+	//
+	// Returns true if the response event was received and reported success, otherwise false
+	bool waitForCommand(const PendingCommand &command, std::chrono::steady_clock::time_point deadline);
+
+	// Waits up to `kMaxEventWaitTimeMS` for the response to a command sent with `submitCommand()`
+	//
+	// Returns true if the response event was received and reported success, otherwise false
+	bool waitForCommand(const PendingCommand &command);
+
 	// Event processor, responsible for receiving events from the HCI socket
 	//
 	// This mehtod should not be called directly. Rather, it runs continuously on a thread until the server shuts down
@@ -475,17 +556,84 @@ public:
 
 private:
 	// Private constructor for our Singleton
-	HciAdapter() : commandResponseLock(commandResponseMutex), activeConnections(0) {}
+	HciAdapter() : singleThreaded(false), eventSourceId(0), nextCommandSerial(0) {}
 
-	// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+	// The information we track for each controller
+	struct ControllerState
+	{
+		ControllerState() : activeConnections(0)
+		{
+			memset(&adapterSettings, 0, sizeof(adapterSettings));
+			memset(&controllerInformation, 0, sizeof(controllerInformation));
+			memset(&localName, 0, sizeof(localName));
+		}
+
+		AdapterSettings adapterSettings;
+		ControllerInformation controllerInformation;
+		LocalName localName;
+		int activeConnections;
+	};
+
+	// Returns the state for a controller, creating it if needed (the caller must hold `controllersMutex`)
 	//
-	// Returns true if the response event was received for `commandCode` or false if the timeout expired.
+	// This is for recording what a controller sends us. Queries use `findControllerState()`, so that asking about a controller
+	// we've never heard from doesn't make it up.
+	ControllerState &getControllerState(uint16_t controllerIndex) { return controllers[controllerIndex]; }
+
+	// Returns the state for a controller, or the zeroed state if nothing has been received for it (the caller must hold
+	// `controllersMutex`)
+	const ControllerState &findControllerState(uint16_t controllerIndex) const
+	{
+		static const ControllerState unknownState;
+		auto it = controllers.find(controllerIndex);
+		return it == controllers.end() ? unknownState : it->second;
+	}
+
+	// A command awaiting its response event (see `pendingCommands`)
+	struct PendingEntry
+	{
+		uint64_t serial;
+		std::promise<bool> promise;
+
+		// Single-threaded mode only: the callback for the result and the ID of the timeout that fails it
+		CommandCallback callback;
+		guint timeoutId;
+	};
+
+	// Returns true if the event thread is running or the event source is attached
+	bool isStarted() const { return eventThread.joinable() || 0 != eventSourceId; }
+
+	// Registers a command as pending and sends it (the implementation of both forms of `submitCommand()`)
 	//
-	// Command responses are set via `setCommandResponse()`
-	bool waitForCommandResponse(uint16_t commandCode, int timeoutMS);
+	// Returns false if the command could not be sent, in which case it is no longer pending
+	bool sendPendingCommand(HciHeader &request, PendingCommand &command, CommandCallback callback);
 
-	// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-	void setCommandResponse(uint16_t commandCode);
+	// Processes a single event packet received from the adapter
+	void processEvent(const uint8_t *pPacket, size_t packetSize);
+
+	// Called from the main loop when the HCI socket has data waiting (single-threaded mode)
+	static gboolean onSocketReady(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Called from the main loop when a command sent with a callback has not received its response in time (single-threaded mode)
+	static gboolean onCommandTimeout(gpointer pUserData);
+
+	// Returns the key used to match a command to its response event in `pendingCommands`
+	static uint32_t pendingCommandKey(uint16_t controllerId, uint16_t commandCode)
+	{
+		return (static_cast<uint32_t>(controllerId) << 16) | commandCode;
+	}
+
+	// Removes a command from the pending commands, so that it no longer waits on a response
+	//
+	// Returns true if the command was removed, or false if it was no longer pending (its response has already arrived)
+	//
+	// If the command was sent with a callback, that callback is moved into `pCallback` (when provided) rather than being called.
+	bool cancelCommand(const PendingCommand &command, CommandCallback *pCallback = nullptr);
+
+	// Completes the oldest pending command with the given controller index and command code (see `submitCommand()`)
+	//
+	// The command succeeded only if `status` is zero. Anything else (including a busy adapter) fails the command.
+	void setCommandResponse(uint16_t controllerId, uint16_t commandCode, uint8_t status);
 
 	// Our HCI Socket, which allows us to talk directly to the kernel
 	HciSocket hciSocket;
@@ -493,19 +641,21 @@ private:
 	// Our event thread listens for events coming from the adapter and deals with them appropriately
 	static std::thread eventThread;
 
-	// Our adapter information
-	AdapterSettings adapterSettings;
-	ControllerInformation controllerInformation;
-	VersionInformation versionInformation;
-	LocalName localName;
+	// True if events are dispatched from the main loop rather than the event thread (see `setSingleThreaded()`)
+	bool singleThreaded;
+
+	// In single-threaded mode, the ID of the main loop source watching our HCI socket (or 0 if there is none)
+	guint eventSourceId;
 
-	std::condition_variable cvCommandResponse;
-	std::mutex commandResponseMutex;
-	std::unique_lock<std::mutex> commandResponseLock;
-	int conditionalValue;
+	// Our adapter information; the version is that of the management interface, everything else is per controller
+	VersionInformation versionInformation;
+	std::map<uint16_t, ControllerState> controllers;
+	std::mutex controllersMutex;
 
-	// Our active connection count
-	int activeConnections;
+	// Commands awaiting their response events, in the order they were sent, keyed by `pendingCommandKey()`
+	std::map<uint32_t, std::deque<PendingEntry>> pendingCommands;
+	std::mutex pendingCommandsMutex;
+	uint64_t nextCommandSerial;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -34,6 +34,8 @@
 #include <bluetooth/hci.h>
 #include <thread>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "HciSocket.h"
 #include "Logger.h"
@@ -43,8 +45,14 @@ namespace ggk {
 
 // Initializes an unconnected socket
 HciSocket::HciSocket()
-: fdSocket(-1)
+: fdSocket(-1), fdShutdown(-1), fdEpoll(-1)
 {
+	// Our shutdown event lives as long as we do, so that `cancelRead()` can safely be called from any thread at any time
+	fdShutdown = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fdShutdown < 0)
+	{
+		logErrno("eventfd");
+	}
 }
 
 // Socket destructor
@@ -53,6 +61,12 @@ HciSocket::HciSocket()
 HciSocket::~HciSocket()
 {
 	disconnect();
+
+	if (fdShutdown >= 0)
+	{
+		close(fdShutdown);
+		fdShutdown = -1;
+	}
 }
 
 // Connects to an HCI socket using the Bluetooth Management API protocol
@@ -82,6 +96,48 @@ bool HciSocket::connect()
 		return false;
 	}
 
+	// Wait on the socket and our shutdown event together, so that reads never need to time out
+	if (fdShutdown < 0)
+	{
+		Logger::error("HciSocket has no shutdown event");
+		disconnect();
+		return false;
+	}
+
+	// Clear any earlier cancellation
+	uint64_t value;
+	while (::read(fdShutdown, &value, sizeof(value)) > 0) {}
+
+	fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (fdEpoll < 0)
+	{
+		logErrno("Connect(epoll_create1)");
+		disconnect();
+		return false;
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+
+	event.data.fd = fdSocket;
+	if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdSocket, &event) < 0)
+	{
+		logErrno("Connect(epoll_ctl)");
+		disconnect();
+		return false;
+	}
+
+	event.data.fd = fdShutdown;
+	if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdShutdown, &event) < 0)
+	{
+		logErrno("Connect(epoll_ctl)");
+		disconnect();
+		return false;
+	}
+
+	receiveBuffer.resize(kResponseMaxSize);
+
 	Logger::debug(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
 
 	return true;
@@ -108,18 +164,25 @@ void HciSocket::disconnect()
 		fdSocket = -1;
 		Logger::trace("HciSocket closed");
 	}
+
+	if (fdEpoll >= 0)
+	{
+		close(fdEpoll);
+		fdEpoll = -1;
+	}
 }
 
 // Reads data from the HCI socket
 //
-// Raw data is read and returned in `response`.
+// Blocks until a packet arrives or `cancelRead()` is called. The packet is read into a receive buffer owned by the socket;
+// on success, `pData` and `size` describe the packet, which remains valid until the next call to `read()`.
 //
 // Returns true if data was read successfully, otherwise false is returned. A false return code does not necessarily depict
-// an error, as this can arise from expected conditions (such as an interrupt.)
-bool HciSocket::read(std::vector<uint8_t> &response) const
+// an error, as this can arise from expected conditions (such as an interrupt or a cancellation.)
+bool HciSocket::read(const uint8_t *&pData, size_t &size)
 {
-	// Fill our response with empty data
-	response.resize(kResponseMaxSize, 0);
+	pData = nullptr;
+	size = 0;
 
 	// Wait for data or a cancellation
 	if (!waitForDataOrShutdown())
@@ -127,13 +190,31 @@ bool HciSocket::read(std::vector<uint8_t> &response) const
 		return false;
 	}
 
-	// Block until we receive data, a disconnect, or a signal
-	ssize_t bytesRead = ::recv(fdSocket, &response[0], kResponseMaxSize, MSG_WAITALL);
+	return readAvailable(pData, size);
+}
+
+// Reads a packet from the HCI socket if one is waiting, without blocking
+//
+// This is `read()` without the wait, for callers that learn about incoming data some other way (such as a main loop watching
+// `getFd()`.) The packet is read into the same receive buffer, with the same lifetime.
+//
+// Returns true if a packet was read, otherwise false (including when no packet was waiting)
+bool HciSocket::readAvailable(const uint8_t *&pData, size_t &size)
+{
+	pData = nullptr;
+	size = 0;
+
+	// Receive a packet (our socket is non-blocking)
+	ssize_t bytesRead = ::recv(fdSocket, receiveBuffer.data(), receiveBuffer.size(), 0);
 
-	// If there was an error, wipe the data and return an error condition
+	// If there was an error, return an error condition
 	if (bytesRead < 0)
 	{
-		if (errno == EINTR)
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			// Nothing waiting
+		}
+		else if (errno == EINTR)
 		{
 			Logger::debug("HciSocket receive interrupted");
 		}
@@ -141,27 +222,45 @@ bool HciSocket::read(std::vector<uint8_t> &response) const
 		{
 			logErrno("recv");
 		}
-		response.resize(0);
 		return false;
 	}
 	else if (bytesRead == 0)
 	{
 		Logger::error("Peer closed the socket");
-		response.resize(0);
 		return false;
 	}
 
 	// We have data
-	response.resize(bytesRead);
+	pData = receiveBuffer.data();
+	size = static_cast<size_t>(bytesRead);
 
-	std::string dump = "";
-	dump += "  > Read " + std::to_string(response.size()) + " bytes\n";
-	dump += Utils::hex(response.data(), response.size());
-	Logger::debug(dump);
+	// Only build the dump if somebody is going to see it
+	if (Logger::isDebugEnabled())
+	{
+		std::string dump = "";
+		dump += "  > Read " + std::to_string(size) + " bytes\n";
+		dump += Utils::hex(pData, size);
+		Logger::debug(dump);
+	}
 
 	return true;
 }
 
+// Wakes any thread blocked in `read()`, causing it (and any later call to `read()`) to return false
+//
+// This method may be called from any thread. A new connection (see `connect()`) clears the cancellation.
+void HciSocket::cancelRead()
+{
+	if (fdShutdown >= 0)
+	{
+		uint64_t value = 1;
+		if (::write(fdShutdown, &value, sizeof(value)) < 0 && errno != EAGAIN)
+		{
+			logErrno("write(fdShutdown)");
+		}
+	}
+}
+
 // Writes the array of bytes of a given count
 //
 // This method returns true if the bytes were written successfully, otherwise false
@@ -175,10 +274,14 @@ bool HciSocket::write(std::vector<uint8_t> buffer) const
 // This method returns true if the bytes were written successfully, otherwise false
 bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 {
-	std::string dump = "";
-	dump += "  > Writing " + std::to_string(count) + " bytes\n";
-	dump += Utils::hex(pBuffer, count);
-	Logger::debug(dump);
+	// Only build the dump if somebody is going to see it
+	if (Logger::isDebugEnabled())
+	{
+		std::string dump = "";
+		dump += "  > Writing " + std::to_string(count) + " bytes\n";
+		dump += Utils::hex(pBuffer, count);
+		Logger::debug(dump);
+	}
 
 	size_t len = ::write(fdSocket, pBuffer, count);
 
@@ -198,24 +301,30 @@ bool HciSocket::waitForDataOrShutdown() const
 {
 	while(ggkIsServerRunning())
 	{
-		fd_set rfds;
-		FD_ZERO(&rfds);
-		FD_SET(fdSocket, &rfds);
+		// Block until something happens; there is no timeout since a shutdown will wake us through `fdShutdown`
+		struct epoll_event events[2];
+		int count = epoll_wait(fdEpoll, events, 2, -1);
 
-		struct timeval tv;
-		tv.tv_sec = 0;
-		tv.tv_usec = kDataWaitTimeMS * 1000;
-
-		int retval = select(fdSocket+1, &rfds, NULL, NULL, &tv);
+		if (count < 0)
+		{
+			// Interrupted by a signal; check our state and keep waiting
+			if (errno == EINTR) { continue; }
 
-		// Do we have data?
-		if (retval > 0) { return true; }
+			// We have an error
+			logErrno("epoll_wait");
+			return false;
+		}
 
-		// We have an error
-		if (retval < 0) { return false; }
+		// A shutdown takes priority over any data
+		bool dataAvailable = false;
+		for (int i = 0; i < count; ++i)
+		{
+			if (events[i].data.fd == fdShutdown) { return false; }
+			if (events[i].data.fd == fdSocket) { dataAvailable = true; }
+		}
 
-		// No data; keep waiting
-		continue;
+		// Do we have data?
+		if (dataAvailable) { return true; }
 	}
 
 	return false;
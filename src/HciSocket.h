@@ -52,11 +52,27 @@ public:
 
 	// Reads data from the HCI socket
 	//
-	// Raw data is read until no more data is available. If no data is available when this method initially starts to read, it will
-	// retry for a maximum timeout defined by `kMaxRetryTimeMS`.
+	// Blocks until a packet arrives or `cancelRead()` is called. The packet is read into a receive buffer owned by the socket;
+	// on success, `pData` and `size` describe the packet, which remains valid until the next call to `read()`.
 	//
-	// Returns true if any data was read successfully, otherwise false is returned in the case of an error or a timeout.
-	bool read(std::vector<uint8_t> &response) const;
+	// Returns true if data was read successfully, otherwise false is returned in the case of an error or a cancellation.
+	bool read(const uint8_t *&pData, size_t &size);
+
+	// Reads a packet from the HCI socket if one is waiting, without blocking
+	//
+	// This is `read()` without the wait, for callers that learn about incoming data some other way (such as a main loop watching
+	// `getFd()`.) The packet is read into the same receive buffer, with the same lifetime.
+	//
+	// Returns true if a packet was read, otherwise false (including when no packet was waiting)
+	bool readAvailable(const uint8_t *&pData, size_t &size);
+
+	// Returns the underlying socket descriptor (or -1 if not connected) so that it can be watched for incoming data
+	int getFd() const { return fdSocket; }
+
+	// Wakes any thread blocked in `read()`, causing it (and any later call to `read()`) to return false
+	//
+	// This method may be called from any thread. A new connection (see `connect()`) clears the cancellation.
+	void cancelRead();
 
 	// Writes the array of bytes of a given count
 	//
@@ -80,8 +96,16 @@ private:
 
 	int	fdSocket;
 
+	// An eventfd used to wake the reader for shutdown (see `cancelRead()`), open for the lifetime of the socket object
+	int fdShutdown;
+
+	// The epoll instance that waits on `fdSocket` and `fdShutdown`
+	int fdEpoll;
+
+	// Our receive buffer, allocated once and reused for every read
+	std::vector<uint8_t> receiveBuffer;
+
 	const size_t kResponseMaxSize = 64 * 1024;
-	const int kDataWaitTimeMS = 10;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -33,11 +33,16 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <gio/gio.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <atomic>
 #include <chrono>
 #include <thread>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "Server.h"
 #include "Globals.h"
@@ -46,8 +51,16 @@
 #include "DBusObject.h"
 #include "DBusInterface.h"
 #include "GattCharacteristic.h"
+#include "GattDescriptor.h"
 #include "GattProperty.h"
 #include "Logger.h"
+#include "UpdateQueue.h"
+#include "ConnectionTable.h"
+#include "DataStore.h"
+#include "TimerWheel.h"
+#include "StreamTimers.h"
+#include "WorkerPool.h"
+#include "ShmDataPlane.h"
 #include "Init.h"
 
 namespace ggk {
@@ -58,7 +71,6 @@ namespace ggk {
 
 static const int kPeriodicTimerFrequencySeconds = 1;
 static const int kRetryDelaySeconds = 2;
-static const int kIdleFrequencyMS = 10;
 
 //
 // Retries
@@ -73,19 +85,51 @@ static time_t retryTimeStart = 0;
 GDBusConnection *pBusConnection = nullptr;
 static guint ownedNameId = 0;
 static guint periodicTimeoutId = 0;
+static guint eventTimeoutId = 0;
+static TimerWheel eventWheel;
 static std::vector<guint> registeredObjectIds;
 static std::atomic<GMainLoop *> pMainLoop(nullptr);
 static GDBusObjectManager *pBluezObjectManager = nullptr;
-static GDBusObject *pBluezAdapterObject = nullptr;
-static GDBusObject *pBluezDeviceObject = nullptr;
-static GDBusProxy *pBluezGattManagerProxy = nullptr;
-static GDBusProxy *pBluezAdapterInterfaceProxy = nullptr;
 static GDBusProxy *pBluezDeviceInterfaceProxy = nullptr;
-static GDBusProxy *pBluezAdapterPropertiesInterfaceProxy = nullptr;
 static bool bOwnedNameAcquired = false;
-static bool bAdapterConfigured = false;
-static bool bApplicationRegistered = false;
-static std::string bluezGattManagerInterfaceName = "";
+
+//
+// BlueZ adapters
+//
+
+// A Bluetooth adapter that we register our GATT application with
+struct BluezAdapter
+{
+	// The adapter's controller index (the N in its object path, "/org/bluez/hciN")
+	uint16_t controllerIndex;
+
+	// The adapter's object path, which is also the path of its GATT manager interface
+	std::string objectPath;
+
+	GDBusObject *pObject;
+	GDBusProxy *pGattManagerProxy;
+	GDBusProxy *pAdapterInterfaceProxy;
+	GDBusProxy *pPropertiesInterfaceProxy;
+
+	bool configured;
+	bool applicationRegistered;
+};
+
+// The adapters we serve, in the order BlueZ listed them (empty until `findAdapterInterface()` succeeds)
+static std::vector<BluezAdapter> bluezAdapters;
+
+// The adapters to serve, as a bitmask of controller indices (0 means only the first adapter found; see `setAdapterMask()`)
+static std::atomic<uint32_t> adapterMask(0);
+
+//
+// Update queue event source
+//
+
+static GSource *pUpdateQueueSource = nullptr;
+
+// Created with the first update queue source and never closed (see `wakeUpdateQueue()`)
+static std::atomic<int> updateQueueEventFd(-1);
+static std::atomic<bool> updateQueueWakePending(false);
 
 //
 // Externs
@@ -99,6 +143,13 @@ extern void setServerHealth(enum GGKServerHealth newHealth);
 //
 
 static void initializationStateProcessor();
+static void unregisterObjects();
+static void applyAdapterConfiguration(size_t adapterIndex);
+static void powerOnAdapter(size_t adapterIndex);
+static bool isApplicationRegistered();
+static void releaseAdapters();
+static gboolean onEventTimer(gpointer pUserData);
+static void stopEventTimer();
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  ___    _ _           __      _       _                                             _
@@ -112,49 +163,39 @@ static void initializationStateProcessor();
 // `TheServer` object, then call `ggkPushUpdateQueue` to trigger that data to be updated (in whatever way the service responsible
 // for that data() sees fit.
 //
-// This is done using the `ggkPushUpdateQueue` / `ggkPopUpdateQueue` methods to manage the queue of pending update messages. Each
-// entry represents an interface that needs to be updated. The idleFunc calls the interface's `onUpdatedValue` method for each
-// update.
+// Each entry in the update queue (see UpdateQueue.cpp) represents an interface that needs to be updated. The
+// `processUpdateQueue` method calls the interface's `onUpdatedValue` method for each update.
+//
+// Rather than polling the queue from a GLib idle callback (which either spins the CPU or adds latency, depending on how long we
+// sleep between polls), the queue is serviced by its own GSource. The source watches an eventfd which is signalled by
+// `wakeUpdateQueue()` whenever an entry is pushed. The main loop sleeps in poll() until there is work to do, and wakes up
+// immediately when there is. The eventfd is created along with the first source and stays open for the life of the process, so
+// producers can wake it at any time, even while the server is shutting down.
 //
-// The idle processor will perform one update per idle tick, however, it will notify that there is more data so the idle ticks
-// do not lag behind.
+// Each time the source is dispatched, it takes a batch of entries from the queue and processes them. The size of a batch is
+// limited by the queue's batch budget (see `ggkUpdateQueueSetBatchBudget`) so a burst of updates can't starve the rest of the
+// main loop. If more data remains, the source marks itself as ready so the updates do not lag behind.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Our idle function
+// Processes a single entry from the update queue
 //
-// This method is used to process data on the same thread as our main loop. This allows us to communicate with our service from
-// the outside.
-//
-// IMPORTANT: This method must return 'true' if any work was performed, otherwise it must return 'false'. Returning 'true' will
-// cause the idle loop to continue to call this method to process data at the maximum rate (which can peg the CPU at 100%.) By
-// returning false when there is no work to do, we are nicer to the system.
-bool idleFunc(void *pUserData)
+// Returns true if the update was delivered, otherwise false.
+static bool processUpdate(const UpdateQueue::Entry &entry, void *pUserData)
 {
-
-	// Don't do anything unless we're running
-	if (ggkGetServerRunState() != ERunning)
-	{
-		return false;
-	}
-
-	// Try to get an update
-	const int kQueueEntryLen = 1024;
-	char queueEntry[kQueueEntryLen];
-	if (ggkPopUpdateQueue(queueEntry, kQueueEntryLen, 0) != 1)
+	// Most IDs were resolved to their interface at startup (see `internUpdateQueueIds()`), which saves us a search
+	if (const DBusInterface *pTarget = UpdateQueue::getTarget(entry.id))
 	{
-		return false;
-	}
+		if (pTarget->getInterfaceType() == GattCharacteristic::kInterfaceType)
+		{
+			static_cast<const GattCharacteristic *>(pTarget)->callOnUpdatedValue(pBusConnection, pUserData);
+			return true;
+		}
 
-	std::string entryString = queueEntry;
-	auto token = entryString.find('|');
-	if (token == std::string::npos)
-	{
-		Logger::error("Queue entry was not formatted properly - could not find separating token");
 		return false;
 	}
 
-	DBusObjectPath objectPath = DBusObjectPath(entryString.substr(0, token));
-	std::string interfaceName = entryString.substr(token+1);
+	DBusObjectPath objectPath(UpdateQueue::getObjectPath(entry.id));
+	const std::string &interfaceName = UpdateQueue::getInterfaceName(entry.id);
 
 	// We have an update - call the onUpdatedValue method on the interface
 	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(objectPath, interfaceName);
@@ -176,56 +217,217 @@ bool idleFunc(void *pUserData)
 	return false;
 }
 
-// ---------------------------------------------------------------------------------------------------------------------------------
-//  ____       _       _ _   _       _ _          _   _
-// |  _ \  ___(_)_ __ (_) |_(_) __ _| (_)______ _| |_(_) ___  _ ___
-// | | | |/ _ \ | '_ \| | __| |/ _` | | |_  / _` | __| |/ _ \| '_  |
-// | |_| |  __/ | | | | | |_| | (_| | | |/ / (_| | |_| | (_) | | | |
-// |____/ \___|_|_| |_|_|\__|_|\__,_|_|_/___\__,_|\__|_|\___/|_| |_|
+// Processes a batch of updates from the update queue
 //
+// This method is used to process data on the same thread as our main loop. This allows us to communicate with our service from
+// the outside.
 //
-// ---------------------------------------------------------------------------------------------------------------------------------
+// Returns the number of updates that were delivered
+int processUpdateQueue(void *pUserData)
+{
+	// Don't do anything unless we're running
+	if (ggkGetServerRunState() != ERunning)
+	{
+		return 0;
+	}
 
-// Perform final cleanup of various resources that were allocated while the server was initialized and/or running
-void uninit()
+	// Our batch is only ever used from the server thread, so we keep it around to reuse its storage
+	static UpdateQueue::Batch batch;
+	if (0 == UpdateQueue::takeBatch(batch))
+	{
+		return 0;
+	}
+
+	int delivered = 0;
+	for (const UpdateQueue::Entry &entry : batch)
+	{
+		if (processUpdate(entry, pUserData))
+		{
+			delivered += 1;
+		}
+	}
+
+	batch.clear();
+	return delivered;
+}
+
+// Interns the update queue IDs for every characteristic and descriptor in the hierarchy
+//
+// The application's updates are only accepted for IDs interned here (see `ggkPushUpdateQueue()`), so its producer threads only
+// ever perform lock-free lookups and a bad path can't use up an ID. Each ID is also resolved to its interface, and
+// characteristics backed by the data store are bound to their ID, so that writes to their data reach them without any lookups
+// at all.
+static void internUpdateQueueIds(const DBusObject &object, const DBusObjectPath &basePath = DBusObjectPath())
 {
-  	// We've left our main loop - nullify its pointer so we know we're no longer running
-  	pMainLoop = nullptr;
+	DBusObjectPath path = basePath + object.getPathNode();
 
-	if (nullptr != pBluezAdapterObject)
+	for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
 	{
-		g_object_unref(pBluezAdapterObject);
-		pBluezAdapterObject = nullptr;
+		if (pInterface->getInterfaceType() == GattCharacteristic::kInterfaceType ||
+			pInterface->getInterfaceType() == GattDescriptor::kInterfaceType)
+		{
+			UpdateQueue::Id id = UpdateQueue::intern(path.c_str(), pInterface->getName().c_str());
+			if (UpdateQueue::kInvalidId == id)
+			{
+				Logger::warn(SSTR << "Unable to intern update queue ID for '" << pInterface->getName() << "' at path '" << path << "'");
+				continue;
+			}
+
+			UpdateQueue::setTarget(id, pInterface.get());
+
+			std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+			if (nullptr != pCharacteristic && DataStore::kInvalidKey != pCharacteristic->getDataKey())
+			{
+				DataStore::bind(pCharacteristic->getDataKey(), id);
+			}
+		}
 	}
 
-	if (nullptr != pBluezDeviceObject)
+	for (const DBusObject &child : object.getChildren())
 	{
-		g_object_unref(pBluezDeviceObject);
-		pBluezDeviceObject = nullptr;
+		internUpdateQueueIds(child, path);
 	}
+}
 
-	if (nullptr != pBluezAdapterInterfaceProxy)
+// Wakes the update queue source so that pending updates are processed on the next main loop iteration
+//
+// This method is thread-safe and may be called from any thread. If the update queue source has never existed, this method does
+// nothing; the source will check the queue when it is created.
+//
+// Producers may call this at any moment, including while the server shuts down, so the eventfd is kept open for the life of the
+// process rather than closed with the source. Otherwise a producer could load the descriptor just before it was closed, and
+// write to whatever file later reused its number. A wake while there is no source is harmless: the eventfd stays readable, and
+// the next source is dispatched as soon as it is created.
+//
+// Only the first wake since the source was last dispatched touches the eventfd; the rest are absorbed by `updateQueueWakePending`
+// so that busy producers don't each pay for a system call.
+void wakeUpdateQueue()
+{
+	int fd = updateQueueEventFd;
+	if (fd < 0 || updateQueueWakePending.exchange(true))
 	{
-		g_object_unref(pBluezAdapterInterfaceProxy);
-		pBluezAdapterInterfaceProxy = nullptr;
+		return;
 	}
 
-	if (nullptr != pBluezDeviceInterfaceProxy)
+	uint64_t value = 1;
+	if (write(fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
 	{
-		g_object_unref(pBluezDeviceInterfaceProxy);
-		pBluezDeviceInterfaceProxy = nullptr;
+		Logger::warn(SSTR << "Unable to wake the update queue: " << strerror(errno));
 	}
+}
 
-	if (nullptr != pBluezAdapterPropertiesInterfaceProxy)
+// Dispatch function for our update queue source
+//
+// This is called by GLib when our eventfd becomes readable or when we've marked ourselves as ready (because there were more
+// updates remaining in the queue.)
+static gboolean updateQueueSourceDispatch(GSource *pSource, GSourceFunc /*callback*/, gpointer pUserData)
+{
+	// Consume the wake-up(s). We don't care how many there were, only that there may be data in the queue. We clear the pending
+	// flag first so that any update pushed from here on will wake us again.
+	updateQueueWakePending.exchange(false);
+	uint64_t value = 0;
+	if (read(updateQueueEventFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
 	{
-		g_object_unref(pBluezAdapterPropertiesInterfaceProxy);
-		pBluezAdapterPropertiesInterfaceProxy = nullptr;
+		Logger::warn(SSTR << "Unable to read the update queue eventfd: " << strerror(errno));
 	}
 
-	if (nullptr != pBluezGattManagerProxy)
+	// Producers on the shared-memory data plane wake us through the same eventfd (see ShmDataPlane.cpp)
+	ShmDataPlane::collect();
+
+	g_source_set_ready_time(pSource, -1);
+
+	// Process a batch of updates
+	processUpdateQueue(pUserData);
+
+	// If there's more work to do, dispatch again on the next main loop iteration. Note that we only do this while running; any
+	// updates that arrive before we reach the running state are picked up by the wake in `initializationStateProcessor()`.
+	if (ggkGetServerRunState() == ERunning && !UpdateQueue::isEmpty())
 	{
-		g_object_unref(pBluezGattManagerProxy);
-		pBluezGattManagerProxy = nullptr;
+		g_source_set_ready_time(pSource, 0);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Our update queue source's function table
+static GSourceFuncs updateQueueSourceFuncs =
+{
+	nullptr,                      // prepare
+	nullptr,                      // check
+	updateQueueSourceDispatch,    // dispatch
+	nullptr,                      // finalize
+	nullptr,                      // closure_callback
+	nullptr                       // closure_marshal
+};
+
+// Creates the update queue source and attaches it to the default main context
+//
+// Returns true on success, otherwise false
+bool createUpdateQueueSource()
+{
+	// The eventfd outlives the source (see `wakeUpdateQueue()`), so we only create it once
+	int fd = updateQueueEventFd;
+	if (fd < 0)
+	{
+		fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd < 0)
+		{
+			Logger::error(SSTR << "Unable to create eventfd for the update queue: " << strerror(errno));
+			return false;
+		}
+	}
+
+	pUpdateQueueSource = g_source_new(&updateQueueSourceFuncs, sizeof(GSource));
+	g_source_set_name(pUpdateQueueSource, "ggk-update-queue");
+	g_source_add_unix_fd(pUpdateQueueSource, fd, G_IO_IN);
+	g_source_attach(pUpdateQueueSource, nullptr);
+	updateQueueWakePending = false;
+	updateQueueEventFd = fd;
+
+	// Anything pushed before we existed should be processed as well
+	if (!UpdateQueue::isEmpty())
+	{
+		wakeUpdateQueue();
+	}
+
+	return true;
+}
+
+// Destroys the update queue source (if it exists)
+//
+// The eventfd is left open, since producers may still be waking it (see `wakeUpdateQueue()`.)
+void destroyUpdateQueueSource()
+{
+	if (nullptr != pUpdateQueueSource)
+	{
+		g_source_destroy(pUpdateQueueSource);
+		g_source_unref(pUpdateQueueSource);
+		pUpdateQueueSource = nullptr;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+//  ____       _       _ _   _       _ _          _   _
+// |  _ \  ___(_)_ __ (_) |_(_) __ _| (_)______ _| |_(_) ___  _ ___
+// | | | |/ _ \ | '_ \| | __| |/ _` | | |_  / _` | __| |/ _ \| '_  |
+// | |_| |  __/ | | | | | |_| | (_| | | |/ / (_| | |_| | (_) | | | |
+// |____/ \___|_|_| |_|_|\__|_|\__,_|_|_/___\__,_|\__|_|\___/|_| |_|
+//
+//
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Perform final cleanup of various resources that were allocated while the server was initialized and/or running
+void uninit()
+{
+  	// We've left our main loop - nullify its pointer so we know we're no longer running
+  	pMainLoop = nullptr;
+
+	releaseAdapters();
+
+	if (nullptr != pBluezDeviceInterfaceProxy)
+	{
+		g_object_unref(pBluezDeviceInterfaceProxy);
+		pBluezDeviceInterfaceProxy = nullptr;
 	}
 
 	if (nullptr != pBluezObjectManager)
@@ -236,11 +438,7 @@ void uninit()
 
 	if (!registeredObjectIds.empty())
 	{
-		for (guint id : registeredObjectIds)
-		{
-			g_dbus_connection_unregister_object(pBusConnection, id);
-		}
-		registeredObjectIds.clear();
+		unregisterObjects();
 	}
 
 	if (0 != periodicTimeoutId)
@@ -249,6 +447,11 @@ void uninit()
 		periodicTimeoutId = 0;
 	}
 
+	stopEventTimer();
+	WorkerPool::stop();
+	ShmDataPlane::stop();
+	destroyUpdateQueueSource();
+
   	if (ownedNameId > 0)
   	{
 		g_bus_unown_name(ownedNameId);
@@ -313,8 +516,8 @@ void shutdown()
 // Periodic timer handler
 //
 // A periodic timer is a timer fires every so often (see kPeriodicTimerFrequencySeconds.) This is used for our initialization
-// failure retries, but custom code can also be added to a server description (see `onEvent()`)
-gboolean onPeriodicTimer(gpointer pUserData)
+// failure retries. Events added to the server description (see `onEvent()`) have their own timer (see `startEventTimer()`.)
+gboolean onPeriodicTimer(gpointer /*pUserData*/)
 {
 	// If we're shutting down, don't do anything and stop the periodic timer
 	if (ggkGetServerRunState() > ERunning)
@@ -336,23 +539,98 @@ gboolean onPeriodicTimer(gpointer pUserData)
 		}
 	}
 
-	// If we're registered, then go ahead and emit signals
-	if (bApplicationRegistered)
+	return TRUE;
+}
+
+// Returns the time used by our event timer, in milliseconds
+static uint64_t eventTimeMS()
+{
+	return static_cast<uint64_t>(g_get_monotonic_time() / 1000);
+}
+
+// Arms a one-shot timeout for the next time the event wheel needs attention (if ever)
+static void armEventTimer()
+{
+	uint64_t wakeMS = eventWheel.nextWakeMS();
+	if (TimerWheel::kNever == wakeMS)
 	{
-		// Tick the object hierarchy
-		//
-		// The real goal here is to have the objects tick their interfaces (see `onEvent()` method when adding interfaces inside
-		// 'Server::Server()'
-		for (const DBusObject &object : TheServer->getObjects())
+		return;
+	}
+
+	uint64_t nowMS = eventTimeMS();
+	guint delayMS = wakeMS > nowMS ? static_cast<guint>(std::min<uint64_t>(wakeMS - nowMS, G_MAXUINT)) : 0;
+	eventTimeoutId = g_timeout_add_full(G_PRIORITY_DEFAULT, delayMS, onEventTimer, nullptr, nullptr);
+}
+
+// Event timer handler
+//
+// Fires the events that are due (see `onEvent()` method when adding interfaces inside 'Server::Server()') and re-arms the timer
+// for the next one. Events are only delivered while our application is registered with BlueZ.
+static gboolean onEventTimer(gpointer /*pUserData*/)
+{
+	eventTimeoutId = 0;
+
+	// If we're shutting down, don't do anything and let the timer go
+	if (ggkGetServerRunState() > ERunning)
+	{
+		return FALSE;
+	}
+
+	bool deliver = isApplicationRegistered();
+	eventWheel.advance(eventTimeMS(), [deliver](const DBusInterface &owner, const TickEvent &event)
+	{
+		if (deliver)
 		{
-			if (object.isPublished())
-			{
-				object.tickEvents(pBusConnection, pUserData);
-			}
+			// Our events have always been given the bus connection as their user data
+			owner.fireEvent(event, pBusConnection, pBusConnection);
+		}
+	});
+
+	armEventTimer();
+	return FALSE;
+}
+
+// Schedules the events in our server description and starts the timers that drive them
+//
+// The hierarchy is only walked here, once; after that, the cost of driving the events depends only on how many are due.
+static void startEventTimer()
+{
+	stopEventTimer();
+
+	uint64_t nowMS = eventTimeMS();
+	eventWheel.reset(nowMS);
+	for (const DBusObject &object : TheServer->getObjects())
+	{
+		if (object.isPublished())
+		{
+			object.scheduleEvents(eventWheel, nowMS);
 		}
 	}
 
-	return TRUE;
+	Logger::debug(SSTR << "Scheduled " << eventWheel.size() << " event(s)");
+	armEventTimer();
+
+	// High-rate events have their own timers (see StreamTimers.cpp)
+	StreamTimers::start(TheServer->getObjects(), [](const GattCharacteristic &owner, const TickEvent &event)
+	{
+		if (isApplicationRegistered())
+		{
+			owner.fireEvent(event, pBusConnection, pBusConnection);
+		}
+	});
+}
+
+// Stops the timers that drive the events in our server description
+static void stopEventTimer()
+{
+	if (0 != eventTimeoutId)
+	{
+		g_source_remove(eventTimeoutId);
+		eventTimeoutId = 0;
+	}
+
+	eventWheel.reset(0);
+	StreamTimers::stop();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -364,8 +642,44 @@ gboolean onPeriodicTimer(gpointer pUserData)
 //
 // Our event handlers. These are generic, as they parcel out the work to the appropriate server objects (see 'Server::Server()' for
 // the code that manages event handlers.)
+//
+// Each object is registered with D-Bus along with a binding to the interface it represents (as the registration's user data), so
+// these handlers go straight to the target interface without searching the server's objects. The user data passed on to the
+// server description's callbacks is unchanged (nullptr.)
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// The user data registered with each D-Bus object: a reference to the interface that handles its calls
+typedef std::shared_ptr<const DBusInterface> DBusInterfaceBinding;
+
+// Releases a DBusInterfaceBinding when its D-Bus object is unregistered
+static void freeDBusInterfaceBinding(gpointer pBinding)
+{
+	delete static_cast<DBusInterfaceBinding *>(pBinding);
+}
+
+// Counts a GATT read or write against the central that made it (see ConnectionTable.cpp)
+//
+// BlueZ names the central in the "device" entry of the options passed to ReadValue and WriteValue.
+static void countConnectionAccess(const gchar *pMethodName, GVariant *pParameters)
+{
+	bool isRead = 0 == strcmp(pMethodName, "ReadValue") && g_variant_is_of_type(pParameters, G_VARIANT_TYPE("(a{sv})"));
+	bool isWrite = !isRead && 0 == strcmp(pMethodName, "WriteValue") && g_variant_is_of_type(pParameters, G_VARIANT_TYPE("(aya{sv})"));
+	if (!isRead && !isWrite)
+	{
+		return;
+	}
+
+	GVariant *pOptions = g_variant_get_child_value(pParameters, isRead ? 0 : 1);
+	const gchar *pDevicePath = nullptr;
+	if (g_variant_lookup(pOptions, "device", "&o", &pDevicePath))
+	{
+		ConnectionTable::Key key = ConnectionTable::keyFromDevicePath(pDevicePath);
+		if (isRead) { ConnectionTable::countRead(key); } else { ConnectionTable::countWrite(key); }
+	}
+
+	g_variant_unref(pOptions);
+}
+
 // Handle D-Bus method calls
 void onMethodCall
 (
@@ -379,12 +693,14 @@ void onMethodCall
 	gpointer pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
+	// Our user data is the interface that this object was registered with (see `registerObjectHierarchy()`)
+	const DBusInterfaceBinding *pBinding = static_cast<const DBusInterfaceBinding *>(pUserData);
 
-	if (!TheServer->callMethod(objectPath, pInterfaceName, pMethodName, pConnection, pParameters, pInvocation, pUserData))
+	countConnectionAccess(pMethodName, pParameters);
+
+	if (nullptr == pBinding || !(*pBinding)->callMethod(pMethodName, pConnection, pParameters, pInvocation, nullptr))
 	{
-		Logger::error(SSTR << " + Method not found: [" << pSender << "]:[" << objectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
+		Logger::error(SSTR << " + Method not found: [" << pSender << "]:[" << pObjectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
 		g_dbus_method_invocation_return_dbus_error(pInvocation, kErrorNotImplemented.c_str(), "This method is not implemented");
 		return;
 	}
@@ -404,12 +720,11 @@ GVariant *onGetProperty
 	gpointer         pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
-
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
+	// Our user data is the interface that this object was registered with (see `registerObjectHierarchy()`)
+	const DBusInterfaceBinding *pBinding = static_cast<const DBusInterfaceBinding *>(pUserData);
+	const GattProperty *pProperty = nullptr == pBinding ? nullptr : Server::findProperty(*pBinding, pPropertyName);
 
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	std::string propertyPath = std::string("[") + pSender + "]:[" + pObjectPath + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
 	if (!pProperty)
 	{
 		Logger::error(SSTR << "Property(get) not found: " << propertyPath);
@@ -425,7 +740,7 @@ GVariant *onGetProperty
 	}
 
 	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, ppError, pUserData);
+	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, pObjectPath, pInterfaceName, pPropertyName, ppError, nullptr);
 
 	if (nullptr == pResult)
 	{
@@ -449,12 +764,11 @@ gboolean onSetProperty
 	gpointer         pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
-
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
+	// Our user data is the interface that this object was registered with (see `registerObjectHierarchy()`)
+	const DBusInterfaceBinding *pBinding = static_cast<const DBusInterfaceBinding *>(pUserData);
+	const GattProperty *pProperty = nullptr == pBinding ? nullptr : Server::findProperty(*pBinding, pPropertyName);
 
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	std::string propertyPath = std::string("[") + pSender + "]:[" + pObjectPath + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
 	if (!pProperty)
 	{
 		Logger::error(SSTR << "Property(set) not found: " << propertyPath);
@@ -470,7 +784,7 @@ gboolean onSetProperty
 	}
 
 	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	if (!pProperty->getSetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, pValue, ppError, pUserData))
+	if (!pProperty->getSetterFunc()(pConnection, pSender, pObjectPath, pInterfaceName, pPropertyName, pValue, ppError, nullptr))
 	{
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath).c_str(), pSender);
 	    return false;
@@ -513,8 +827,10 @@ void setRetryFailure()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Use the BlueZ GATT Manager proxy to register our GATT application with BlueZ
-void doRegisterApplication()
+// Use an adapter's BlueZ GATT Manager proxy to register our GATT application with BlueZ on that adapter
+//
+// `adapterIndex` is the adapter's index in `bluezAdapters`
+void doRegisterApplication(size_t adapterIndex)
 {
 	g_auto(GVariantBuilder) builder;
 	g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
@@ -522,7 +838,7 @@ void doRegisterApplication()
 
 	g_dbus_proxy_call
 	(
-		pBluezGattManagerProxy,         // GDBusProxy *proxy
+		bluezAdapters[adapterIndex].pGattManagerProxy, // GDBusProxy *proxy
 		"RegisterApplication",          // const gchar *method_name   (ex: "GetManagedObjects")
 		pParams,                        // GVariant *parameters
 		G_DBUS_CALL_FLAGS_NONE,         // GDBusCallFlags flags
@@ -530,27 +846,29 @@ void doRegisterApplication()
 		nullptr,                        // GCancellable *cancellable
 
 		// GAsyncReadyCallback callback
-		[] (GObject * /*pSourceObject*/, GAsyncResult *pAsyncResult, gpointer /*pUserData*/)
+		[] (GObject * /*pSourceObject*/, GAsyncResult *pAsyncResult, gpointer pUserData)
 		{
+			BluezAdapter &adapter = bluezAdapters[GPOINTER_TO_UINT(pUserData)];
+
 			GError *pError = nullptr;
-			GVariant *pVariant = g_dbus_proxy_call_finish(pBluezGattManagerProxy, pAsyncResult, &pError);
+			GVariant *pVariant = g_dbus_proxy_call_finish(adapter.pGattManagerProxy, pAsyncResult, &pError);
 			if (nullptr == pVariant)
 			{
-				Logger::error(SSTR << "Failed to register application: " << (nullptr == pError ? "Unknown" : pError->message));
+				Logger::error(SSTR << "Failed to register application on '" << adapter.objectPath << "': " << (nullptr == pError ? "Unknown" : pError->message));
 				setRetryFailure();
 			}
 			else
 			{
 				g_variant_unref(pVariant);
-				Logger::debug(SSTR << "GATT application registered with BlueZ");
-				bApplicationRegistered = true;
+				Logger::debug(SSTR << "GATT application registered with BlueZ on '" << adapter.objectPath << "'");
+				adapter.applicationRegistered = true;
 			}
 
 			// Keep going...
 			initializationStateProcessor();
 		},
 
-		nullptr                         // gpointer user_data
+		GUINT_TO_POINTER(static_cast<guint>(adapterIndex)) // gpointer user_data
 	);
 }
 
@@ -562,11 +880,25 @@ void doRegisterApplication()
 //  \___/|_.__// |\___|\___|\__| |_|  \___|\__, |_|___/\__|_|  \__,_|\__|_|\___/|_| |_|
 //           |__/                          |___/
 //
-// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. The easiest way to do this is to
-// use an XML description of our D-Bus objects.
+// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. Each interface describes itself
+// to D-Bus through the introspection data built by `generateInterfaceInfo()`, straight from our server description (there is no
+// XML to generate and parse.)
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath = DBusObjectPath(), int depth = 1)
+// Unregisters any objects we have registered with D-Bus
+static void unregisterObjects()
+{
+	for (guint id : registeredObjectIds)
+	{
+		g_dbus_connection_unregister_object(pBusConnection, id);
+	}
+	registeredObjectIds.clear();
+}
+
+// Registers each interface of an object (and its children) with D-Bus
+//
+// Returns true on success, otherwise false
+bool registerObjectHierarchy(const DBusObject &object, const DBusObjectPath &basePath = DBusObjectPath(), int depth = 1)
 {
 	std::string prefix;
 	prefix.insert(0, depth * 2, ' ');
@@ -576,75 +908,67 @@ void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath
 	interfaceVtable.get_property = onGetProperty;
 	interfaceVtable.set_property = onSetProperty;
 
-	GDBusInterfaceInfo **ppInterface = pNode->interfaces;
+	DBusObjectPath path = basePath + object.getPathNode();
 
-	Logger::debug(SSTR << prefix << "+ " << pNode->path);
+	Logger::debug(SSTR << prefix << "+ " << object.getPathNode());
 
-	while(nullptr != *ppInterface)
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
 	{
 		GError *pError = nullptr;
-		Logger::debug(SSTR << prefix << "    (iface: " << (*ppInterface)->name << ")");
+		Logger::debug(SSTR << prefix << "    (iface: " << pInterface->getName() << ")");
+
+		GDBusInterfaceInfo *pInterfaceInfo = pInterface->generateInterfaceInfo();
 		guint registeredObjectId = g_dbus_connection_register_object
 		(
 			pBusConnection,             // GDBusConnection *connection
-			basePath.c_str(),           // const gchar *object_path
-			*ppInterface,               // GDBusInterfaceInfo *interface_info
+			path.c_str(),               // const gchar *object_path
+			pInterfaceInfo,             // GDBusInterfaceInfo *interface_info
 			&interfaceVtable,           // const GDBusInterfaceVTable *vtable
-			nullptr,                    // gpointer user_data
-			nullptr,                    // GDestroyNotify user_data_free_func
+			new DBusInterfaceBinding(pInterface), // gpointer user_data
+			freeDBusInterfaceBinding,   // GDestroyNotify user_data_free_func
 			&pError                     // GError **error
 		);
 
+		// The connection holds its own reference to the interface info
+		g_dbus_interface_info_unref(pInterfaceInfo);
+
 		if (0 == registeredObjectId)
 		{
 			Logger::error(SSTR << "Failed to register object: " << (nullptr == pError ? "Unknown" : pError->message));
-
-			// Cleanup and pretend like we were never here
-			g_dbus_node_info_unref(pNode);
-			registeredObjectIds.clear();
-
-			// Try again later
-			setRetryFailure();
-			return;
+			g_clear_error(&pError);
+			return false;
 		}
 
 		// Save the registered object Id so we can clean it up later
 		registeredObjectIds.push_back(registeredObjectId);
-
-		++ppInterface;
 	}
 
-	GDBusNodeInfo **ppChild = pNode->nodes;
-	while(nullptr != *ppChild)
+	for (const DBusObject &child : object.getChildren())
 	{
-		registerNodeHierarchy(*ppChild, basePath + (*ppChild)->path, depth + 1);
-
-		++ppChild;
+		if (!registerObjectHierarchy(child, path, depth + 1))
+		{
+			return false;
+		}
 	}
+
+	return true;
 }
 
 void registerObjects()
 {
-	// Parse each object into an XML interface tree
+	Logger::debug(SSTR << "Registering object hierarchy with D-Bus hierarchy");
+
 	for (const DBusObject &object : TheServer->getObjects())
 	{
-		GError *pError = nullptr;
-		std::string xmlString = object.generateIntrospectionXML();
-		GDBusNodeInfo *pNode = g_dbus_node_info_new_for_xml(xmlString.c_str(), &pError);
-		if (nullptr == pNode)
+		if (!registerObjectHierarchy(object))
 		{
-			Logger::error(SSTR << "Failed to introspect XML: " << (nullptr == pError ? "Unknown" : pError->message));
+			// Cleanup and pretend like we were never here
+			unregisterObjects();
+
+			// Try again later
 			setRetryFailure();
 			return;
 		}
-
-		Logger::debug(SSTR << "Registering object hierarchy with D-Bus hierarchy");
-
-		// Register the node hierarchy
-		registerNodeHierarchy(pNode, DBusObjectPath(pNode->path));
-
-		// Cleanup the node
-		g_dbus_node_info_unref(pNode);
 	}
 
 	// Keep going
@@ -664,19 +988,49 @@ void registerObjects()
 // Configure an adapter to ensure it is setup the way we need. We turn things on that we need and turn everything else off
 // (to maximize security.)
 //
-// Note that this only works for the first adapter (index 0). Search for kControllerIndex for information.
+// `adapterIndex` is the adapter's index in `bluezAdapters`. Every adapter we serve is configured the same way.
 //
 // See also: https://git.kernel.org/pub/scm/bluetooth/bluez.git/tree/doc/mgmt-api.txt
-void configureAdapter()
+void configureAdapter(size_t adapterIndex)
 {
-	Mgmt mgmt;
+	// In single-threaded mode nothing may block the main loop, so we carry on once the controller information arrives. Without
+	// it, we would be comparing our configuration against stale (or never received) settings, so we try again later instead.
+	if (HciAdapter::getInstance().isSingleThreaded())
+	{
+		HciAdapter::getInstance().sync(bluezAdapters[adapterIndex].controllerIndex, [adapterIndex](bool success)
+		{
+			if (!success) { setRetry(); return; }
+			applyAdapterConfiguration(adapterIndex);
+		});
+		return;
+	}
+
+	applyAdapterConfiguration(adapterIndex);
+}
+
+// Marks an adapter as configured and moves on to the next initialization step
+static void adapterConfigured(size_t adapterIndex)
+{
+	Logger::info(SSTR << "The Bluetooth adapter '" << bluezAdapters[adapterIndex].objectPath << "' is fully configured");
+
+	// We're all set, nothing to do!
+	bluezAdapters[adapterIndex].configured = true;
+	initializationStateProcessor();
+}
+
+// Compares an adapter's current settings (see `HciAdapter::sync()`) with our own and sends whatever commands are needed to
+// bring them in line
+static void applyAdapterConfiguration(size_t adapterIndex)
+{
+	uint16_t controllerIndex = bluezAdapters[adapterIndex].controllerIndex;
+	Mgmt mgmt(controllerIndex);
 
 	// Get our properly truncated advertising names
 	std::string advertisingName = Mgmt::truncateName(TheServer->getAdvertisingName());
 	std::string advertisingShortName = Mgmt::truncateShortName(TheServer->getAdvertisingShortName());
 
 	// Find out what our current settings are
-	HciAdapter::ControllerInformation info = HciAdapter::getInstance().getControllerInformation();
+	HciAdapter::ControllerInformation info = HciAdapter::getInstance().getControllerInformation(controllerIndex);
 
 	// Are all of our settings the way we want them?
 	bool pwFlag = info.currentSettings.isSet(HciAdapter::EHciPowered) == true;
@@ -692,18 +1046,21 @@ void configureAdapter()
 	// If everything is setup already, we're done
 	if (!pwFlag || !leFlag || !brFlag || !scFlag || !bnFlag || !cnFlag || !diFlag || !adFlag || !anFlag)
 	{
+		// Send the settings without waiting on each response; the adapter processes the commands in order
+		mgmt.beginBatch();
+
 		// We need it off to start with
 		if (pwFlag)
 		{
 			Logger::debug("Powering off");
-			if (!mgmt.setPowered(false)) { setRetry(); return; }
+			if (!mgmt.setPowered(false)) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Enable the LE state (we always set this state if it's not set)
 		if (!leFlag)
 		{
 			Logger::debug("Enabling LE");
-			if (!mgmt.setLE(true)) { setRetry(); return; }
+			if (!mgmt.setLE(true)) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Br/Edr state?
@@ -712,61 +1069,93 @@ void configureAdapter()
 		if (!brFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
-			if (!mgmt.setBredr(TheServer->getEnableBREDR())) { setRetry(); return; }
+			if (!mgmt.setBredr(TheServer->getEnableBREDR())) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Secure Connectinos state?
 		if (!scFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
-			if (!mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0)) { setRetry(); return; }
+			if (!mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0)) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Bondable state?
 		if (!bnFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
-			if (!mgmt.setBondable(TheServer->getEnableBondable())) { setRetry(); return; }
+			if (!mgmt.setBondable(TheServer->getEnableBondable())) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Connectable state?
 		if (!cnFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
-			if (!mgmt.setConnectable(TheServer->getEnableConnectable())) { setRetry(); return; }
+			if (!mgmt.setConnectable(TheServer->getEnableConnectable())) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Discoverable state?
 		if (!diFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
-			if (!mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0)) { setRetry(); return; }
+			if (!mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0)) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Change the Advertising state?
 		if (!adFlag)
 		{
 			Logger::debug(SSTR << (TheServer->getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
-			if (!mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0)) { setRetry(); return; }
+			if (!mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0)) { mgmt.endBatch(); setRetry(); return; }
 		}
 
 		// Set the name?
 		if (!anFlag)
 		{
 			Logger::info(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
-			if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { setRetry(); return; }
+			if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { mgmt.endBatch(); setRetry(); return; }
+		}
+
+		// Wait for the adapter to work through the batch (or in single-threaded mode, have it tell us when it has) before turning
+		// it back on. Powering on behind a setting that failed would leave the adapter running half configured.
+		if (HciAdapter::getInstance().isSingleThreaded())
+		{
+			mgmt.endBatch([adapterIndex](bool success)
+			{
+				if (!success) { setRetry(); return; }
+				powerOnAdapter(adapterIndex);
+			});
+			return;
 		}
 
-		// Turn it back on
-		Logger::debug("Powering on");
-		if (!mgmt.setPowered(true)) { setRetry(); return; }
+		if (!mgmt.endBatch()) { setRetry(); return; }
+		powerOnAdapter(adapterIndex);
+		return;
 	}
 
-	Logger::info("The Bluetooth adapter is fully configured");
+	adapterConfigured(adapterIndex);
+}
+
+// Turns an adapter back on once all of its settings have been applied (see `applyAdapterConfiguration()`)
+static void powerOnAdapter(size_t adapterIndex)
+{
+	Mgmt mgmt(bluezAdapters[adapterIndex].controllerIndex);
 
-	// We're all set, nothing to do!
-	bAdapterConfigured = true;
-	initializationStateProcessor();
+	Logger::debug("Powering on");
+
+	// In single-threaded mode, even a single command has to report back through a batch
+	if (HciAdapter::getInstance().isSingleThreaded())
+	{
+		mgmt.beginBatch();
+		if (!mgmt.setPowered(true)) { mgmt.endBatch(); setRetry(); return; }
+		mgmt.endBatch([adapterIndex](bool success)
+		{
+			if (!success) { setRetry(); return; }
+			adapterConfigured(adapterIndex);
+		});
+		return;
+	}
+
+	if (!mgmt.setPowered(true)) { setRetry(); return; }
+	adapterConfigured(adapterIndex);
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -779,8 +1168,69 @@ void configureAdapter()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-// Find the BlueZ's GATT Manager interface for the *first* Bluetooth adapter provided by BlueZ. We'll need this to register our
-// GATT server with BlueZ.
+// Sets the adapters to serve, as a bitmask of controller indices (bit N selects the adapter at "/org/bluez/hciN")
+//
+// A mask of 0 (the default) serves only the first adapter that BlueZ lists. This must be set before the server is started.
+void setAdapterMask(uint32_t mask)
+{
+	adapterMask = mask;
+}
+
+// Returns the controller index of a BlueZ adapter from its object path ("/org/bluez/hciN"), or -1 if the path isn't in that form
+static int controllerIndexFromPath(const std::string &objectPath)
+{
+	size_t pos = objectPath.rfind("/hci");
+	if (pos == std::string::npos || pos + 4 >= objectPath.length())
+	{
+		return -1;
+	}
+
+	char *pEnd = nullptr;
+	long index = strtol(objectPath.c_str() + pos + 4, &pEnd, 10);
+	if (*pEnd != '\0' || index < 0 || index >= HciAdapter::kNonController)
+	{
+		return -1;
+	}
+
+	return static_cast<int>(index);
+}
+
+// Returns true if our GATT application is registered with BlueZ on at least one adapter
+static bool isApplicationRegistered()
+{
+	for (const BluezAdapter &adapter : bluezAdapters)
+	{
+		if (adapter.applicationRegistered)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Releases the BlueZ object and proxies held for an adapter
+static void releaseAdapter(BluezAdapter &adapter)
+{
+	if (nullptr != adapter.pAdapterInterfaceProxy) { g_object_unref(adapter.pAdapterInterfaceProxy); }
+	if (nullptr != adapter.pPropertiesInterfaceProxy) { g_object_unref(adapter.pPropertiesInterfaceProxy); }
+	if (nullptr != adapter.pGattManagerProxy) { g_object_unref(adapter.pGattManagerProxy); }
+	if (nullptr != adapter.pObject) { g_object_unref(adapter.pObject); }
+}
+
+// Releases the BlueZ objects and proxies for each of our adapters and forgets them
+static void releaseAdapters()
+{
+	for (BluezAdapter &adapter : bluezAdapters)
+	{
+		releaseAdapter(adapter);
+	}
+
+	bluezAdapters.clear();
+}
+
+// Find the BlueZ GATT Manager interface for each Bluetooth adapter we serve (see `setAdapterMask()`). We'll need these to
+// register our GATT server with BlueZ.
 void findAdapterInterface()
 {
 	// Get a list of the BlueZ's D-Bus objects
@@ -792,63 +1242,71 @@ void findAdapterInterface()
 		return;
 	}
 
-	// Scan the list of objects we find one with a GATT manager interface
+	uint32_t mask = adapterMask;
+
+	// Scan the list of objects for those with a GATT manager interface
 	//
-	// Note that if there are multiple interfaces, we will only find the first
-	for (guint i = 0; i < g_list_length(pObjects) && bluezGattManagerInterfaceName.empty(); ++i)
+	// Without a mask, we stop at the first one
+	for (GList *pEntry = pObjects; nullptr != pEntry && (0 != mask || bluezAdapters.empty()); pEntry = pEntry->next)
 	{
 		// Current object in question
-		pBluezAdapterObject = static_cast<GDBusObject *>(g_list_nth_data(pObjects, i));
-		if (nullptr == pBluezAdapterObject) { continue; }
+		GDBusObject *pObject = static_cast<GDBusObject *>(pEntry->data);
+		if (nullptr == pObject) { continue; }
+
+		// Is this an adapter we want?
+		std::string objectPath = g_dbus_object_get_object_path(pObject);
+		int controllerIndex = controllerIndexFromPath(objectPath);
+		if (0 != mask && (controllerIndex < 0 || controllerIndex >= 32 || (mask & (1u << controllerIndex)) == 0))
+		{
+			continue;
+		}
+
+		BluezAdapter adapter;
+		adapter.controllerIndex = controllerIndex < 0 ? HciAdapter::kDefaultControllerIndex : static_cast<uint16_t>(controllerIndex);
+		adapter.objectPath = objectPath;
+		adapter.pObject = nullptr;
+		adapter.pAdapterInterfaceProxy = nullptr;
+		adapter.pPropertiesInterfaceProxy = nullptr;
+		adapter.configured = false;
+		adapter.applicationRegistered = false;
 
 		// See if it has a GATT manager interface
-		pBluezGattManagerProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.bluez.GattManager1"));
-		if (nullptr == pBluezGattManagerProxy) { continue; }
+		adapter.pGattManagerProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pObject, "org.bluez.GattManager1"));
+		if (nullptr == adapter.pGattManagerProxy) { continue; }
+
+		// We'll hold on to the adapter (and its proxies) beyond the life of the list
+		adapter.pObject = static_cast<GDBusObject *>(g_object_ref(pObject));
+		bluezAdapters.push_back(adapter);
+		BluezAdapter &added = bluezAdapters.back();
 
 		// Get the interface proxy for this adapter - this will come in handy later
-		pBluezAdapterInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.bluez.Adapter1"));
-		if (nullptr == pBluezAdapterInterfaceProxy)
+		added.pAdapterInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pObject, "org.bluez.Adapter1"));
+		if (nullptr == added.pAdapterInterfaceProxy)
 		{
-			Logger::warn(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1'");
+			Logger::warn(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1' on '" << objectPath << "'");
+			releaseAdapter(added);
+			bluezAdapters.pop_back();
 			continue;
 		}
 
 		// Get the interface proxy for this adapter's properties - this will come in handy later
-		pBluezAdapterPropertiesInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.freedesktop.DBus.Properties"));
-		if (nullptr == pBluezAdapterPropertiesInterfaceProxy)
+		added.pPropertiesInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pObject, "org.freedesktop.DBus.Properties"));
+		if (nullptr == added.pPropertiesInterfaceProxy)
 		{
-			Logger::warn(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties'");
+			Logger::warn(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties' on '" << objectPath << "'");
+			releaseAdapter(added);
+			bluezAdapters.pop_back();
 			continue;
 		}
 
-		// Finally, save off the interface name, we're done!
-		bluezGattManagerInterfaceName = g_dbus_proxy_get_object_path(pBluezGattManagerProxy);
-		break;
+		Logger::info(SSTR << "Serving adapter '" << objectPath << "' (controller index " << added.controllerIndex << ")");
 	}
 
-	// Get a fresh copy of our objects so we can release the entire list
-	pBluezAdapterObject = g_dbus_object_manager_get_object(pBluezObjectManager, g_dbus_object_get_object_path(pBluezAdapterObject));
-
-	// We'll need access to the device object so we can set properties on it
-	pBluezDeviceObject = g_dbus_object_manager_get_object(pBluezObjectManager, g_dbus_object_get_object_path(pBluezAdapterObject));
-
 	// Cleanup the list
-	for (guint i = 0; i < g_list_length(pObjects) && bluezGattManagerInterfaceName.empty(); ++i)
-	{
-		g_object_unref(g_list_nth_data(pObjects, i));
-	}
+	g_list_free_full(pObjects, g_object_unref);
 
-	g_list_free(pObjects);
-
-	// If we didn't find the adapter object, reset things and we'll try again later
-	if (nullptr == pBluezAdapterObject || nullptr == pBluezDeviceObject)
-	{
-		Logger::warn(SSTR << "Unable to find BlueZ objects outside of object list");
-		bluezGattManagerInterfaceName.clear();
-	}
-
-	// If we never ended up with an interface name, bail now
-	if (bluezGattManagerInterfaceName.empty())
+	// If we never found an adapter, bail now
+	if (bluezAdapters.empty())
 	{
 		Logger::error(SSTR << "Unable to find the adapter");
 		setRetryFailure();
@@ -945,6 +1403,9 @@ void doOwnedNameAcquire()
 				shutdown();
 			}
 
+			// Events in our server description run on their own timer
+			startEventTimer();
+
 			// Bus name acquired
 			bOwnedNameAcquired = true;
 
@@ -1076,21 +1537,24 @@ void initializationStateProcessor()
 	//
 	// Find the adapter interface
 	//
-	if (bluezGattManagerInterfaceName.empty())
+	if (bluezAdapters.empty())
 	{
-		Logger::debug(SSTR << "Finding BlueZ GattManager1 interface");
+		Logger::debug(SSTR << "Finding BlueZ GattManager1 interfaces");
 		findAdapterInterface();
 		return;
 	}
 
 	//
-	// Find the adapter interface
+	// Configure the adapters, one at a time
 	//
-	if (!bAdapterConfigured)
+	for (size_t i = 0; i < bluezAdapters.size(); ++i)
 	{
-		Logger::debug(SSTR << "Configuring BlueZ adapter '" << bluezGattManagerInterfaceName << "'");
-		configureAdapter();
-		return;
+		if (!bluezAdapters[i].configured)
+		{
+			Logger::debug(SSTR << "Configuring BlueZ adapter '" << bluezAdapters[i].objectPath << "'");
+			configureAdapter(i);
+			return;
+		}
 	}
 
 	//
@@ -1103,13 +1567,16 @@ void initializationStateProcessor()
 		return;
 	}
 
-	// Register our appliation with the BlueZ GATT manager
-	if (!bApplicationRegistered)
+	// Register our appliation with the BlueZ GATT manager of each adapter
+	for (size_t i = 0; i < bluezAdapters.size(); ++i)
 	{
-		Logger::debug(SSTR << "Registering application with BlueZ GATT manager");
+		if (!bluezAdapters[i].applicationRegistered)
+		{
+			Logger::debug(SSTR << "Registering application with BlueZ GATT manager on '" << bluezAdapters[i].objectPath << "'");
 
-		doRegisterApplication();
-		return;
+			doRegisterApplication(i);
+			return;
+		}
 	}
 
 	// At this point, we should be fully initialized
@@ -1123,6 +1590,9 @@ void initializationStateProcessor()
 
 	// Successful initialization - switch to running state
 	setServerRunState(ERunning);
+
+	// Process any updates that were queued while we were initializing
+	wakeUpdateQueue();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -1143,6 +1613,14 @@ void runServerThread()
 	// Set the initialization state
 	setServerRunState(EInitializing);
 
+	// Intern the update queue IDs for our characteristics and descriptors
+	//
+	// The application can only push updates for these (see `ggkPushUpdateQueue()`), so we do this before anything else.
+	for (const DBusObject &object : TheServer->getObjects())
+	{
+		internUpdateQueueIds(object);
+	}
+
 	// Start our state processor, which is really just a simplified state machine that steps us through an asynchronous
 	// initialization process.
 	//
@@ -1158,29 +1636,16 @@ void runServerThread()
 	Logger::debug(SSTR << "Creating GLib main loop");
 	pMainLoop = g_main_loop_new(NULL, FALSE);
 
-	// Add the idle function
+	// Add the update queue source
 	//
-	// Note that we actually run the idle function from a lambda. This allows us to manage the inter-idle sleep so we don't
-	// soak up 100% of our CPU.
-	guint res = g_idle_add
-	(
-		[](gpointer pUserData) -> gboolean
-		{
-			// Try to process some data and if no data is processed, sleep for the requested frequency
-			if (!idleFunc(pUserData))
-			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(kIdleFrequencyMS));
-			}
-
-			// Always return TRUE so our idle remains in tact
-			return TRUE;
-		},
-		nullptr
-	);
-
-	if (res == 0)
+	// This source is woken (via an eventfd) whenever an update is pushed, so we don't need to poll the queue.
+	if (!createUpdateQueueSource())
+	{
+		Logger::error(SSTR << "Unable to add update queue source to main loop");
+	}
+	else if (!ShmDataPlane::start(TheServer->getObjects(), TheServer->getServiceName(), updateQueueEventFd))
 	{
-		Logger::error(SSTR << "Unable to add idle to main loop");
+		Logger::warn(SSTR << "Running without the shared-memory data plane");
 	}
 
 	Logger::trace(SSTR << "Starting GLib main loop");
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace ggk {
 
 // Trigger a graceful, asynchronous shutdown of the server
@@ -29,6 +31,16 @@ namespace ggk {
 // This method is non-blocking and as such, will only trigger the shutdown process but not wait for it
 void shutdown();
 
+// Wakes the update queue source so that pending updates are processed on the next main loop iteration
+//
+// This method is thread-safe and may be called from any thread
+void wakeUpdateQueue();
+
+// Sets the adapters to serve, as a bitmask of controller indices (bit N selects the adapter at "/org/bluez/hciN")
+//
+// A mask of 0 (the default) serves only the first adapter that BlueZ lists. This must be set before the server is started.
+void setAdapterMask(uint32_t mask);
+
 // Entry point for the asynchronous server thread
 //
 // This method should not be called directly, instead, direct your attention over to `ggkStart()`
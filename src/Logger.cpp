@@ -115,6 +115,11 @@ void Logger::registerAlwaysReceiver(GGKLogReceiver receiver) { Logger::logReceiv
 // appropriate logging action. To unregister, call with `nullptr`
 void Logger::registerTraceReceiver(GGKLogReceiver receiver) { Logger::logReceiverTrace = receiver; }
 
+// Returns true if a debug receiver is registered
+//
+// Use this to skip building expensive debug text (such as hex dumps) that nobody would see.
+bool Logger::isDebugEnabled() { return nullptr != Logger::logReceiverDebug; }
+
 //
 // Logging actions
 //
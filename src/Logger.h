@@ -72,6 +72,11 @@ public:
 	// appropriate logging action. To unregister, call with `nullptr`
 	static void registerTraceReceiver(GGKLogReceiver receiver);
 
+	// Returns true if a debug receiver is registered
+	//
+	// Use this to skip building expensive debug text (such as hex dumps) that nobody would see.
+	static bool isDebugEnabled();
+
 
 	//
 	// Logging actions
@@ -24,6 +24,8 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
+#include <chrono>
+#include <memory>
 
 #include "Mgmt.h"
 #include "Logger.h"
@@ -36,9 +38,12 @@ namespace ggk {
 // Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 // of the first device (0) will be used.
 Mgmt::Mgmt(uint16_t controllerIndex)
-: controllerIndex(controllerIndex)
+: controllerIndex(controllerIndex), batching(false)
 {
-	HciAdapter::getInstance().sync(controllerIndex);
+	if (!HciAdapter::getInstance().isSingleThreaded())
+	{
+		HciAdapter::getInstance().sync(controllerIndex);
+	}
 }
 
 // Set the adapter name and short name
@@ -71,7 +76,7 @@ bool Mgmt::setName(std::string name, std::string shortName)
 	memset(request.shortName, 0, sizeof(request.shortName));
 	snprintf(request.shortName, sizeof(request.shortName), "%s", shortName.c_str());
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!sendRequest(request))
 	{
 		Logger::warn(SSTR << "  + Failed to set name");
 		return false;
@@ -100,7 +105,7 @@ bool Mgmt::setDiscoverable(uint8_t disc, uint16_t timeout)
 	request.disc = disc;
 	request.timeout = timeout;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!sendRequest(request))
 	{
 		Logger::warn(SSTR << "  + Failed to set discoverable");
 		return false;
@@ -127,7 +132,7 @@ bool Mgmt::setState(uint16_t commandCode, uint16_t controllerId, uint8_t newStat
 	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
 	request.state = newState;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!sendRequest(request))
 	{
 		Logger::warn(SSTR << "  + Failed to set " << HciAdapter::kCommandCodeNames[commandCode] << " state to: " << static_cast<int>(newState));
 		return false;
@@ -193,6 +198,129 @@ bool Mgmt::setAdvertising(uint8_t newState)
 	return setState(Mgmt::ESetAdvertisingCommand, controllerIndex, newState);
 }
 
+// Starts a batch of commands
+//
+// Until `endBatch()` is called, commands are sent without waiting for their responses, so that the adapter can work through them
+// back to back. While batching, the `set...()` methods only return false if a command could not be sent at all.
+void Mgmt::beginBatch()
+{
+	batching = true;
+	batch.clear();
+
+	if (HciAdapter::getInstance().isSingleThreaded())
+	{
+		pBatchState = std::make_shared<BatchState>();
+		pBatchState->outstanding = 0;
+		pBatchState->success = true;
+		pBatchState->ended = false;
+	}
+}
+
+// Ends a batch of commands, waiting for the responses to all commands sent since `beginBatch()`
+//
+// The whole batch shares a single response timeout (`HciAdapter::kMaxEventWaitTimeMS`).
+//
+// Returns true if every command in the batch received a response reporting success, otherwise false
+//
+// In single-threaded mode, this cannot wait; the batch is abandoned and false is returned.
+bool Mgmt::endBatch()
+{
+	batching = false;
+
+	if (nullptr != pBatchState)
+	{
+		Logger::warn("Abandoning a batch of commands (cannot wait on them in single-threaded mode)");
+		pBatchState = nullptr;
+		return false;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HciAdapter::kMaxEventWaitTimeMS);
+	bool success = true;
+	for (const HciAdapter::PendingCommand &command : batch)
+	{
+		if (!HciAdapter::getInstance().waitForCommand(command, deadline))
+		{
+			Logger::warn(SSTR << "  + Failed: " << HciAdapter::kCommandCodeNames[command.code]);
+			success = false;
+		}
+	}
+
+	batch.clear();
+	return success;
+}
+
+// Ends a batch of commands, calling `callback` once all commands sent since `beginBatch()` have received their responses
+//
+// This is the form of `endBatch()` for single-threaded mode. The callback receives true if every command in the batch received
+// a response reporting success, otherwise false.
+void Mgmt::endBatch(HciAdapter::CommandCallback callback)
+{
+	batching = false;
+
+	std::shared_ptr<BatchState> pState = pBatchState;
+	pBatchState = nullptr;
+
+	if (nullptr == pState)
+	{
+		Logger::error("Mgmt::endBatch() with a callback is only available in single-threaded mode");
+		callback(false);
+		return;
+	}
+
+	pState->ended = true;
+	pState->callback = callback;
+
+	// Everything may have completed already
+	if (0 == pState->outstanding)
+	{
+		pState->callback(pState->success);
+	}
+}
+
+// Sends a request to the adapter, either waiting for its response or (while batching) adding it to the batch
+//
+// Returns true on success, otherwise false
+bool Mgmt::sendRequest(HciAdapter::HciHeader &request)
+{
+	if (!batching)
+	{
+		return HciAdapter::getInstance().sendCommand(request);
+	}
+
+	// In single-threaded mode, each command reports back to the batch as its response arrives
+	if (nullptr != pBatchState)
+	{
+		std::shared_ptr<BatchState> pState = pBatchState;
+		uint16_t commandCode = request.code;
+		bool sent = HciAdapter::getInstance().submitCommand(request, [pState, commandCode](bool success)
+		{
+			if (!success)
+			{
+				Logger::warn(SSTR << "  + Failed: " << HciAdapter::kCommandCodeNames[commandCode]);
+				pState->success = false;
+			}
+
+			if (--pState->outstanding == 0 && pState->ended)
+			{
+				pState->callback(pState->success);
+			}
+		});
+
+		if (sent)
+		{
+			pState->outstanding += 1;
+		}
+
+		return sent;
+	}
+
+	HciAdapter::PendingCommand command = HciAdapter::getInstance().submitCommand(request);
+	batch.push_back(command);
+
+	// A command that could not be sent will already have its (failed) response
+	return std::future_status::ready != command.response.wait_for(std::chrono::seconds(0)) || command.response.get();
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Utilitarian
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -27,6 +27,8 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
+#include <memory>
 
 #include "HciAdapter.h"
 #include "Utils.h"
@@ -165,10 +167,16 @@ struct Mgmt
 		ESetAppearanceCommand                                 = 0x0043
 	};
 
+	// Default controller index
+	static const uint16_t kDefaultControllerIndex = 0;
+
 	// Construct the Mgmt device
 	//
 	// Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 	// of the first device (0) will be used.
+	//
+	// In single-threaded mode (see `HciAdapter::setSingleThreaded()`) the controller information is not synchronized here, since
+	// that would block the main loop. Use the callback form of `HciAdapter::sync()` before constructing the Mgmt device instead.
 	Mgmt(uint16_t controllerIndex = kDefaultControllerIndex);
 
 	// Set the adapter name and short name
@@ -230,6 +238,31 @@ struct Mgmt
 	// Returns true on success, otherwise false
 	bool setAdvertising(uint8_t newState);
 
+	//
+	// Batching
+	//
+
+	// Starts a batch of commands
+	//
+	// Until `endBatch()` is called, commands are sent without waiting for their responses, so that the adapter can work through them
+	// back to back. While batching, the `set...()` methods only return false if a command could not be sent at all.
+	void beginBatch();
+
+	// Ends a batch of commands, waiting for the responses to all commands sent since `beginBatch()`
+	//
+	// The whole batch shares a single response timeout (`HciAdapter::kMaxEventWaitTimeMS`).
+	//
+	// Returns true if every command in the batch received a response reporting success, otherwise false
+	//
+	// In single-threaded mode, this cannot wait; the batch is abandoned and false is returned.
+	bool endBatch();
+
+	// Ends a batch of commands, calling `callback` once all commands sent since `beginBatch()` have received their responses
+	//
+	// This is the form of `endBatch()` for single-threaded mode. The callback receives true if every command in the batch received
+	// a response reporting success, otherwise false.
+	void endBatch(HciAdapter::CommandCallback callback);
+
 	//
 	// Utilitarian
 	//
@@ -248,11 +281,31 @@ private:
 	// Data members
 	//
 
+	// Sends a request to the adapter, either waiting for its response or (while batching) adding it to the batch
+	//
+	// Returns true on success, otherwise false
+	bool sendRequest(HciAdapter::HciHeader &request);
+
 	// The default controller index (the first device)
 	uint16_t controllerIndex;
 
-	// Default controller index
-	static const uint16_t kDefaultControllerIndex = 0;
+	// True while batching commands (see `beginBatch()`)
+	bool batching;
+
+	// The commands sent since `beginBatch()`
+	std::vector<HciAdapter::PendingCommand> batch;
+
+	// The progress of a batch sent in single-threaded mode, shared with the callbacks of the batch's commands
+	struct BatchState
+	{
+		int outstanding;
+		bool success;
+		bool ended;
+		HciAdapter::CommandCallback callback;
+	};
+
+	// In single-threaded mode, the state of the current batch
+	std::shared_ptr<BatchState> pBatchState;
 };
 
 }; // namespace ggk
@@ -29,9 +29,10 @@
 //
 // 1. We need to describe ourselves as a citizen on D-Bus: The objects we implement, interfaces we provide, methods we handle, etc.
 //
-//    To accomplish this, we need to build an XML description (called an 'Introspection' for the curious readers) of our DBus
-//    object hierarchy. The code for the XML generation starts in DBusObject.cpp (see `generateIntrospectionXML`) and carries on
-//    throughout the other DBus* files (and even a few Gatt* files).
+//    To accomplish this, we need to build a description (called an 'Introspection' for the curious readers) of our DBus object
+//    hierarchy. Each interface builds its own description (see `generateInterfaceInfo` in DBusInterface.cpp) from its methods
+//    (DBusMethod.cpp) and, for GATT interfaces, its properties (GattInterface.cpp and GattProperty.cpp). The same description can
+//    also be generated as XML (see `generateIntrospectionXML` in DBusObject.cpp), which is handy for debugging.
 //
 // 2. We also need to describe ourselves as a Bluetooth citizen: The services we provide, our characteristics and descriptors.
 //
@@ -63,6 +64,10 @@
 // application also generates or updates data periodically, it can push those updates to the server via call to
 // `ggkNofifyUpdatedCharacteristic()` or `ggkNofifyUpdatedDescriptor()`.
 //
+// Alternatively, your application can pass null delegates and keep its data in the server's built-in data store (see
+// DataStore.cpp.) Names are interned into keys once (see the keys below) and the description reads and writes by key, which
+// avoids any string handling on the way to a client.
+//
 // >>
 // >>>  UNDERSTANDING THE UNDERLYING FRAMEWORKS
 // >>
@@ -129,6 +134,12 @@
 //
 //     https://git.kernel.org/pub/scm/bluetooth/bluez.git/plain/doc/gatt-api.txt
 //
+// The description below doesn't spell these parameters out in place. Each service, characteristic and descriptor is declared once
+// as a constexpr `GattSchema` entry holding its path node, UUID and flags (see the Schema section below), and that entry is passed
+// to its `*Begin` method, as in `.gattCharacteristicBegin(kTextString)`. Flags are written as a bitset, such as
+// `GattSchema::ERead | GattSchema::ENotify`. The compiler parses the UUIDs and checks the flags, so a mistake in either is a build
+// error rather than a surprise at startup. The string forms used in the sample above are still accepted.
+//
 // In addition to these structural methods, there are a small handful of helper methods for performing common operations. These
 // helper methods are available within a method (such as `onReadValue`) through the use of a `self` reference. The `self` reference
 // refers to the object at which the method is invoked (either a `GattCharacteristic` object or a `GattDescriptor` object.)
@@ -159,8 +170,10 @@
 #include "GattProperty.h"
 #include "GattService.h"
 #include "GattUuid.h"
+#include "GattSchema.h"
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
+#include "DataStore.h"
 #include "Logger.h"
 
 namespace ggk {
@@ -182,6 +195,50 @@ namespace ggk {
 // Our one and only server. It's global.
 std::shared_ptr<Server> TheServer = nullptr;
 
+// Keys for our server data, interned once up front so the description can refer to its data without looking names up
+static const DataStore::Key kBatteryLevelKey = DataStore::intern("battery/level");
+static const DataStore::Key kTextStringKey = DataStore::intern("text/string");
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Schema
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// The static layout of our services (path elements, UUIDs and flags), referred to by name in the description below
+//
+// These are constexpr, so they're checked and parsed by the compiler and live in read-only data (see GattSchema.h.) A malformed
+// UUID or a flag that doesn't apply is a build error.
+
+// Device Information
+static constexpr GattSchema::Service kDeviceService("device", "180A");
+static constexpr GattSchema::Characteristic kDeviceMfgrName("mfgr_name", "2A29", GattSchema::ERead);
+static constexpr GattSchema::Characteristic kDeviceModelNum("model_num", "2A24", GattSchema::ERead);
+
+// Battery
+static constexpr GattSchema::Service kBatteryService("battery", "180F");
+static constexpr GattSchema::Characteristic kBatteryLevel("level", "2A19", GattSchema::ERead | GattSchema::ENotify);
+
+// Current Time
+static constexpr GattSchema::Service kTimeService("time", "1805");
+static constexpr GattSchema::Characteristic kTimeCurrent("current", "2A2B", GattSchema::ERead | GattSchema::ENotify);
+static constexpr GattSchema::Characteristic kTimeLocal("local", "2A0F", GattSchema::ERead);
+
+// Custom read/write text string
+static constexpr GattSchema::Service kTextService("text", "00000001-1E3C-FAD4-74E2-97A033F1BFAA");
+static constexpr GattSchema::Characteristic kTextString("string", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", GattSchema::ERead | GattSchema::EWrite | GattSchema::ENotify);
+static constexpr GattSchema::Descriptor kTextStringDescription("description", "2901", GattSchema::ERead);
+
+// Custom ASCII time string
+static constexpr GattSchema::Service kAsciiTimeService("ascii_time", "00000001-1E3D-FAD4-74E2-97A033F1BFEE");
+static constexpr GattSchema::Characteristic kAsciiTimeString("string", "00000002-1E3D-FAD4-74E2-97A033F1BFEE", GattSchema::ERead);
+static constexpr GattSchema::Descriptor kAsciiTimeStringDescription("description", "2901", GattSchema::ERead);
+
+// Custom CPU information
+static constexpr GattSchema::Service kCpuService("cpu", "0000B001-1E3D-FAD4-74E2-97A033F1BFEE");
+static constexpr GattSchema::Characteristic kCpuCount("count", "0000B002-1E3D-FAD4-74E2-97A033F1BFEE", GattSchema::ERead);
+static constexpr GattSchema::Descriptor kCpuCountDescription("description", "2901", GattSchema::ERead);
+static constexpr GattSchema::Characteristic kCpuModel("model", "0000B003-1E3D-FAD4-74E2-97A033F1BFEE", GattSchema::ERead);
+static constexpr GattSchema::Descriptor kCpuModelDescription("description", "2901", GattSchema::ERead);
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Object implementation
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -251,12 +308,12 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	// Service: Device Information (0x180A)
 	//
 	// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.service.device_information.xml
-	.gattServiceBegin("device", "180A")
+	.gattServiceBegin(kDeviceService)
 
 		// Characteristic: Manufacturer Name String (0x2A29)
 		//
 		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.manufacturer_name_string.xml
-		.gattCharacteristicBegin("mfgr_name", "2A29", {"read"})
+		.gattCharacteristicBegin(kDeviceMfgrName)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -269,7 +326,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 		// Characteristic: Model Number String (0x2A24)
 		//
 		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.model_number_string.xml
-		.gattCharacteristicBegin("model_num", "2A24", {"read"})
+		.gattCharacteristicBegin(kDeviceModelNum)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -287,33 +344,37 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	//
 	//     https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.service.battery_service.xml
 	//
-	// We also handle updates to the battery level from inside the server (see onUpdatedValue). There is an external method
-	// (see main.cpp) that updates our battery level and posts an update using ggkPushUpdateQueue. Those updates are used
-	// to notify us that our value has changed, which translates into a call to `onUpdatedValue` from the idleFunc (see
-	// Init.cpp).
-	.gattServiceBegin("battery", "180F")
+	// The battery level is bound to its data (see bindData), so an application that keeps its data in the server's data store
+	// (see standalone.cpp) only needs to update the level in the store. Applications with their own data getter post an update
+	// with `ggkNofifyUpdatedCharacteristic()` instead. Either way, the update ends up in our onUpdatedValue callback.
+	.gattServiceBegin(kBatteryService)
 
 		// Characteristic: Battery Level (0x2A19)
 		//
 		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.battery_level.xml
-		.gattCharacteristicBegin("level", "2A19", {"read", "notify"})
+		.gattCharacteristicBegin(kBatteryLevel)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
 			{
-				uint8_t batteryLevel = self.getDataValue<uint8_t>("battery/level", 0);
+				uint8_t batteryLevel = self.getDataValue<uint8_t>(kBatteryLevelKey, 0);
 				self.methodReturnValue(pInvocation, batteryLevel, true);
 			})
 
 			// Handle updates to the battery level
 			//
+			// Binding the characteristic to its data means that every change to the battery level in the data store is treated
+			// as an update, without the application having to post one.
+			.bindData(kBatteryLevelKey)
+
 			// Here we use the onUpdatedValue to set a callback that isn't exposed to BlueZ, but rather allows us to manage
 			// updates to our value. These updates may have come from our own server or some other source.
 			//
-			// We can handle updates in any way we wish, but the most common use is to send a change notification.
+			// We read the level through getDataValue, which works with the built-in data store as well as with an application's
+			// data getter.
 			.onUpdatedValue(CHARACTERISTIC_UPDATED_VALUE_CALLBACK_LAMBDA
 			{
-				uint8_t batteryLevel = self.getDataValue<uint8_t>("battery/level", 0);
+				uint8_t batteryLevel = self.getDataValue<uint8_t>(kBatteryLevelKey, 0);
 				self.sendChangeNotificationValue(pConnection, batteryLevel);
 				return true;
 			})
@@ -327,17 +388,17 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	//
 	//    https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.service.current_time.xml
 	//
-	// Like the battery service, this also makes use of events. This one updates the time every tick.
+	// Like the battery service, this also makes use of events. This one updates the time every second.
 	//
 	// This showcases the use of events (see the call to .onEvent() below) for periodic actions. In this case, the action
-	// taken is to update time every tick. This probably isn't a good idea for a production service, but it has been quite
+	// taken is to update time every second. This probably isn't a good idea for a production service, but it has been quite
 	// useful for testing to ensure we're connected and updating.
-	.gattServiceBegin("time", "1805")
+	.gattServiceBegin(kTimeService)
 
 		// Characteristic: Current Time (0x2A2B)
 		//
 		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.current_time.xml
-		.gattCharacteristicBegin("current", "2A2B", {"read", "notify"})
+		.gattCharacteristicBegin(kTimeCurrent)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -345,10 +406,10 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 				self.methodReturnVariant(pInvocation, ServerUtils::gvariantCurrentTime(), true);
 			})
 
-			// Update the time every tick of the periodic timer
+			// Update the time every second
 			//
 			// We'll send an change notification to any subscribed clients with the latest value
-			.onEvent(1, nullptr, CHARACTERISTIC_EVENT_CALLBACK_LAMBDA
+			.onEvent(1000, nullptr, CHARACTERISTIC_EVENT_CALLBACK_LAMBDA
 			{
 				self.sendChangeNotificationVariant(pConnection, ServerUtils::gvariantCurrentTime());
 			})
@@ -358,7 +419,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 		// Characteristic: Local Time Information (0x2A0F)
 		//
 		// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.characteristic.local_time_information.xml
-		.gattCharacteristicBegin("local", "2A0F", {"read"})
+		.gattCharacteristicBegin(kTimeLocal)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -373,15 +434,15 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	//
 	// This service will return a text string value (default: 'Hello, world!'). If the text value is updated, it will notify
 	// that the value has been updated and provide the new text from that point forward.
-	.gattServiceBegin("text", "00000001-1E3C-FAD4-74E2-97A033F1BFAA")
+	.gattServiceBegin(kTextService)
 
 		// Characteristic: String value (custom: 00000002-1E3C-FAD4-74E2-97A033F1BFAA)
-		.gattCharacteristicBegin("string", "00000002-1E3C-FAD4-74E2-97A033F1BFAA", {"read", "write", "notify"})
+		.gattCharacteristicBegin(kTextString)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
 			{
-				const char *pTextString = self.getDataPointer<const char *>("text/string", "");
+				const char *pTextString = self.getDataPointer<const char *>(kTextStringKey, "");
 				self.methodReturnValue(pInvocation, pTextString, true);
 			})
 
@@ -390,7 +451,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			{
 				// Update the text string value
 				GVariant *pAyBuffer = g_variant_get_child_value(pParameters, 0);
-				self.setDataPointer("text/string", Utils::stringFromGVariantByteArray(pAyBuffer).c_str());
+				self.setDataPointer(kTextStringKey, Utils::stringFromGVariantByteArray(pAyBuffer).c_str());
 
 				// Since all of these methods (onReadValue, onWriteValue, onUpdateValue) are all part of the same
 				// Characteristic interface (which just so happens to be the same interface passed into our self
@@ -409,7 +470,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			// We can handle updates in any way we wish, but the most common use is to send a change notification.
 			.onUpdatedValue(CHARACTERISTIC_UPDATED_VALUE_CALLBACK_LAMBDA
 			{
-				const char *pTextString = self.getDataPointer<const char *>("text/string", "");
+				const char *pTextString = self.getDataPointer<const char *>(kTextStringKey, "");
 				self.sendChangeNotificationValue(pConnection, pTextString);
 				return true;
 			})
@@ -417,7 +478,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			// GATT Descriptor: Characteristic User Description (0x2901)
 			// 
 			// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.descriptor.gatt.characteristic_user_description.xml
-			.gattDescriptorBegin("description", "2901", {"read"})
+			.gattDescriptorBegin(kTextStringDescription)
 
 				// Standard descriptor "ReadValue" method call
 				.onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
@@ -437,10 +498,10 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	// a new value each time it is read.
 
 	// Service: ASCII Time (custom: 00000001-1E3D-FAD4-74E2-97A033F1BFEE)
-	.gattServiceBegin("ascii_time", "00000001-1E3D-FAD4-74E2-97A033F1BFEE")
+	.gattServiceBegin(kAsciiTimeService)
 
 		// Characteristic: ASCII Time String (custom: 00000002-1E3D-FAD4-74E2-97A033F1BFEE)
-		.gattCharacteristicBegin("string", "00000002-1E3D-FAD4-74E2-97A033F1BFEE", {"read"})
+		.gattCharacteristicBegin(kAsciiTimeString)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -456,7 +517,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			// GATT Descriptor: Characteristic User Description (0x2901)
 			// 
 			// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.descriptor.gatt.characteristic_user_description.xml
-			.gattDescriptorBegin("description", "2901", {"read"})
+			.gattDescriptorBegin(kAsciiTimeStringDescription)
 
 				// Standard descriptor "ReadValue" method call
 				.onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
@@ -476,10 +537,10 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	// CPU. It may not work on all platforms, but it does provide yet another example of how to do things.
 
 	// Service: CPU Information (custom: 0000B001-1E3D-FAD4-74E2-97A033F1BFEE)
-	.gattServiceBegin("cpu", "0000B001-1E3D-FAD4-74E2-97A033F1BFEE")
+	.gattServiceBegin(kCpuService)
 
 		// Characteristic: CPU Count (custom: 0000B002-1E3D-FAD4-74E2-97A033F1BFEE)
-		.gattCharacteristicBegin("count", "0000B002-1E3D-FAD4-74E2-97A033F1BFEE", {"read"})
+		.gattCharacteristicBegin(kCpuCount)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -492,7 +553,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			// GATT Descriptor: Characteristic User Description (0x2901)
 			// 
 			// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.descriptor.gatt.characteristic_user_description.xml
-			.gattDescriptorBegin("description", "2901", {"read"})
+			.gattDescriptorBegin(kCpuCountDescription)
 
 				// Standard descriptor "ReadValue" method call
 				.onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
@@ -506,7 +567,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 		.gattCharacteristicEnd()
 
 		// Characteristic: CPU Model (custom: 0000B003-1E3D-FAD4-74E2-97A033F1BFEE)
-		.gattCharacteristicBegin("model", "0000B003-1E3D-FAD4-74E2-97A033F1BFEE", {"read"})
+		.gattCharacteristicBegin(kCpuModel)
 
 			// Standard characteristic "ReadValue" method call
 			.onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -518,7 +579,7 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 			// GATT Descriptor: Characteristic User Description (0x2901)
 			// 
 			// See: https://www.bluetooth.com/specifications/gatt/viewer?attributeXmlFile=org.bluetooth.descriptor.gatt.characteristic_user_description.xml
-			.gattDescriptorBegin("description", "2901", {"read"})
+			.gattDescriptorBegin(kCpuModelDescription)
 
 				// Standard descriptor "ReadValue" method call
 				.onReadValue(DESCRIPTOR_METHOD_CALLBACK_LAMBDA
@@ -587,27 +648,32 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	{
 		ServerUtils::getManagedObjects(pInvocation);
 	});
+
+	// Our hierarchy is complete, so index it for quick lookup when servicing D-Bus requests
+	buildIndex();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Utilitarian
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Rebuilds the index used by `findInterface()`, `callMethod()` and `findProperty()`, and discards the cached reply to
+// `GetManagedObjects`
+//
+// The constructor builds the index once the server description is complete. This only needs to be called again if the object
+// hierarchy is modified after that.
+void Server::buildIndex()
+{
+	index.build(objects);
+	ServerUtils::invalidateManagedObjects();
+}
+
 // Find a D-Bus interface within the given D-Bus object
 //
 // If the interface was found, it is returned, otherwise nullptr is returned
 std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const
 {
-	for (const DBusObject &object : objects)
-	{
-		std::shared_ptr<const DBusInterface> pInterface = object.findInterface(objectPath, interfaceName);
-		if (pInterface != nullptr)
-		{
-			return pInterface;
-		}
-	}
-
-	return nullptr;
+	return index.findInterface(objectPath.c_str(), interfaceName.c_str());
 }
 
 // Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
@@ -615,15 +681,13 @@ std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath
 // If the method was called, this method returns true, otherwise false. There is no result from the method call itself.
 bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusObject &object : objects)
+	std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, interfaceName);
+	if (nullptr == pInterface)
 	{
-		if (object.callMethod(objectPath, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData))
-		{
-			return true;
-		}
+		return false;
 	}
 
-	return false;
+	return pInterface->callMethod(methodName, pConnection, pParameters, pInvocation, pUserData);
 }
 
 // Find a GATT Property within the given D-Bus object on the given D-Bus interface
@@ -631,14 +695,21 @@ bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &int
 // If the property was found, it is returned, otherwise nullptr is returned
 const GattProperty *Server::findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const
 {
-	std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, interfaceName);
+	return index.findProperty(objectPath.c_str(), interfaceName.c_str(), propertyName.c_str());
+}
 
-	// Try each of the GattInterface types that support properties?
-	if (std::shared_ptr<const GattInterface> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattInterface))
+// Find a GATT Property on the given D-Bus interface
+//
+// If the interface supports GATT properties and the property was found, it is returned, otherwise nullptr is returned
+const GattProperty *Server::findProperty(const std::shared_ptr<const DBusInterface> &pInterface, const std::string &propertyName)
+{
+	if (nullptr == pInterface)
 	{
-		return pGattInterface->findProperty(propertyName);
+		return nullptr;
 	}
-	else if (std::shared_ptr<const GattService> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
+
+	// Try each of the GattInterface types that support properties
+	if (std::shared_ptr<const GattService> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
 	{
 		return pGattInterface->findProperty(propertyName);
 	}
@@ -646,6 +717,10 @@ const GattProperty *Server::findProperty(const DBusObjectPath &objectPath, const
 	{
 		return pGattInterface->findProperty(propertyName);
 	}
+	else if (std::shared_ptr<const GattDescriptor> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattDescriptor))
+	{
+		return pGattInterface->findProperty(propertyName);
+	}
 
 	return nullptr;
 }
@@ -33,6 +33,7 @@
 
 #include "../include/Gobbledegook.h"
 #include "DBusObject.h"
+#include "DBusIndex.h"
 
 namespace ggk {
 
@@ -180,11 +181,26 @@ struct Server
 	// If the property was found, it is returned, otherwise nullptr is returned
 	const GattProperty *findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const;
 
+	// Find a GATT Property on the given D-Bus interface
+	//
+	// If the interface supports GATT properties and the property was found, it is returned, otherwise nullptr is returned
+	static const GattProperty *findProperty(const std::shared_ptr<const DBusInterface> &pInterface, const std::string &propertyName);
+
+	// Rebuilds the index used by `findInterface()`, `callMethod()` and `findProperty()`, and discards the cached reply to
+	// `GetManagedObjects`
+	//
+	// The constructor builds the index once the server description is complete. This only needs to be called again if the object
+	// hierarchy is modified after that.
+	void buildIndex();
+
 private:
 
 	// Our server's objects
 	Objects objects;
 
+	// Index of our objects' interfaces and properties, for fast lookup when servicing D-Bus requests
+	DBusIndex index;
+
 	// BR/EDR requested state
 	bool enableBREDR;
 
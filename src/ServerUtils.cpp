@@ -25,8 +25,10 @@
 
 #include <glib.h>
 #include <string>
+#include <list>
 #include <fstream>
 #include <regex>
+#include <mutex>
 
 #include "ServerUtils.h"
 #include "DBusObject.h"
@@ -41,6 +43,42 @@
 
 namespace ggk {
 
+// The cached reply to `GetManagedObjects` (see `ServerUtils::getManagedObjectsReply()`), or nullptr if it needs to be rebuilt
+static GVariant *pManagedObjectsReply = nullptr;
+
+// Guards `pManagedObjectsReply`
+static std::mutex managedObjectsMutex;
+
+// Adds the properties of a GATT interface to the tree of managed objects
+//
+// Interfaces without properties are not added.
+static void addManagedObjectsInterface(const GattInterface &interface, GVariantBuilder *pInterfaceArray)
+{
+	if (interface.getProperties().empty())
+	{
+		return;
+	}
+
+	Logger::debug(SSTR << "    " << interface.getInterfaceType() << " interface: " << interface.getName());
+
+	g_variant_builder_open(pInterfaceArray, G_VARIANT_TYPE("{sa{sv}}"));
+	g_variant_builder_add(pInterfaceArray, "s", interface.getName().c_str());
+	g_variant_builder_open(pInterfaceArray, G_VARIANT_TYPE("a{sv}"));
+	for (const GattProperty &property : interface.getProperties())
+	{
+		Logger::debug(SSTR << "      Property " << property.getName());
+		g_variant_builder_add
+		(
+			pInterfaceArray,
+			"{sv}",
+			property.getName().c_str(),
+			property.getValue()
+		);
+	}
+	g_variant_builder_close(pInterfaceArray);
+	g_variant_builder_close(pInterfaceArray);
+}
+
 // Adds an object to the tree of managed objects as returned from the `GetManagedObjects` method call from the D-Bus interface
 // `org.freedesktop.DBus.ObjectManager`.
 //
@@ -68,98 +106,28 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 		DBusObjectPath path = basePath + object.getPathNode();
 		Logger::debug(SSTR << "  Object: " << path);
 
-		GVariantBuilder *pInterfaceArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+		GVariantBuilder interfaceArray;
+		g_variant_builder_init(&interfaceArray, G_VARIANT_TYPE("a{sa{sv}}"));
 		for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
 		{
 			Logger::debug(SSTR << "  + Interface (type: " << pInterface->getInterfaceType() << ")");
 
 			if (std::shared_ptr<const GattService> pService = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
 			{
-				if (!pService->getProperties().empty())
-				{
-					Logger::debug(SSTR << "    GATT Service interface: " << pService->getName());
-
-					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-					for (const GattProperty &property : pService->getProperties())
-					{
-						Logger::debug(SSTR << "      Property " << property.getName());
-						g_variant_builder_add
-						(
-							pPropertyArray,
-							"{sv}",
-							property.getName().c_str(),
-							property.getValue()
-						);
-					}
-
-					g_variant_builder_add
-					(
-						pInterfaceArray,
-						"{sa{sv}}",
-						pService->getName().c_str(),
-						pPropertyArray
-					);
-				}
+				addManagedObjectsInterface(*pService, &interfaceArray);
 			}
 			else if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
 			{
-				if (!pCharacteristic->getProperties().empty())
-				{
-					Logger::debug(SSTR << "    GATT Characteristic interface: " << pCharacteristic->getName());
-
-					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-					for (const GattProperty &property : pCharacteristic->getProperties())
-					{
-						Logger::debug(SSTR << "      Property " << property.getName());
-						g_variant_builder_add
-						(
-							pPropertyArray,
-							"{sv}",
-							property.getName().c_str(),
-							property.getValue()
-						);
-					}
-
-					g_variant_builder_add
-					(
-						pInterfaceArray,
-						"{sa{sv}}",
-						pCharacteristic->getName().c_str(),
-						pPropertyArray
-					);
-				}
+				addManagedObjectsInterface(*pCharacteristic, &interfaceArray);
 			}
 			else if (std::shared_ptr<const GattDescriptor> pDescriptor = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattDescriptor))
 			{
-				if (!pDescriptor->getProperties().empty())
-				{
-					Logger::debug(SSTR << "    GATT Descriptor interface: " << pDescriptor->getName());
-
-					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-					for (const GattProperty &property : pDescriptor->getProperties())
-					{
-						Logger::debug(SSTR << "      Property " << property.getName());
-						g_variant_builder_add
-						(
-							pPropertyArray,
-							"{sv}",
-							property.getName().c_str(),
-							property.getValue()
-						);
-					}
-
-					g_variant_builder_add
-					(
-						pInterfaceArray,
-						"{sa{sv}}",
-						pDescriptor->getName().c_str(),
-						pPropertyArray
-					);
-				}
+				addManagedObjectsInterface(*pDescriptor, &interfaceArray);
 			}
 			else
 			{
 				Logger::error(SSTR << "    Unknown interface type");
+				g_variant_builder_clear(&interfaceArray);
 				return;
 			}
 		}
@@ -167,9 +135,9 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 		g_variant_builder_add
 		(
 			pObjectArray,
-			"{oa{sa{sv}}}",
+			"{o@a{sa{sv}}}",
 			path.c_str(),
-			pInterfaceArray
+			g_variant_builder_end(&interfaceArray)
 		);
 	}
 
@@ -179,19 +147,65 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 	}
 }
 
+// Builds the reply to `GetManagedObjects` for the given object hierarchy
+//
+// This always builds a new reply (the server's own reply is cached, see `getManagedObjectsReply()`.) The caller owns the returned
+// reference and must release it with `g_variant_unref()`.
+GVariant *ServerUtils::buildManagedObjects(const std::list<DBusObject> &objects)
+{
+	Logger::debug(SSTR << "Building managed objects");
+
+	GVariantBuilder objectArray;
+	g_variant_builder_init(&objectArray, G_VARIANT_TYPE("a{oa{sa{sv}}}"));
+	for (const DBusObject &object : objects)
+	{
+		addManagedObjectsNode(object, DBusObjectPath(""), &objectArray);
+	}
+
+	// Take our own (non-floating) reference to the sealed reply so that it can be handed out repeatedly
+	return g_variant_ref_sink(g_variant_new("(@a{oa{sa{sv}}})", g_variant_builder_end(&objectArray)));
+}
+
+// Returns the reply to `GetManagedObjects` for the server's object hierarchy, building it if it isn't cached
+//
+// The caller owns the returned reference and must release it with `g_variant_unref()`.
+GVariant *ServerUtils::getManagedObjectsReply()
+{
+	std::lock_guard<std::mutex> lock(managedObjectsMutex);
+
+	if (nullptr == pManagedObjectsReply)
+	{
+		pManagedObjectsReply = buildManagedObjects(TheServer->getObjects());
+	}
+
+	return g_variant_ref(pManagedObjectsReply);
+}
+
 // Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+//
+// The reply is built once and cached, see `invalidateManagedObjects()`
 void ServerUtils::getManagedObjects(GDBusMethodInvocation *pInvocation)
 {
 	Logger::debug(SSTR << "Reporting managed objects");
 
-	GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-	for (const DBusObject &object : TheServer->getObjects())
+	GVariant *pParams = getManagedObjectsReply();
+	g_dbus_method_invocation_return_value(pInvocation, pParams);
+	g_variant_unref(pParams);
+}
+
+// Discards the cached reply to `GetManagedObjects` so that it is rebuilt on the next call
+//
+// This must be called whenever the object hierarchy or a property's static value changes. `GattProperty::setValue()` and
+// `Server::buildIndex()` take care of this.
+void ServerUtils::invalidateManagedObjects()
+{
+	std::lock_guard<std::mutex> lock(managedObjectsMutex);
+
+	if (nullptr != pManagedObjectsReply)
 	{
-		addManagedObjectsNode(object, DBusObjectPath(""), pObjectArray);
+		g_variant_unref(pManagedObjectsReply);
+		pManagedObjectsReply = nullptr;
 	}
-
-	GVariant *pParams = g_variant_new("(a{oa{sa{sv}}})", pObjectArray);
-	g_dbus_method_invocation_return_value(pInvocation, pParams);
 }
 
 // WARNING: Hacky code - don't count on this working properly on all systems
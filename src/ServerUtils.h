@@ -26,14 +26,36 @@
 
 #include <gio/gio.h>
 #include <string>
+#include <list>
 
 namespace ggk {
 
+struct DBusObject;
+
 struct ServerUtils
 {
+	// Builds the reply to `GetManagedObjects` for the given object hierarchy
+	//
+	// This always builds a new reply (the server's own reply is cached, see `getManagedObjectsReply()`.) The caller owns the returned
+	// reference and must release it with `g_variant_unref()`.
+	static GVariant *buildManagedObjects(const std::list<DBusObject> &objects);
+
+	// Returns the reply to `GetManagedObjects` for the server's object hierarchy, building it if it isn't cached
+	//
+	// The caller owns the returned reference and must release it with `g_variant_unref()`.
+	static GVariant *getManagedObjectsReply();
+
 	// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+	//
+	// The reply is built once and cached, see `invalidateManagedObjects()`
 	static void getManagedObjects(GDBusMethodInvocation *pInvocation);
 
+	// Discards the cached reply to `GetManagedObjects` so that it is rebuilt on the next call
+	//
+	// This must be called whenever the object hierarchy or a property's static value changes. `GattProperty::setValue()` and
+	// `Server::buildIndex()` take care of this.
+	static void invalidateManagedObjects();
+
 	// WARNING: Hacky code - don't count on this working properly on all systems
 	//
 	// This routine will attempt to parse /proc/cpuinfo to return the CPU count/model. Results are cached on the first call, with
@@ -0,0 +1,410 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The server's side of the shared-memory data plane, through which producers in other processes publish values
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// When enabled (see `ggkSetSharedDataPlane()`), the server creates a memory segment when it starts, laid out as described in
+// include/GobbledegookShm.h, with one slot for each data store key that is bound to a characteristic (see
+// `GattCharacteristic::bindData()`.) Each slot is seeded with the key's current value, and the key is then attached to it (see
+// `DataStore::attachShared()`) so that every read and write by key goes to shared memory from then on. The characteristic's
+// ReadValue handler and its notifications read the value straight out of the slot; nothing is copied on its way in.
+//
+// The segment is a sealed memfd, so it has no name in the filesystem and can't be resized under us. An eventfd can't be opened
+// by name either, so producers get both from us over an abstract unix socket named after the service ("gobbledegook-data." plus
+// the service name.) We accept a connection, check that the peer runs as our user (or root), pass the two descriptors and hang
+// up. That is the only work we do per producer.
+//
+// The eventfd is the update queue's own. A producer that publishes a value marks its slot as changed and, unless the segment
+// says we've already been woken, writes the eventfd. Each time the update queue source is dispatched it calls `collect()`, which
+// clears the wake flag, takes the changed bits and touches each changed key in the data store. Touching a bound key pushes its
+// characteristic onto the update queue like any other write, so a burst of publishes to the same slot is merged into a single
+// notification carrying the latest value.
+//
+// A producer attaches to a segment once, so it has to be told when we stop: the header's `alive` flag is set once everything is
+// in place and cleared in `stop()`, and `ggkShmPublish()` fails once it is cleared. When the server is restarted, producers
+// attach again and get the new segment.
+//
+// We read and write slots on the main loop, so we give up on a locked slot after GGK_SHM_SERVER_MAX_RETRIES tries rather than
+// the producer's budget. Otherwise a producer killed in the middle of a write would stall the main loop on every access to
+// that slot.
+//
+// Everything here runs on the server thread.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <glib.h>
+#include <glib-unix.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ShmDataPlane.h"
+#include "DBusObject.h"
+#include "DBusInterface.h"
+#include "GattCharacteristic.h"
+#include "DataStore.h"
+#include "Logger.h"
+#include "../include/GobbledegookShm.h"
+
+namespace ggk {
+
+static std::atomic<bool> enabled(false);
+
+// The segment, and the data store key held in each of its slots
+static GGKShmHeader *pHeader = nullptr;
+static size_t segmentSize = 0;
+static int memFd = -1;
+static std::vector<DataStore::Key> slotKeys;
+
+// The descriptor producers use to wake us
+static int producerWakeFd = -1;
+
+// Where producers connect
+static int listenFd = -1;
+static guint listenSourceId = 0;
+
+// Collects the keys of every characteristic in an object and its children that is bound to its data
+static void collectBoundKeys(const DBusObject &object, std::vector<DataStore::Key> &keys)
+{
+	for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
+	{
+		std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+		if (nullptr == pCharacteristic || DataStore::kInvalidKey == pCharacteristic->getDataKey())
+		{
+			continue;
+		}
+
+		// Characteristics may share their data, but they'll share a slot as well
+		if (std::find(keys.begin(), keys.end(), pCharacteristic->getDataKey()) == keys.end())
+		{
+			keys.push_back(pCharacteristic->getDataKey());
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		collectBoundKeys(child, keys);
+	}
+}
+
+// Sends the segment and the wake descriptor to a producer that has just connected
+static void sendDescriptors(int fd)
+{
+	// Only processes running as our user (or root) get to publish our data
+	struct ucred credentials;
+	socklen_t length = sizeof(credentials);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0)
+	{
+		Logger::warn(SSTR << "Unable to identify data plane producer: " << strerror(errno));
+		return;
+	}
+
+	if (credentials.uid != getuid() && credentials.uid != 0)
+	{
+		Logger::warn(SSTR << "Refusing data plane producer (pid " << credentials.pid << ", uid " << credentials.uid << ")");
+		return;
+	}
+
+	char byte = 0;
+	struct iovec iov;
+	iov.iov_base = &byte;
+	iov.iov_len = 1;
+
+	union
+	{
+		struct cmsghdr align;
+		char buffer[CMSG_SPACE(2 * sizeof(int))];
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	struct cmsghdr *pControl = CMSG_FIRSTHDR(&message);
+	pControl->cmsg_level = SOL_SOCKET;
+	pControl->cmsg_type = SCM_RIGHTS;
+	pControl->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	int fds[2] = { memFd, producerWakeFd };
+	memcpy(CMSG_DATA(pControl), fds, sizeof(fds));
+
+	if (sendmsg(fd, &message, MSG_NOSIGNAL) != 1)
+	{
+		Logger::warn(SSTR << "Unable to send the data plane to producer (pid " << credentials.pid << "): " << strerror(errno));
+		return;
+	}
+
+	Logger::debug(SSTR << "Attached data plane producer (pid " << credentials.pid << ")");
+}
+
+// Called from the main loop when a producer is connecting
+static gboolean onProducerConnect(gint fd, GIOCondition /*condition*/, gpointer /*pUserData*/)
+{
+	int connection = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+	if (connection < 0)
+	{
+		if (errno != EAGAIN && errno != EINTR)
+		{
+			Logger::warn(SSTR << "Unable to accept data plane producer: " << strerror(errno));
+		}
+
+		return G_SOURCE_CONTINUE;
+	}
+
+	sendDescriptors(connection);
+	close(connection);
+	return G_SOURCE_CONTINUE;
+}
+
+// Creates the segment with a slot for each key, seeded with the key's current value
+//
+// Returns true on success, otherwise false
+static bool createSegment(const std::vector<DataStore::Key> &keys)
+{
+	memFd = memfd_create("gobbledegook-data", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (memFd < 0)
+	{
+		Logger::error(SSTR << "Unable to create the data plane segment: " << strerror(errno));
+		return false;
+	}
+
+	// Producers map the segment too, so it must never shrink or grow
+	segmentSize = ggkShmSegmentSize(static_cast<uint32_t>(keys.size()));
+	if (ftruncate(memFd, static_cast<off_t>(segmentSize)) < 0 ||
+		fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+	{
+		Logger::error(SSTR << "Unable to size the data plane segment: " << strerror(errno));
+		return false;
+	}
+
+	void *pMapped = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+	if (MAP_FAILED == pMapped)
+	{
+		Logger::error(SSTR << "Unable to map the data plane segment: " << strerror(errno));
+		return false;
+	}
+
+	// A fresh memfd is zero-filled, so only the non-zero fields need filling in
+	pHeader = static_cast<GGKShmHeader *>(pMapped);
+	pHeader->magic = GGK_SHM_MAGIC;
+	pHeader->version = GGK_SHM_VERSION;
+	pHeader->slotCount = static_cast<uint32_t>(keys.size());
+	pHeader->slotSize = sizeof(GGKShmSlot);
+
+	GGKShmSlot *pSlots = ggkShmSlots(pHeader);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		strncpy(pSlots[i].name, DataStore::getName(keys[i]), GGK_SHM_MAX_NAME - 1);
+
+		std::string value;
+		if (DataStore::getRaw(keys[i], value))
+		{
+			ggkShmWrite(&pSlots[i], value.data(), static_cast<uint32_t>(value.size()), GGK_SHM_SERVER_MAX_RETRIES);
+		}
+	}
+
+	return true;
+}
+
+// Starts listening for producers on the abstract socket named after the service
+//
+// Returns true on success, otherwise false
+static bool startListening(const std::string &serviceName)
+{
+	std::string name = std::string(GGK_SHM_SOCKET_PREFIX) + serviceName;
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (name.size() + 1 > sizeof(address.sun_path))
+	{
+		Logger::error(SSTR << "Unable to listen for data plane producers: the service name is too long");
+		return false;
+	}
+
+	// A leading null puts the socket in the abstract namespace, so there's no file to clean up
+	memcpy(address.sun_path + 1, name.data(), name.size());
+	socklen_t addressLength = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + 1 + name.size());
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listenFd < 0 ||
+		bind(listenFd, reinterpret_cast<struct sockaddr *>(&address), addressLength) < 0 ||
+		listen(listenFd, 8) < 0)
+	{
+		Logger::error(SSTR << "Unable to listen for data plane producers on '@" << name << "': " << strerror(errno));
+		return false;
+	}
+
+	listenSourceId = g_unix_fd_add_full(G_PRIORITY_DEFAULT, listenFd, G_IO_IN, onProducerConnect, nullptr, nullptr);
+	return true;
+}
+
+// Enables or disables the shared-memory data plane for the next time the server starts (it is disabled by default)
+void ShmDataPlane::setEnabled(bool enable)
+{
+	enabled = enable;
+}
+
+// Returns true if the shared-memory data plane is enabled
+bool ShmDataPlane::isEnabled()
+{
+	return enabled;
+}
+
+// Creates the shared memory segment, with a slot for each characteristic in the hierarchy that is bound to its data (see
+// `GattCharacteristic::bindData()`), and starts listening for producers
+//
+// Producers are given `wakeFd` (the update queue's eventfd) to wake the server. Does nothing if the shared-memory data plane
+// is not enabled.
+//
+// Returns true on success (or if not enabled), otherwise false
+bool ShmDataPlane::start(const std::list<DBusObject> &objects, const std::string &serviceName, int wakeFd)
+{
+	stop();
+
+	if (!enabled)
+	{
+		return true;
+	}
+
+	std::vector<DataStore::Key> keys;
+	for (const DBusObject &object : objects)
+	{
+		if (object.isPublished())
+		{
+			collectBoundKeys(object, keys);
+		}
+	}
+
+	if (keys.size() > GGK_SHM_MAX_SLOTS)
+	{
+		Logger::warn(SSTR << "Only the first " << GGK_SHM_MAX_SLOTS << " of " << keys.size() << " bound keys will be in the data plane");
+		keys.resize(GGK_SHM_MAX_SLOTS);
+	}
+
+	producerWakeFd = wakeFd;
+	if (!createSegment(keys) || !startListening(serviceName))
+	{
+		stop();
+		return false;
+	}
+
+	// From here on, the keys' values live in the segment
+	GGKShmSlot *pSlots = ggkShmSlots(pHeader);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		DataStore::attachShared(keys[i], &pSlots[i]);
+	}
+
+	slotKeys = keys;
+
+	// Producers may publish from here on
+	__atomic_store_n(&pHeader->alive, 1, __ATOMIC_RELEASE);
+	Logger::debug(SSTR << "Started data plane with " << slotKeys.size() << " slot(s) on '@" << GGK_SHM_SOCKET_PREFIX << serviceName << "'");
+	return true;
+}
+
+// Stops listening for producers, moves every key back into the data store and destroys the segment
+void ShmDataPlane::stop()
+{
+	if (0 != listenSourceId)
+	{
+		g_source_remove(listenSourceId);
+		listenSourceId = 0;
+	}
+
+	if (listenFd >= 0)
+	{
+		close(listenFd);
+		listenFd = -1;
+	}
+
+	// Producers still hold the segment after we unmap it, so let them know we're done with it
+	if (nullptr != pHeader)
+	{
+		__atomic_store_n(&pHeader->alive, 0, __ATOMIC_RELEASE);
+	}
+
+	// Nobody may be reading a slot by the time we unmap it
+	for (DataStore::Key key : slotKeys)
+	{
+		DataStore::attachShared(key, nullptr);
+	}
+
+	slotKeys.clear();
+
+	if (nullptr != pHeader)
+	{
+		munmap(pHeader, segmentSize);
+		pHeader = nullptr;
+		segmentSize = 0;
+	}
+
+	if (memFd >= 0)
+	{
+		close(memFd);
+		memFd = -1;
+	}
+
+	producerWakeFd = -1;
+}
+
+// Lets the server know about every slot that producers have changed since the last call
+//
+// This is called from the main loop each time the update queue is woken.
+void ShmDataPlane::collect()
+{
+	if (nullptr == pHeader)
+	{
+		return;
+	}
+
+	// Clear the wake flag before taking the changed bits, so that anything published from here on wakes us again
+	__atomic_store_n(&pHeader->wakePending, 0, __ATOMIC_SEQ_CST);
+
+	for (size_t word = 0; word * 64 < slotKeys.size(); ++word)
+	{
+		uint64_t changed = __atomic_exchange_n(&pHeader->changed[word], 0, __ATOMIC_SEQ_CST);
+		while (0 != changed)
+		{
+			size_t slot = word * 64 + __builtin_ctzll(changed);
+			changed &= changed - 1;
+
+			if (slot < slotKeys.size())
+			{
+				DataStore::touch(slotKeys[slot]);
+			}
+		}
+	}
+}
+
+// Returns the number of slots in the segment (0 if not running)
+size_t ShmDataPlane::size()
+{
+	return slotKeys.size();
+}
+
+}; // namespace ggk
@@ -0,0 +1,62 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The server's side of the shared-memory data plane, through which producers in other processes publish values
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of ShmDataPlane.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stddef.h>
+#include <list>
+#include <string>
+
+namespace ggk {
+
+struct DBusObject;
+
+struct ShmDataPlane
+{
+	// Enables or disables the shared-memory data plane for the next time the server starts (it is disabled by default)
+	static void setEnabled(bool enable);
+
+	// Returns true if the shared-memory data plane is enabled
+	static bool isEnabled();
+
+	// Creates the shared memory segment, with a slot for each characteristic in the hierarchy that is bound to its data (see
+	// `GattCharacteristic::bindData()`), and starts listening for producers
+	//
+	// Producers are given `wakeFd` (the update queue's eventfd) to wake the server. Does nothing if the shared-memory data plane
+	// is not enabled.
+	//
+	// Returns true on success (or if not enabled), otherwise false
+	static bool start(const std::list<DBusObject> &objects, const std::string &serviceName, int wakeFd);
+
+	// Stops listening for producers, moves every key back into the data store and destroys the segment
+	static void stop();
+
+	// Lets the server know about every slot that producers have changed since the last call
+	//
+	// This is called from the main loop each time the update queue is woken.
+	static void collect();
+
+	// Returns the number of slots in the segment (0 if not running)
+	static size_t size();
+};
+
+}; // namespace ggk
@@ -0,0 +1,327 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Timerfd-driven main loop sources for high-rate characteristic events
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Regular events (see `onEvent()`) share a timer wheel, which is driven by a GLib timeout. That's fine for the occasional
+// update, but GLib timeouts are re-armed relative to when they were dispatched, so any delay in the main loop pushes every later
+// firing back with it. A characteristic streaming telemetry at 50-200 Hz needs its notifications to stay on a steady grid.
+//
+// Each stream event (see `GattCharacteristic::onStreamEvent()`) gets its own timerfd, armed with an absolute start time and a
+// fixed interval, so its deadlines are fixed by the kernel and never drift. The timerfd is watched by a high-priority main loop
+// source, which fires the event once each time the timer expires.
+//
+// Reading the timerfd tells us how many deadlines have passed since we last looked. More than one means the main loop was too
+// busy to keep up, and the extra deadlines are counted as missed (we don't try to catch up by firing in a burst.) We also
+// record how late each firing was relative to its deadline, and the jitter: the change in lateness from one firing to the next.
+// These are available to the application through `ggkGetStreamStats()`.
+//
+// Firings are skipped (and counted as such) while nobody is subscribed to the characteristic, so an idle stream doesn't pay for
+// building values that would be thrown away.
+//
+// The sources are created and fire on the main loop, but the counters may be read from any thread, so they are guarded by a
+// mutex. The callback is never called while holding it.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <glib.h>
+#include <glib-unix.h>
+#include <mutex>
+#include <string>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "StreamTimers.h"
+#include "DBusObject.h"
+#include "DBusInterface.h"
+#include "GattCharacteristic.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// A single running stream event
+struct Stream
+{
+	std::string objectPath;
+	const GattCharacteristic *pCharacteristic;
+	const TickEvent *pEvent;
+	int64_t periodNS;
+	int64_t startNS;
+	uint64_t deadlineCount;
+	int64_t lastLatencyNS;
+	int fd;
+	guint sourceId;
+	GGKStreamStats stats;
+};
+
+static std::list<Stream> streams;
+static std::mutex streamsMutex;
+static StreamTimers::FireCallback fireCallback;
+
+// Returns the current time on the clock used by our timers, in nanoseconds
+static int64_t nowNS()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+// Converts a time in nanoseconds to a timespec
+static struct timespec toTimespec(int64_t timeNS)
+{
+	struct timespec result;
+	result.tv_sec = static_cast<time_t>(timeNS / 1000000000LL);
+	result.tv_nsec = static_cast<long>(timeNS % 1000000000LL);
+	return result;
+}
+
+// Called from the main loop when a stream's timer has expired
+static gboolean onStreamTimer(gint fd, GIOCondition /*condition*/, gpointer pUserData)
+{
+	Stream &stream = *static_cast<Stream *>(pUserData);
+
+	uint64_t expirations = 0;
+	ssize_t bytesRead = read(fd, &expirations, sizeof(expirations));
+	if (bytesRead < 0)
+	{
+		// Nothing to read (or interrupted), we'll be called again when the timer expires
+		if (errno != EAGAIN && errno != EINTR)
+		{
+			Logger::warn(SSTR << "Failed to read stream timer for '" << stream.objectPath << "': " << strerror(errno));
+		}
+
+		return G_SOURCE_CONTINUE;
+	}
+
+	if (bytesRead != sizeof(expirations))
+	{
+		Logger::warn(SSTR << "Short read (" << bytesRead << " bytes) from stream timer for '" << stream.objectPath << "'");
+		return G_SOURCE_CONTINUE;
+	}
+
+	// No deadlines have passed, so there's nothing to fire
+	if (0 == expirations)
+	{
+		return G_SOURCE_CONTINUE;
+	}
+
+	// How late are we, relative to the latest deadline?
+	stream.deadlineCount += expirations;
+	int64_t latencyNS = nowNS() - (stream.startNS + static_cast<int64_t>(stream.deadlineCount) * stream.periodNS);
+	if (latencyNS < 0) { latencyNS = 0; }
+
+	int64_t jitterNS = stream.deadlineCount == expirations ? 0 : latencyNS - stream.lastLatencyNS;
+	if (jitterNS < 0) { jitterNS = -jitterNS; }
+	stream.lastLatencyNS = latencyNS;
+
+	bool deliver = stream.pCharacteristic->wantsUpdates();
+
+	{
+		std::lock_guard<std::mutex> lock(streamsMutex);
+
+		GGKStreamStats &stats = stream.stats;
+		stats.missedCount += expirations - 1;
+		stats.lastLatencyMicroseconds = latencyNS / 1000;
+		stats.totalLatencyMicroseconds += latencyNS / 1000;
+		if (stats.lastLatencyMicroseconds > stats.maxLatencyMicroseconds) { stats.maxLatencyMicroseconds = stats.lastLatencyMicroseconds; }
+		stats.lastJitterMicroseconds = jitterNS / 1000;
+		stats.totalJitterMicroseconds += jitterNS / 1000;
+		if (stats.lastJitterMicroseconds > stats.maxJitterMicroseconds) { stats.maxJitterMicroseconds = stats.lastJitterMicroseconds; }
+
+		if (deliver)
+		{
+			stats.fireCount += 1;
+		}
+		else
+		{
+			stats.skippedCount += 1;
+		}
+	}
+
+	if (deliver && fireCallback)
+	{
+		fireCallback(*stream.pCharacteristic, *stream.pEvent);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Creates the timer and main loop source for a single stream event
+//
+// Returns true on success, otherwise false
+static bool startStream(const std::string &objectPath, const GattCharacteristic &characteristic, const GattCharacteristic::StreamEvent &streamEvent)
+{
+	if (streamEvent.rateHz <= 0 || streamEvent.rateHz > StreamTimers::kMaxRateHz)
+	{
+		Logger::warn(SSTR << "Ignoring stream event at " << streamEvent.rateHz << " Hz on '" << objectPath << "' (must be 1-" << StreamTimers::kMaxRateHz << " Hz)");
+		return false;
+	}
+
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0)
+	{
+		Logger::error(SSTR << "Failed to create stream timer for '" << objectPath << "': " << strerror(errno));
+		return false;
+	}
+
+	Stream stream;
+	stream.objectPath = objectPath;
+	stream.pCharacteristic = &characteristic;
+	stream.pEvent = &streamEvent.event;
+	stream.periodNS = 1000000000LL / streamEvent.rateHz;
+	stream.startNS = nowNS();
+	stream.deadlineCount = 0;
+	stream.lastLatencyNS = 0;
+	stream.fd = fd;
+	stream.sourceId = 0;
+	memset(&stream.stats, 0, sizeof(stream.stats));
+	stream.stats.rateHz = streamEvent.rateHz;
+
+	// Our deadlines are fixed relative to the start time, so they don't drift with the main loop
+	struct itimerspec spec;
+	spec.it_value = toTimespec(stream.startNS + stream.periodNS);
+	spec.it_interval = toTimespec(stream.periodNS);
+	if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+	{
+		Logger::error(SSTR << "Failed to arm stream timer for '" << objectPath << "': " << strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	Stream *pStream = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(streamsMutex);
+		streams.push_back(stream);
+		pStream = &streams.back();
+	}
+
+	pStream->sourceId = g_unix_fd_add_full(G_PRIORITY_HIGH, fd, G_IO_IN, onStreamTimer, pStream, nullptr);
+
+	Logger::debug(SSTR << "Started " << streamEvent.rateHz << " Hz stream event on '" << objectPath << "'");
+	return true;
+}
+
+// Starts the stream events of every characteristic in an object and its children
+static void startObjectStreams(const DBusObject &object, const DBusObjectPath &basePath)
+{
+	DBusObjectPath path = basePath + object.getPathNode();
+
+	for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
+	{
+		if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+		{
+			for (const GattCharacteristic::StreamEvent &streamEvent : pCharacteristic->getStreamEvents())
+			{
+				startStream(path.toString(), *pCharacteristic, streamEvent);
+			}
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		startObjectStreams(child, path);
+	}
+}
+
+// Creates a timer source for every stream event in the hierarchy (see `GattCharacteristic::onStreamEvent()`), replacing any
+// existing ones
+//
+// `fire` is called from the main loop each time an event fires.
+void StreamTimers::start(const std::list<DBusObject> &objects, const FireCallback &fire)
+{
+	stop();
+
+	fireCallback = fire;
+	for (const DBusObject &object : objects)
+	{
+		if (object.isPublished())
+		{
+			startObjectStreams(object, DBusObjectPath());
+		}
+	}
+}
+
+// Destroys all timer sources
+void StreamTimers::stop()
+{
+	std::lock_guard<std::mutex> lock(streamsMutex);
+
+	for (Stream &stream : streams)
+	{
+		if (0 != stream.sourceId)
+		{
+			g_source_remove(stream.sourceId);
+		}
+
+		close(stream.fd);
+	}
+
+	streams.clear();
+}
+
+// Returns the number of running streams
+size_t StreamTimers::size()
+{
+	std::lock_guard<std::mutex> lock(streamsMutex);
+	return streams.size();
+}
+
+// Retrieves the counters for the (first) stream event on the characteristic at the given object path
+//
+// Returns true if the characteristic has a running stream, otherwise false
+bool StreamTimers::getStats(const char *pObjectPath, GGKStreamStats &stats)
+{
+	std::lock_guard<std::mutex> lock(streamsMutex);
+
+	for (const Stream &stream : streams)
+	{
+		if (stream.objectPath == pObjectPath)
+		{
+			stats = stream.stats;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Resets the counters for the stream events on the characteristic at the given object path
+//
+// Returns true if the characteristic has a running stream, otherwise false
+bool StreamTimers::resetStats(const char *pObjectPath)
+{
+	std::lock_guard<std::mutex> lock(streamsMutex);
+
+	bool found = false;
+	for (Stream &stream : streams)
+	{
+		if (stream.objectPath == pObjectPath)
+		{
+			int rateHz = stream.stats.rateHz;
+			memset(&stream.stats, 0, sizeof(stream.stats));
+			stream.stats.rateHz = rateHz;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+}; // namespace ggk
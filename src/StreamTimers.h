@@ -0,0 +1,68 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Timerfd-driven main loop sources for high-rate characteristic events
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of StreamTimers.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stddef.h>
+#include <list>
+#include <functional>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+struct DBusObject;
+struct GattCharacteristic;
+struct TickEvent;
+
+struct StreamTimers
+{
+	// Called each time a stream event fires
+	typedef std::function<void(const GattCharacteristic &owner, const TickEvent &event)> FireCallback;
+
+	// The fastest rate a stream event may run at
+	static const int kMaxRateHz = 1000;
+
+	// Creates a timer source for every stream event in the hierarchy (see `GattCharacteristic::onStreamEvent()`), replacing any
+	// existing ones
+	//
+	// `fire` is called from the main loop each time an event fires.
+	static void start(const std::list<DBusObject> &objects, const FireCallback &fire);
+
+	// Destroys all timer sources
+	static void stop();
+
+	// Returns the number of running streams
+	static size_t size();
+
+	// Retrieves the counters for the (first) stream event on the characteristic at the given object path
+	//
+	// Returns true if the characteristic has a running stream, otherwise false
+	static bool getStats(const char *pObjectPath, GGKStreamStats &stats);
+
+	// Resets the counters for the stream events on the characteristic at the given object path
+	//
+	// Returns true if the characteristic has a running stream, otherwise false
+	static bool resetStats(const char *pObjectPath);
+};
+
+}; // namespace ggk
@@ -21,14 +21,12 @@
 // regular basis or performing other periodic tasks. One example usage might be checking the battery level every 60 seconds and if
 // it has changed since the last update, send out a notification to subscribers.
 //
-// The frequency at which events fire is dependent upon two values: the driving timer's tick frequency multiplied by the tick
-// freuency of the TickEvent itself.
+// Each event has a period, in milliseconds, which is set when the event is added via the `onEvent()` method to the server
+// description.
 //
-// The tick event's frequency is set when a tick event is added via the `onEvent()` method to the server description.
-//
-// The driving timer's frequency is a one-second-resolution low-frequency timer with a default of one second. To modify this, see
-// `kPeriodicTimerFrequencySeconds` at the top of Init.cpp. Note that the periodic timer (which drives tick events) is intentionally
-// a low-frequency timer. Higher frequency timers would lend themselves to using more battery on both, the server and client.
+// Events are scheduled on a timer wheel (see TimerWheel.cpp) once the server is up and running. The wheel only holds the events
+// that have been registered, so the cost of driving them depends on how many events are due, not on the size of the server
+// description.
 //
 // When using a TickEvent, be careful not to demand too much of your client. Notifiations that are too frequent may place undue
 // stress on their battery to receive and process the updates.
@@ -63,12 +61,9 @@ struct TickEvent
 	// A tick event callback, which is called whenever the TickEvent fires
 	typedef void (*Callback)(const DBusInterface &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 
-	// Construct a TickEvent that will fire after a specified 'tickFrequency' number of ticks of the periodic timer.
-	//
-	// Note that the actual time between a callback's execution is the event's 'tickFrequency' multiplied by the time between each
-	// periodic timer tick.
-	TickEvent(const DBusInterface *pOwner, int tickFrequency, Callback callback, void *pUserData)
-	: pOwner(pOwner), elapsedTicks(0), tickFrequency(tickFrequency), callback(callback), pUserData(pUserData)
+	// Construct a TickEvent that will fire every `periodMS` milliseconds
+	TickEvent(const DBusInterface *pOwner, int periodMS, Callback callback, void *pUserData)
+	: pOwner(pOwner), periodMS(periodMS), callback(callback), pUserData(pUserData)
 	{
 	}
 
@@ -76,17 +71,16 @@ struct TickEvent
 	// Accessors
 	//
 
-	// Returns the elapsed ticks since the last event firing
-	int getElapsedTicks() const { return elapsedTicks; }
-
-	// Sets the elapsed ticks since the last event firing
-	void setElapsedTicks(int elapsed) { elapsedTicks = elapsed; }
+	// Returns the interface that owns this TickEvent
+	const DBusInterface *getOwner() const { return pOwner; }
 
-	// Returns the tick frequency between schedule tick events
-	int getTickFrequency() const { return tickFrequency; }
+	// Returns the time between firings of this event, in milliseconds
+	int getPeriodMS() const { return periodMS; }
 
-	// Sets the tick frequency between schedule tick events
-	void setTickFrequency(int frequency) { tickFrequency = frequency; }
+	// Sets the time between firings of this event, in milliseconds
+	//
+	// The new period takes effect after the event next fires.
+	void setPeriodMS(int period) { periodMS = period; }
 
 	// Returns the user data pointer associated to this TickEvent
 	void *getUserData() { return pUserData; }
@@ -101,29 +95,19 @@ struct TickEvent
 	void setCallback(Callback callback) { this->callback = callback; }
 
 	//
-	// Tick management
+	// Firing
 	//
 
-	// Perform a single tick of a TickEvent
-	//
-	// A TickEvent is ticked each time the periodic timer fires. The TickEvent only fires after `tickFrequency` ticks. As a result,
-	// the `callback` is only called after a period of time equal to the time between firings of the periodic timer, multiplied by
-	// `tickFrequency`.
+	// Fires the TickEvent, calling its callback
 	//
-	// Returns true if event fires, false otherwise
+	// This is called by the timer wheel each time the event's period elapses (see TimerWheel.cpp.)
 	template<typename T>
-	void tick(const DBusObjectPath &path, GDBusConnection *pConnection, void *pUserData) const
+	void fire(const DBusObjectPath &path, GDBusConnection *pConnection, void *pUserData) const
 	{
-		elapsedTicks += 1;
-		if (elapsedTicks >= tickFrequency)
+		if (nullptr != callback)
 		{
-			if (nullptr != callback)
-			{
-				Logger::debug(SSTR << "Ticking at path '" << path << "'");
-				callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
-			}
-
-			elapsedTicks = 0;
+			Logger::debug(SSTR << "Ticking at path '" << path << "'");
+			callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
 		}
 	}
 
@@ -134,8 +118,7 @@ private:
 	//
 
 	const DBusInterface *pOwner;
-	mutable int elapsedTicks;
-	int tickFrequency;
+	int periodMS;
 	Callback callback;
 	void *pUserData;
 };
@@ -0,0 +1,210 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A hierarchical timer wheel that schedules the server's TickEvents with millisecond resolution
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// TickEvents used to be driven by a one-second periodic timer that walked the entire object hierarchy on every tick, bumping a
+// counter in each event along the way. That visits every node of the server description every second, even if only one event is
+// due, and it limits events to one-second resolution.
+//
+// Instead, the events are added to this wheel once, when the server starts (see Init.cpp.) The wheel has several levels of 64
+// slots each. A slot on level 0 covers a single millisecond, a slot on level 1 covers 64 milliseconds, a slot on level 2 covers
+// 4096 milliseconds, and so on. An event is placed on the lowest level whose slots can tell its expiry time apart from the
+// wheel's current time. When the wheel reaches a slot on a higher level, the events in it are moved down to the levels below,
+// and by the time an event is due it is in a level 0 slot of its own millisecond.
+//
+// Each level keeps a 64-bit mask of its occupied slots, so finding the next slot that needs attention is a handful of bit
+// operations per level. The wheel never steps through empty slots, which means the cost of moving it forward depends on the
+// number of events that are due (and the occasional move down a level), not on the time elapsed or the size of the hierarchy.
+// The server keeps a single GLib timeout armed for the time the wheel next needs attention (see `nextWakeMS()`), so an idle
+// server isn't woken up at all.
+//
+// The wheel is only ever used from the server's main loop, so it has no locking. Its events don't change once the server
+// description is complete, so it never allocates after it has been filled.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "TimerWheel.h"
+#include "TickEvent.h"
+
+namespace ggk {
+
+// Construct an empty wheel
+TimerWheel::TimerWheel()
+{
+	reset(0);
+}
+
+// Removes all events and sets the wheel's current time
+void TimerWheel::reset(uint64_t nowMS)
+{
+	timers.clear();
+	for (int level = 0; level < kLevels; ++level)
+	{
+		for (int slot = 0; slot < kSlots; ++slot)
+		{
+			slots[level][slot] = -1;
+		}
+
+		occupied[level] = 0;
+	}
+
+	currentMS = nowMS;
+}
+
+// Adds an event to the wheel, to fire one period after `nowMS` and every period thereafter
+//
+// The wheel holds pointers to the event and its owner, so they must outlive the wheel (or the next `reset()`.)
+void TimerWheel::add(const DBusInterface &owner, const TickEvent &event, uint64_t nowMS)
+{
+	if (timers.empty() && nowMS > currentMS)
+	{
+		currentMS = nowMS;
+	}
+
+	int period = event.getPeriodMS() > 0 ? event.getPeriodMS() : 1;
+
+	Timer timer;
+	timer.pOwner = &owner;
+	timer.pEvent = &event;
+	timer.expiryMS = nowMS + period;
+	timer.next = -1;
+	timers.push_back(timer);
+
+	insert(static_cast<int>(timers.size() - 1));
+}
+
+// Moves the wheel forward to `nowMS`, calling `fire` for each event that falls due along the way
+void TimerWheel::advance(uint64_t nowMS, const FireCallback &fire)
+{
+	uint64_t whenMS;
+	int level;
+	int slot;
+	while (findNext(whenMS, level, slot) && whenMS <= nowMS)
+	{
+		currentMS = whenMS;
+
+		int timer = detachSlot(level, slot);
+		while (timer >= 0)
+		{
+			Timer &entry = timers[timer];
+			int next = entry.next;
+
+			// Events on level 0 are due now; those on higher levels just move down the hierarchy
+			if (0 == level)
+			{
+				fire(*entry.pOwner, *entry.pEvent);
+
+				// If we've fallen behind, skip the firings we missed rather than delivering them in a burst
+				uint64_t period = entry.pEvent->getPeriodMS() > 0 ? entry.pEvent->getPeriodMS() : 1;
+				entry.expiryMS += period;
+				if (entry.expiryMS <= nowMS)
+				{
+					entry.expiryMS = nowMS + period;
+				}
+			}
+
+			insert(timer);
+			timer = next;
+		}
+	}
+
+	if (nowMS > currentMS)
+	{
+		currentMS = nowMS;
+	}
+}
+
+// Returns the time at which `advance()` next has work to do, or kNever if the wheel is empty
+//
+// This is either the time an event is due or the time a group of events must be moved down the hierarchy, which is never
+// later than the time the earliest of them is due.
+uint64_t TimerWheel::nextWakeMS() const
+{
+	uint64_t whenMS;
+	int level;
+	int slot;
+	return findNext(whenMS, level, slot) ? whenMS : kNever;
+}
+
+// Places a timer in the slot for its expiry time
+void TimerWheel::insert(int timer)
+{
+	Timer &entry = timers[timer];
+	uint64_t expiryMS = entry.expiryMS > currentMS ? entry.expiryMS : currentMS;
+
+	// The level is the highest group of slot bits in which the expiry time differs from the current time
+	uint64_t difference = expiryMS ^ currentMS;
+	int level = 0;
+	while (level + 1 < kLevels && (difference >> (kSlotBits * (level + 1))) != 0)
+	{
+		level += 1;
+	}
+
+	int slot = static_cast<int>((expiryMS >> (kSlotBits * level)) & kSlotMask);
+	entry.next = slots[level][slot];
+	slots[level][slot] = timer;
+	occupied[level] |= 1ULL << slot;
+}
+
+// Removes all timers from a slot and returns the first of them (or -1 if the slot was empty)
+int TimerWheel::detachSlot(int level, int slot)
+{
+	int first = slots[level][slot];
+	slots[level][slot] = -1;
+	occupied[level] &= ~(1ULL << slot);
+	return first;
+}
+
+// Finds the next slot that needs attention, returning false if the wheel is empty
+//
+// Level 0 slots at or after the current time's slot hold events that are due within the current 64 milliseconds. On higher
+// levels, the slot for the current time has already been moved down, so only the slots after it are of interest. The first
+// occupied slot on the lowest level is always the earliest.
+bool TimerWheel::findNext(uint64_t &whenMS, int &level, int &slot) const
+{
+	for (level = 0; level < kLevels; ++level)
+	{
+		int shift = kSlotBits * level;
+		int position = static_cast<int>((currentMS >> shift) & kSlotMask);
+
+		uint64_t candidates = occupied[level];
+		if (0 == level)
+		{
+			candidates &= ~0ULL << position;
+		}
+		else
+		{
+			candidates &= position + 1 < kSlots ? ~0ULL << (position + 1) : 0;
+		}
+
+		if (0 == candidates)
+		{
+			continue;
+		}
+
+		slot = __builtin_ctzll(candidates);
+
+		// The start of the current time's span on the level above, plus the offset of the slot
+		uint64_t baseMS = shift + kSlotBits >= 64 ? 0 : currentMS & ~((1ULL << (shift + kSlotBits)) - 1);
+		whenMS = baseMS | (static_cast<uint64_t>(slot) << shift);
+		return true;
+	}
+
+	return false;
+}
+
+}; // namespace ggk
@@ -0,0 +1,107 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A hierarchical timer wheel that schedules the server's TickEvents with millisecond resolution
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of TimerWheel.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
+
+namespace ggk {
+
+struct DBusInterface;
+struct TickEvent;
+
+struct TimerWheel
+{
+	// Called for each event as it falls due
+	typedef std::function<void(const DBusInterface &owner, const TickEvent &event)> FireCallback;
+
+	// Returned by `nextWakeMS()` when there is nothing scheduled
+	static const uint64_t kNever = 0xffffffffffffffffULL;
+
+	// Construct an empty wheel
+	TimerWheel();
+
+	// Removes all events and sets the wheel's current time
+	void reset(uint64_t nowMS);
+
+	// Adds an event to the wheel, to fire one period after `nowMS` and every period thereafter
+	//
+	// The wheel holds pointers to the event and its owner, so they must outlive the wheel (or the next `reset()`.)
+	void add(const DBusInterface &owner, const TickEvent &event, uint64_t nowMS);
+
+	// Returns the number of events on the wheel
+	size_t size() const { return timers.size(); }
+
+	// Moves the wheel forward to `nowMS`, calling `fire` for each event that falls due along the way
+	void advance(uint64_t nowMS, const FireCallback &fire);
+
+	// Returns the time at which `advance()` next has work to do, or kNever if the wheel is empty
+	//
+	// This is either the time an event is due or the time a group of events must be moved down the hierarchy, which is never
+	// later than the time the earliest of them is due.
+	uint64_t nextWakeMS() const;
+
+private:
+
+	// Each level of the wheel has 64 slots, so a level's occupancy fits in a single 64-bit mask
+	static const int kSlotBits = 6;
+	static const int kSlots = 1 << kSlotBits;
+	static const uint64_t kSlotMask = kSlots - 1;
+
+	// Enough levels to cover every 64-bit time
+	static const int kLevels = (64 + kSlotBits - 1) / kSlotBits;
+
+	// A scheduled event
+	struct Timer
+	{
+		const DBusInterface *pOwner;
+		const TickEvent *pEvent;
+		uint64_t expiryMS;
+		int next;
+	};
+
+	// Places a timer in the slot for its expiry time
+	void insert(int timer);
+
+	// Removes all timers from a slot and returns the first of them (or -1 if the slot was empty)
+	int detachSlot(int level, int slot);
+
+	// Finds the next slot that needs attention, returning false if the wheel is empty
+	bool findNext(uint64_t &whenMS, int &level, int &slot) const;
+
+	// Our timers; each slot is a singly linked list threaded through them
+	std::vector<Timer> timers;
+
+	// The first timer in each slot (-1 if empty)
+	int slots[kLevels][kSlots];
+
+	// A bit for each slot in a level that holds any timers
+	uint64_t occupied[kLevels];
+
+	// The wheel's current time
+	uint64_t currentMS;
+};
+
+}; // namespace ggk
@@ -0,0 +1,555 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The queue of pending data updates, shared between the application's threads and the server thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The application tells the server that data has changed by pushing entries onto this queue (see `ggkNofifyUpdatedCharacteristic`
+// and friends in Gobbledegook.cpp.) The server thread drains the queue from its main loop (see Init.cpp.)
+//
+// Applications often push updates from several threads at high rates, so the queue is built to keep producers out of each
+// other's way:
+//
+//     * Entries don't carry strings. Each (object path, interface name) pair is interned once into a small integer ID and the
+//       queue only stores that ID and a timestamp. The server pre-interns every characteristic and descriptor at startup, so
+//       by the time the application starts pushing, looking up an ID is a lock-free probe of a read-only hash table. It also
+//       resolves each ID to its interface (see `setTarget()`), so delivering an update doesn't involve a search by path either.
+//       The public API only looks pairs up (see `find()`), so a path that isn't in the server's description (a typo, say) is
+//       rejected rather than using up one of the limited IDs for good.
+//
+//     * The queue itself is a bounded ring with lock-free producers (the classic sequence-numbered ring buffer design.) Each cell
+//       carries a sequence number that tells producers and the consumer whether the cell is free or filled for their position,
+//       so the only contention between producers is a compare-and-swap on the enqueue position. When the ring is full, pushes
+//       fail rather than block or allocate.
+//
+//     * There is only ever one consumer at a time. Entries are taken by the server thread, but the application may also take
+//       them with `ggkPopUpdateQueue()`, so consumers are serialized by a mutex that producers never touch. A consumer therefore
+//       owns the cell at the dequeue position until it releases it, which is what allows `pop()` to look at an entry before
+//       deciding whether to remove it. The server thread takes the mutex once per batch, not once per entry.
+//
+// The server thread drains the queue in batches of up to `getBatchBudget()` entries per main loop iteration. The budget keeps a
+// burst of updates from starving the rest of the main loop (D-Bus method calls, timers, etc.)
+//
+// Coalescing is an opt-in mode (see `ggkUpdateQueueSetCoalescing()`) in which the queue holds at most one pending entry for each
+// ID. Each ID keeps a count of its pending entries; an update to data that already has a pending entry is simply merged into it.
+// The server reads the current value when it processes the entry, so nothing is lost. This bounds the size of the queue by the
+// number of characteristics rather than the rate at which the application produces updates.
+//
+// The queue also keeps a few counters (batch sizes, how long entries waited in the queue, merged and dropped updates) which are
+// available to the application through `ggkUpdateQueueGetStats()`.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <algorithm>
+#include <string.h>
+
+#include "UpdateQueue.h"
+
+namespace ggk {
+
+//
+// Interned IDs
+//
+
+// An interned (object path, interface name) pair
+struct InternRecord
+{
+	InternRecord(const char *pObjectPath, const char *pInterfaceName, size_t hash, UpdateQueue::Id id)
+	: objectPath(pObjectPath), interfaceName(pInterfaceName), hash(hash), id(id), pTarget(nullptr), pendingCount(0)
+	{
+	}
+
+	std::string objectPath;
+	std::string interfaceName;
+	size_t hash;
+	UpdateQueue::Id id;
+
+	// The interface this ID refers to, if the server has resolved it (see `setTarget()`)
+	std::atomic<const DBusInterface *> pTarget;
+
+	// The number of entries for this ID currently in the queue
+	std::atomic<int> pendingCount;
+};
+
+// Number of slots in our open-addressed hash table (a power of two, twice the maximum number of IDs)
+static const size_t kInternSlots = UpdateQueue::kMaxIds * 2;
+
+// Records are only ever added (never removed), so they are published to readers with a single atomic store
+static std::atomic<InternRecord *> internSlots[kInternSlots];
+static std::atomic<InternRecord *> internById[UpdateQueue::kMaxIds];
+
+// Storage for our records (a deque never moves its elements), protected by internMutex along with any writes to the tables
+static std::deque<InternRecord> internRecords;
+static std::mutex internMutex;
+
+// Returned for unknown IDs
+static const std::string emptyString;
+
+//
+// The ring
+//
+
+// A cell in our ring
+struct RingCell
+{
+	std::atomic<size_t> sequence;
+	UpdateQueue::Entry entry;
+};
+
+// Our ring, with the producer and consumer positions on their own cache lines
+struct Ring
+{
+	Ring()
+	{
+		for (size_t i = 0; i < UpdateQueue::kCapacity; ++i)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	RingCell cells[UpdateQueue::kCapacity];
+	alignas(64) std::atomic<size_t> enqueuePos{0};
+	alignas(64) std::atomic<size_t> dequeuePos{0};
+};
+
+static const size_t kRingMask = UpdateQueue::kCapacity - 1;
+static Ring ring;
+
+// Serializes consumers (see the discussion above)
+static std::mutex consumerMutex;
+
+//
+// Configuration
+//
+
+static std::atomic<int> batchBudget(UpdateQueue::kDefaultBatchBudget);
+static std::atomic<bool> coalescing(false);
+
+//
+// Statistics
+//
+
+static std::atomic<uint64_t> statBatchCount(0);
+static std::atomic<uint64_t> statEntryCount(0);
+static std::atomic<uint64_t> statLastBatchSize(0);
+static std::atomic<uint64_t> statMaxBatchSize(0);
+static std::atomic<uint64_t> statTotalResidencyUS(0);
+static std::atomic<uint64_t> statMaxResidencyUS(0);
+static std::atomic<uint64_t> statMergedCount(0);
+static std::atomic<uint64_t> statDroppedCount(0);
+
+// Raises `value` to at least `candidate`
+static void atomicMax(std::atomic<uint64_t> &value, uint64_t candidate)
+{
+	uint64_t current = value;
+	while (candidate > current && !value.compare_exchange_weak(current, candidate)) {}
+}
+
+// Hashes an (object path, interface name) pair (FNV-1a)
+static size_t hashPair(const char *pObjectPath, const char *pInterfaceName)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char *p = pObjectPath; *p; ++p) { hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL; }
+	hash = (hash ^ '|') * 1099511628211ULL;
+	for (const char *p = pInterfaceName; *p; ++p) { hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL; }
+	return static_cast<size_t>(hash);
+}
+
+// Searches the hash table for a pair, returning its record or nullptr if not found
+static InternRecord *findRecord(const char *pObjectPath, const char *pInterfaceName, size_t hash)
+{
+	for (size_t probe = 0; probe < kInternSlots; ++probe)
+	{
+		InternRecord *pRecord = internSlots[(hash + probe) & (kInternSlots - 1)].load(std::memory_order_acquire);
+		if (nullptr == pRecord)
+		{
+			return nullptr;
+		}
+
+		if (pRecord->hash == hash && pRecord->objectPath == pObjectPath && pRecord->interfaceName == pInterfaceName)
+		{
+			return pRecord;
+		}
+	}
+
+	return nullptr;
+}
+
+// Returns the record for an ID, or nullptr if the ID is not valid
+static InternRecord *getRecord(UpdateQueue::Id id)
+{
+	if (id >= UpdateQueue::kMaxIds)
+	{
+		return nullptr;
+	}
+
+	return internById[id].load(std::memory_order_acquire);
+}
+
+// Returns the ID for the given object path and interface name, interning the pair if needed
+//
+// This method is thread-safe. Looking up a pair that has already been interned does not take a lock or allocate memory.
+//
+// Returns kInvalidId if either parameter is null or the table of IDs is full
+UpdateQueue::Id UpdateQueue::intern(const char *pObjectPath, const char *pInterfaceName)
+{
+	if (nullptr == pObjectPath || nullptr == pInterfaceName)
+	{
+		return kInvalidId;
+	}
+
+	size_t hash = hashPair(pObjectPath, pInterfaceName);
+
+	// Fast path: already interned
+	if (InternRecord *pRecord = findRecord(pObjectPath, pInterfaceName, hash))
+	{
+		return pRecord->id;
+	}
+
+	// Slow path: search again under the lock (someone may have beat us to it) and add it
+	std::lock_guard<std::mutex> guard(internMutex);
+
+	if (InternRecord *pRecord = findRecord(pObjectPath, pInterfaceName, hash))
+	{
+		return pRecord->id;
+	}
+
+	if (internRecords.size() >= kMaxIds)
+	{
+		return kInvalidId;
+	}
+
+	Id id = static_cast<Id>(internRecords.size());
+	internRecords.emplace_back(pObjectPath, pInterfaceName, hash, id);
+	InternRecord *pRecord = &internRecords.back();
+	internById[id].store(pRecord, std::memory_order_release);
+
+	// With the table at most half full, we're guaranteed to find an empty slot
+	for (size_t probe = 0; ; ++probe)
+	{
+		std::atomic<InternRecord *> &slot = internSlots[(hash + probe) & (kInternSlots - 1)];
+		if (nullptr == slot.load(std::memory_order_relaxed))
+		{
+			slot.store(pRecord, std::memory_order_release);
+			break;
+		}
+	}
+
+	return id;
+}
+
+// Returns the ID for the given object path and interface name if the pair has been interned, without interning it
+//
+// This method is lock-free and does not allocate memory.
+//
+// Returns kInvalidId if either parameter is null or the pair has not been interned
+UpdateQueue::Id UpdateQueue::find(const char *pObjectPath, const char *pInterfaceName)
+{
+	if (nullptr == pObjectPath || nullptr == pInterfaceName)
+	{
+		return kInvalidId;
+	}
+
+	InternRecord *pRecord = findRecord(pObjectPath, pInterfaceName, hashPair(pObjectPath, pInterfaceName));
+	return nullptr == pRecord ? kInvalidId : pRecord->id;
+}
+
+// Returns the object path for an interned ID (or an empty string if the ID is not valid)
+const std::string &UpdateQueue::getObjectPath(Id id)
+{
+	InternRecord *pRecord = getRecord(id);
+	return nullptr == pRecord ? emptyString : pRecord->objectPath;
+}
+
+// Returns the interface name for an interned ID (or an empty string if the ID is not valid)
+const std::string &UpdateQueue::getInterfaceName(Id id)
+{
+	InternRecord *pRecord = getRecord(id);
+	return nullptr == pRecord ? emptyString : pRecord->interfaceName;
+}
+
+// Sets the interface an interned ID refers to, so that updates can be delivered without looking it up (or nullptr to clear it)
+//
+// The server resolves the IDs for every characteristic and descriptor in its description when it starts.
+void UpdateQueue::setTarget(Id id, const DBusInterface *pTarget)
+{
+	if (InternRecord *pRecord = getRecord(id))
+	{
+		pRecord->pTarget.store(pTarget, std::memory_order_release);
+	}
+}
+
+// Returns the interface an interned ID refers to, or nullptr if the ID is not valid or has not been resolved
+const DBusInterface *UpdateQueue::getTarget(Id id)
+{
+	InternRecord *pRecord = getRecord(id);
+	return nullptr == pRecord ? nullptr : pRecord->pTarget.load(std::memory_order_acquire);
+}
+
+// Adds an update to the queue
+//
+// This method is lock-free and may be called from any number of threads.
+//
+// If coalescing is enabled and an entry for the same ID is already pending, the update is merged into that entry and nothing
+// new is added to the queue.
+UpdateQueue::PushResult UpdateQueue::push(Id id)
+{
+	InternRecord *pRecord = getRecord(id);
+	if (nullptr == pRecord)
+	{
+		statDroppedCount += 1;
+		return EInvalid;
+	}
+
+	// Claim a pending slot for this ID, or merge with the one that's already pending
+	//
+	// Note that a merge is still a read-modify-write of the pending count. That places it in the count's release sequence so that
+	// the server, which decrements the count before processing the entry, is guaranteed to see any data the application wrote
+	// before pushing this update.
+	bool coalesce = coalescing.load(std::memory_order_relaxed);
+	int pending = pRecord->pendingCount.load(std::memory_order_relaxed);
+	while (true)
+	{
+		if (coalesce && pending > 0)
+		{
+			if (pRecord->pendingCount.compare_exchange_weak(pending, pending, std::memory_order_acq_rel))
+			{
+				statMergedCount += 1;
+				return EMerged;
+			}
+		}
+		else if (pRecord->pendingCount.compare_exchange_weak(pending, pending + 1, std::memory_order_acq_rel))
+		{
+			break;
+		}
+	}
+
+	// Find a free cell
+	size_t pos = ring.enqueuePos.load(std::memory_order_relaxed);
+	RingCell *pCell;
+	while (true)
+	{
+		pCell = &ring.cells[pos & kRingMask];
+		size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+		if (diff == 0)
+		{
+			if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Full
+			pRecord->pendingCount.fetch_sub(1, std::memory_order_acq_rel);
+			statDroppedCount += 1;
+			return EFull;
+		}
+		else
+		{
+			pos = ring.enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Fill it and hand it to the consumer
+	pCell->entry.id = id;
+	pCell->entry.pushTime = std::chrono::steady_clock::now();
+	pCell->sequence.store(pos + 1, std::memory_order_release);
+
+	return EAdded;
+}
+
+// Retrieves the oldest entry in the queue, with the consumer mutex held (see `pop()`)
+static int popLocked(UpdateQueue::Entry &entry, bool keep, UpdateQueue::AcceptFunc accept, void *pContext)
+{
+	// We are the only consumer, so nobody else can move the dequeue position or recycle the cell under it
+	size_t pos = ring.dequeuePos.load(std::memory_order_relaxed);
+	RingCell &cell = ring.cells[pos & kRingMask];
+	if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+	{
+		// Empty
+		return 0;
+	}
+
+	entry = cell.entry;
+
+	if (nullptr != accept && !accept(entry, pContext))
+	{
+		return -1;
+	}
+
+	if (keep)
+	{
+		return 1;
+	}
+
+	// Hand the cell back to the producers
+	ring.dequeuePos.store(pos + 1, std::memory_order_release);
+	cell.sequence.store(pos + UpdateQueue::kCapacity, std::memory_order_release);
+
+	// This entry is no longer pending
+	if (InternRecord *pRecord = getRecord(entry.id))
+	{
+		pRecord->pendingCount.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	return 1;
+}
+
+// Retrieves the oldest entry in the queue
+//
+// This method may be called from any thread. Consumers are serialized (see the discussion at the top of this file.)
+//
+// If `keep` is true, the entry is not removed from the queue. If `accept` is provided, it is called with the entry before it
+// is removed; if it returns false, the entry is left in the queue.
+//
+// Returns 1 on success, 0 if the queue is empty or -1 if the entry was not accepted
+int UpdateQueue::pop(Entry &entry, bool keep, AcceptFunc accept, void *pContext)
+{
+	std::lock_guard<std::mutex> guard(consumerMutex);
+	return popLocked(entry, keep, accept, pContext);
+}
+
+// Moves up to the current batch budget of the oldest entries into `batch`
+//
+// This should only be called from the server thread. Any entries already in `batch` are discarded.
+//
+// Returns the number of entries taken
+size_t UpdateQueue::takeBatch(Batch &batch)
+{
+	batch.clear();
+
+	int budget = batchBudget;
+	size_t limit = budget <= 0 ? kCapacity : static_cast<size_t>(budget);
+
+	{
+		std::lock_guard<std::mutex> guard(consumerMutex);
+
+		Entry entry;
+		while (batch.size() < limit && popLocked(entry, false, nullptr, nullptr) == 1)
+		{
+			batch.push_back(entry);
+		}
+	}
+
+	if (batch.empty())
+	{
+		return 0;
+	}
+
+	// Update our counters
+	auto now = std::chrono::steady_clock::now();
+	uint64_t totalResidency = 0;
+	uint64_t maxResidency = 0;
+	for (const Entry &entry : batch)
+	{
+		uint64_t residency = std::chrono::duration_cast<std::chrono::microseconds>(now - entry.pushTime).count();
+		totalResidency += residency;
+		maxResidency = std::max(maxResidency, residency);
+	}
+
+	statBatchCount += 1;
+	statEntryCount += batch.size();
+	statLastBatchSize = batch.size();
+	atomicMax(statMaxBatchSize, batch.size());
+	statTotalResidencyUS += totalResidency;
+	atomicMax(statMaxResidencyUS, maxResidency);
+
+	return batch.size();
+}
+
+// Returns true if the queue is empty
+bool UpdateQueue::isEmpty()
+{
+	return size() == 0;
+}
+
+// Returns the number of entries waiting in the queue
+size_t UpdateQueue::size()
+{
+	// These are read independently, so it's possible to briefly see the dequeue position ahead of the enqueue position
+	size_t dequeuePos = ring.dequeuePos.load(std::memory_order_acquire);
+	size_t enqueuePos = ring.enqueuePos.load(std::memory_order_acquire);
+	return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
+
+// Removes all entries from the queue
+void UpdateQueue::clear()
+{
+	std::lock_guard<std::mutex> guard(consumerMutex);
+
+	Entry entry;
+	while (popLocked(entry, false, nullptr, nullptr) == 1) {}
+}
+
+// Sets the maximum number of entries processed per main loop iteration (a value <= 0 means no limit)
+void UpdateQueue::setBatchBudget(int maxEntries)
+{
+	batchBudget = maxEntries;
+}
+
+// Returns the maximum number of entries processed per main loop iteration (a value <= 0 means no limit)
+int UpdateQueue::getBatchBudget()
+{
+	return batchBudget;
+}
+
+// Enables or disables coalescing of pending updates
+//
+// With coalescing enabled, pushing an update for an ID that already has a pending entry merges the update into that entry.
+// Entries already in the queue when coalescing is enabled are left as they are.
+void UpdateQueue::setCoalescing(bool enabled)
+{
+	coalescing = enabled;
+}
+
+// Returns true if coalescing of pending updates is enabled
+bool UpdateQueue::getCoalescing()
+{
+	return coalescing;
+}
+
+// Retrieves the queue's counters
+void UpdateQueue::getStats(GGKUpdateQueueStats &stats)
+{
+	stats.batchCount = statBatchCount;
+	stats.entryCount = statEntryCount;
+	stats.lastBatchSize = statLastBatchSize;
+	stats.maxBatchSize = statMaxBatchSize;
+	stats.totalResidencyMicroseconds = statTotalResidencyUS;
+	stats.maxResidencyMicroseconds = statMaxResidencyUS;
+	stats.mergedCount = statMergedCount;
+	stats.droppedCount = statDroppedCount;
+}
+
+// Resets the queue's counters
+void UpdateQueue::resetStats()
+{
+	statBatchCount = 0;
+	statEntryCount = 0;
+	statLastBatchSize = 0;
+	statMaxBatchSize = 0;
+	statTotalResidencyUS = 0;
+	statMaxResidencyUS = 0;
+	statMergedCount = 0;
+	statDroppedCount = 0;
+}
+
+}; // namespace ggk
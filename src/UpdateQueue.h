@@ -0,0 +1,172 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// The queue of pending data updates, shared between the application's threads and the server thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of UpdateQueue.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+struct DBusInterface;
+
+struct UpdateQueue
+{
+	// An interned (object path, interface name) pair
+	typedef uint32_t Id;
+
+	// The ID used to represent an invalid or unknown (object path, interface name) pair
+	static const Id kInvalidId = 0xffffffff;
+
+	// The maximum number of distinct (object path, interface name) pairs that can be interned
+	static const size_t kMaxIds = 8192;
+
+	// The maximum number of entries the queue can hold (must be a power of two)
+	static const size_t kCapacity = 4096;
+
+	// The default maximum number of entries processed per main loop iteration
+	static const int kDefaultBatchBudget = 64;
+
+	// A single pending update
+	struct Entry
+	{
+		// The interned (object path, interface name) pair that was updated
+		Id id;
+
+		// The time at which this entry was pushed onto the queue
+		std::chrono::steady_clock::time_point pushTime;
+	};
+
+	// A batch of entries, in queue order (oldest first)
+	typedef std::vector<Entry> Batch;
+
+	// The result of a push
+	enum PushResult
+	{
+		// A new entry was added to the queue
+		EAdded,
+
+		// The update was merged into an entry that is already pending (coalescing only)
+		EMerged,
+
+		// The queue is full, the update was dropped
+		EFull,
+
+		// The ID was not valid, the update was dropped
+		EInvalid
+	};
+
+	// A delegate used to inspect an entry before it is removed from the queue (see `pop()`)
+	//
+	// Return true to accept the entry, or false to leave it in the queue
+	typedef bool (*AcceptFunc)(const Entry &entry, void *pContext);
+
+	// Returns the ID for the given object path and interface name, interning the pair if needed
+	//
+	// This method is thread-safe. Looking up a pair that has already been interned does not take a lock or allocate memory.
+	//
+	// Returns kInvalidId if either parameter is null or the table of IDs is full
+	static Id intern(const char *pObjectPath, const char *pInterfaceName);
+
+	// Returns the ID for the given object path and interface name if the pair has been interned, without interning it
+	//
+	// This method is lock-free and does not allocate memory.
+	//
+	// Returns kInvalidId if either parameter is null or the pair has not been interned
+	static Id find(const char *pObjectPath, const char *pInterfaceName);
+
+	// Returns the object path for an interned ID (or an empty string if the ID is not valid)
+	static const std::string &getObjectPath(Id id);
+
+	// Returns the interface name for an interned ID (or an empty string if the ID is not valid)
+	static const std::string &getInterfaceName(Id id);
+
+	// Sets the interface an interned ID refers to, so that updates can be delivered without looking it up (or nullptr to clear it)
+	//
+	// The server resolves the IDs for every characteristic and descriptor in its description when it starts.
+	static void setTarget(Id id, const DBusInterface *pTarget);
+
+	// Returns the interface an interned ID refers to, or nullptr if the ID is not valid or has not been resolved
+	static const DBusInterface *getTarget(Id id);
+
+	// Adds an update to the queue
+	//
+	// This method is lock-free and may be called from any number of threads.
+	//
+	// If coalescing is enabled and an entry for the same ID is already pending, the update is merged into that entry and nothing
+	// new is added to the queue.
+	static PushResult push(Id id);
+
+	// Retrieves the oldest entry in the queue
+	//
+	// This method may be called from any thread. Consumers are serialized (see the discussion at the top of UpdateQueue.cpp.)
+	//
+	// If `keep` is true, the entry is not removed from the queue. If `accept` is provided, it is called with the entry before it
+	// is removed; if it returns false, the entry is left in the queue.
+	//
+	// Returns 1 on success, 0 if the queue is empty or -1 if the entry was not accepted
+	static int pop(Entry &entry, bool keep, AcceptFunc accept = nullptr, void *pContext = nullptr);
+
+	// Moves up to the current batch budget of the oldest entries into `batch`
+	//
+	// This should only be called from the server thread. Any entries already in `batch` are discarded.
+	//
+	// Returns the number of entries taken
+	static size_t takeBatch(Batch &batch);
+
+	// Returns true if the queue is empty
+	static bool isEmpty();
+
+	// Returns the number of entries waiting in the queue
+	static size_t size();
+
+	// Removes all entries from the queue
+	static void clear();
+
+	// Sets the maximum number of entries processed per main loop iteration (a value <= 0 means no limit)
+	static void setBatchBudget(int maxEntries);
+
+	// Returns the maximum number of entries processed per main loop iteration (a value <= 0 means no limit)
+	static int getBatchBudget();
+
+	// Enables or disables coalescing of pending updates
+	//
+	// With coalescing enabled, pushing an update for an ID that already has a pending entry merges the update into that entry.
+	// Entries already in the queue when coalescing is enabled are left as they are.
+	static void setCoalescing(bool enabled);
+
+	// Returns true if coalescing of pending updates is enabled
+	static bool getCoalescing();
+
+	// Retrieves the queue's counters
+	static void getStats(GGKUpdateQueueStats &stats);
+
+	// Resets the queue's counters
+	static void resetStats();
+};
+
+}; // namespace ggk
@@ -360,7 +360,7 @@ GVariant *Utils::gvariantFromByteArray(const guint8 *pBytes, int count)
 }
 
 // Returns an array of bytes ("ay") with the contents of the input array of unsigned 8-bit values
-GVariant *Utils::gvariantFromByteArray(const std::vector<guint8> bytes)
+GVariant *Utils::gvariantFromByteArray(const std::vector<guint8> &bytes)
 {
 	GBytes *pGbytes = g_bytes_new(bytes.data(), bytes.size());
 	GVariant *pGVariant = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pGbytes, bytes.size());
@@ -368,6 +368,26 @@ GVariant *Utils::gvariantFromByteArray(const std::vector<guint8> bytes)
 	return pGVariant;
 }
 
+// Returns an array of bytes ("ay") that references the contents of `pBytes` without copying them
+//
+// The returned variant holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+GVariant *Utils::gvariantFromBytes(GBytes *pBytes)
+{
+	return g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pBytes, TRUE);
+}
+
+// Returns an array of bytes ("ay") that references a caller-owned buffer without copying it
+//
+// The buffer must remain valid and unchanged until `freeFunc` is called with `pUserData`, which happens once the variant (and
+// anything built from it) has been released. `freeFunc` may be nullptr for buffers that are never released.
+GVariant *Utils::gvariantFromBuffer(const guint8 *pBytes, size_t count, GDestroyNotify freeFunc, gpointer pUserData)
+{
+	GBytes *pGbytes = g_bytes_new_with_free_func(pBytes, count, freeFunc, pUserData);
+	GVariant *pGVariant = gvariantFromBytes(pGbytes);
+	g_bytes_unref(pGbytes);
+	return pGVariant;
+}
+
 // Returns an array of bytes ("ay") containing a single unsigned 8-bit value
 GVariant *Utils::gvariantFromByteArray(const guint8 data)
 {
@@ -141,7 +141,18 @@ struct Utils
 	static GVariant *gvariantFromByteArray(const guint8 *pBytes, int count);
 
 	// Returns an array of bytes ("ay") with the contents of the input array of unsigned 8-bit values
-	static GVariant *gvariantFromByteArray(const std::vector<guint8> bytes);
+	static GVariant *gvariantFromByteArray(const std::vector<guint8> &bytes);
+
+	// Returns an array of bytes ("ay") that references the contents of `pBytes` without copying them
+	//
+	// The returned variant holds its own reference to `pBytes`, so the caller may release theirs as soon as this returns.
+	static GVariant *gvariantFromBytes(GBytes *pBytes);
+
+	// Returns an array of bytes ("ay") that references a caller-owned buffer without copying it
+	//
+	// The buffer must remain valid and unchanged until `freeFunc` is called with `pUserData`, which happens once the variant (and
+	// anything built from it) has been released. `freeFunc` may be nullptr for buffers that are never released.
+	static GVariant *gvariantFromBuffer(const guint8 *pBytes, size_t count, GDestroyNotify freeFunc, gpointer pUserData);
 
 	// Returns an array of bytes ("ay") containing a single unsigned 8-bit value
 	static GVariant *gvariantFromByteArray(const guint8 data);
@@ -0,0 +1,345 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, work-stealing thread pool for method handlers that are too heavy for the main loop
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Every D-Bus method call is dispatched on the server's main loop. A handler that does real work (parsing a firmware chunk,
+// compressing or encrypting data) holds up every other client while it runs. Characteristics marked with `offloadToPool()` have
+// their ReadValue and WriteValue handlers run on this pool instead, with their replies handed back to the main loop (see
+// DeferredReply.cpp.)
+//
+// Clients expect their writes to a characteristic to be applied in order, so jobs are submitted with a key (the characteristic)
+// and jobs with the same key run one at a time, in the order they were submitted. Each key with work to do has a strand: a queue
+// of its jobs. Only the strand is scheduled on the pool, so a strand is only ever in the hands of one worker. When a worker has
+// run a job from a strand and more are waiting, the strand goes back into that worker's queue, behind any other strands that are
+// waiting, so one busy characteristic can't starve the others.
+//
+// Each worker has its own queue of strands. New strands are handed out to the workers in turn. A worker that runs out of work
+// steals from the back of another worker's queue, so the load evens out without a single shared queue that every worker
+// contends on.
+//
+// The number of jobs waiting to run is bounded (see `configure()`.) When the pool is full, new jobs are refused rather than
+// queued without limit, and the method call is answered with an error.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "WorkerPool.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// The jobs waiting to run for a single key
+//
+// A key has a strand for as long as it has jobs waiting or running, and while it does, the strand is scheduled on exactly one
+// worker.
+struct Strand
+{
+	std::deque<WorkerPool::Job> jobs;
+};
+
+// A worker thread and its queue of scheduled strands (by key)
+struct Worker
+{
+	std::mutex mutex;
+	std::deque<const void *> strandKeys;
+	std::thread thread;
+};
+
+// Configuration
+static int configuredThreadCount = WorkerPool::kDefaultThreadCount;
+static int configuredQueueDepth = WorkerPool::kDefaultQueueDepth;
+
+// Our strands, along with the number of jobs waiting in them
+static std::unordered_map<const void *, Strand> strands;
+static size_t queuedJobs = 0;
+static size_t maxQueuedJobs = 0;
+static std::mutex strandsMutex;
+
+// Our workers
+static std::vector<std::unique_ptr<Worker>> workers;
+static std::atomic<bool> running(false);
+static std::atomic<unsigned int> nextWorker(0);
+
+// Idle workers wait here for strands to be scheduled
+static std::mutex wakeMutex;
+static std::condition_variable wakeCondition;
+static size_t scheduledStrands = 0;
+static bool stopping = false;
+
+// The index of the worker running on this thread, or -1 if this isn't a worker thread
+static thread_local int workerIndex = -1;
+
+// Schedules a strand on a worker
+//
+// Workers reschedule strands on their own queue; anybody else hands them out to the workers in turn.
+static void scheduleStrand(const void *pKey)
+{
+	size_t index = workerIndex >= 0 ? static_cast<size_t>(workerIndex) : nextWorker++ % workers.size();
+
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->strandKeys.push_back(pKey);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		scheduledStrands += 1;
+	}
+
+	wakeCondition.notify_one();
+}
+
+// Takes a scheduled strand, from the front of our own queue or, failing that, the back of another worker's
+//
+// Returns true if a strand was found
+static bool takeStrand(size_t index, const void *&pKey)
+{
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		Worker &worker = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.strandKeys.empty())
+		{
+			continue;
+		}
+
+		if (0 == i)
+		{
+			pKey = worker.strandKeys.front();
+			worker.strandKeys.pop_front();
+		}
+		else
+		{
+			pKey = worker.strandKeys.back();
+			worker.strandKeys.pop_back();
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+// Runs the next job from a strand, then reschedules the strand if it has more
+static void runStrand(const void *pKey)
+{
+	WorkerPool::Job job;
+	{
+		std::lock_guard<std::mutex> lock(strandsMutex);
+		Strand &strand = strands[pKey];
+		job = std::move(strand.jobs.front());
+		strand.jobs.pop_front();
+		queuedJobs -= 1;
+	}
+
+	job();
+
+	bool more = false;
+	{
+		std::lock_guard<std::mutex> lock(strandsMutex);
+		auto iter = strands.find(pKey);
+		if (iter->second.jobs.empty())
+		{
+			strands.erase(iter);
+		}
+		else
+		{
+			more = true;
+		}
+	}
+
+	if (more)
+	{
+		scheduleStrand(pKey);
+	}
+}
+
+// The body of each worker thread
+static void runWorker(int index)
+{
+	workerIndex = index;
+
+	for (;;)
+	{
+		// Wait for a strand, and claim it
+		{
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wakeCondition.wait(lock, [] { return stopping || scheduledStrands > 0; });
+			if (stopping)
+			{
+				break;
+			}
+
+			scheduledStrands -= 1;
+		}
+
+		// We've claimed a strand, so there is one to be had somewhere
+		const void *pKey = nullptr;
+		while (!takeStrand(static_cast<size_t>(index), pKey))
+		{
+			std::this_thread::yield();
+		}
+
+		runStrand(pKey);
+	}
+}
+
+// Sets the number of worker threads and the maximum number of jobs waiting to run
+//
+// This takes effect the next time the pool is started. Returns false if a value is out of range.
+bool WorkerPool::configure(int threadCount, int queueDepth)
+{
+	if (threadCount < 1 || queueDepth < 1)
+	{
+		return false;
+	}
+
+	configuredThreadCount = threadCount;
+	configuredQueueDepth = queueDepth;
+	return true;
+}
+
+// Starts the worker threads
+//
+// Returns true on success (or if the pool is already running), otherwise false
+bool WorkerPool::start()
+{
+	if (running)
+	{
+		return true;
+	}
+
+	maxQueuedJobs = static_cast<size_t>(configuredQueueDepth);
+	stopping = false;
+
+	for (int i = 0; i < configuredThreadCount; ++i)
+	{
+		workers.push_back(std::unique_ptr<Worker>(new Worker));
+	}
+
+	try
+	{
+		for (int i = 0; i < configuredThreadCount; ++i)
+		{
+			workers[i]->thread = std::thread(runWorker, i);
+		}
+	}
+	catch(std::system_error &ex)
+	{
+		Logger::error(SSTR << "Worker pool was unable to start a thread (code " << ex.code() << "): " << ex.what());
+		running = true;
+		stop();
+		return false;
+	}
+
+	running = true;
+	Logger::debug(SSTR << "Started worker pool with " << configuredThreadCount << " thread(s) and a queue depth of " << configuredQueueDepth);
+	return true;
+}
+
+// Stops the worker threads, waiting for any running jobs to finish
+//
+// Jobs that have not yet started are discarded.
+void WorkerPool::stop()
+{
+	if (!running.exchange(false))
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+
+	wakeCondition.notify_all();
+
+	for (std::unique_ptr<Worker> &pWorker : workers)
+	{
+		if (pWorker->thread.joinable())
+		{
+			pWorker->thread.join();
+		}
+	}
+
+	workers.clear();
+	scheduledStrands = 0;
+
+	// Discard whatever was left; this releases anything the jobs were holding on to
+	std::unordered_map<const void *, Strand> discarded;
+	{
+		std::lock_guard<std::mutex> lock(strandsMutex);
+		discarded.swap(strands);
+		queuedJobs = 0;
+	}
+}
+
+// Returns true if the pool is running
+bool WorkerPool::isRunning()
+{
+	return running;
+}
+
+// Returns true if called from one of the pool's worker threads
+bool WorkerPool::isWorkerThread()
+{
+	return workerIndex >= 0;
+}
+
+// Submits a job to the pool
+//
+// Jobs submitted with the same key run one at a time, in the order they were submitted. Jobs with different keys may run in
+// parallel.
+//
+// Returns false if the pool is not running or its queue is full, in which case the job is discarded.
+bool WorkerPool::submit(const void *pKey, const Job &job)
+{
+	if (!running)
+	{
+		return false;
+	}
+
+	bool newStrand = false;
+	{
+		std::lock_guard<std::mutex> lock(strandsMutex);
+		if (queuedJobs >= maxQueuedJobs)
+		{
+			return false;
+		}
+
+		newStrand = strands.find(pKey) == strands.end();
+		strands[pKey].jobs.push_back(job);
+		queuedJobs += 1;
+	}
+
+	if (newStrand)
+	{
+		scheduleStrand(pKey);
+	}
+
+	return true;
+}
+
+}; // namespace ggk
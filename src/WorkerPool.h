@@ -0,0 +1,70 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, work-stealing thread pool for method handlers that are too heavy for the main loop
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of WorkerPool.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <functional>
+
+namespace ggk {
+
+struct WorkerPool
+{
+	// A unit of work
+	typedef std::function<void()> Job;
+
+	// The default number of worker threads
+	static const int kDefaultThreadCount = 2;
+
+	// The default maximum number of jobs waiting to run
+	static const int kDefaultQueueDepth = 64;
+
+	// Sets the number of worker threads and the maximum number of jobs waiting to run
+	//
+	// This takes effect the next time the pool is started. Returns false if a value is out of range.
+	static bool configure(int threadCount, int queueDepth);
+
+	// Starts the worker threads
+	//
+	// Returns true on success (or if the pool is already running), otherwise false
+	static bool start();
+
+	// Stops the worker threads, waiting for any running jobs to finish
+	//
+	// Jobs that have not yet started are discarded.
+	static void stop();
+
+	// Returns true if the pool is running
+	static bool isRunning();
+
+	// Returns true if called from one of the pool's worker threads
+	static bool isWorkerThread();
+
+	// Submits a job to the pool
+	//
+	// Jobs submitted with the same key run one at a time, in the order they were submitted. Jobs with different keys may run in
+	// parallel.
+	//
+	// Returns false if the pool is not running or its queue is full, in which case the job is discarded.
+	static bool submit(const void *pKey, const Job &job);
+};
+
+}; // namespace ggk
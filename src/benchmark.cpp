@@ -0,0 +1,985 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Microbenchmarks for the server's hot paths
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// This program times the parts of the server that run often enough for their cost to matter, using the same code the server
+// runs. It doesn't need a Bluetooth adapter, BlueZ or a D-Bus connection, so it can run anywhere the library builds.
+//
+// Run it with no arguments to run every benchmark, or name the ones to run:
+//
+//     ./benchmark uuid
+//
+// Where it helps to put a number in context, a benchmark also times a baseline: a simple version of the work done the way the
+// server used to do it (or the way an application would do it without the server's help.) The baselines live here and not in
+// the server.
+//
+// Results are in nanoseconds per operation unless stated otherwise. They are only meaningful relative to each other on the same
+// machine, so compare runs before and after a change rather than against numbers from elsewhere.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+
+#include "../include/Gobbledegook.h"
+#include "DataStore.h"
+#include "DBusObject.h"
+#include "DBusIndex.h"
+#include "GattService.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+#include "GattUuid.h"
+#include "Server.h"
+#include "ServerUtils.h"
+#include "UpdateQueue.h"
+#include "Utils.h"
+
+using namespace ggk;
+
+//
+// Server internals
+//
+
+namespace ggk {
+	// See Gobbledegook.cpp
+	extern void setServerRunState(enum GGKServerRunState newState);
+
+	// See Init.cpp
+	int processUpdateQueue(void *pUserData);
+	bool createUpdateQueueSource();
+	void destroyUpdateQueueSource();
+};
+
+//
+// Timing
+//
+
+// Keeps the compiler from optimizing away the work being timed
+static volatile uint64_t sink = 0;
+
+// Returns the average time (in nanoseconds) of `iterations` calls to `op`
+template<typename Op>
+static double nsPerOp(int iterations, Op op)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i)
+	{
+		op(i);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// Returns the current time on the steady clock, in nanoseconds
+static int64_t steadyNS()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the CPU time (user and system) used by this process so far, in microseconds
+static int64_t cpuMicroseconds()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// Prints a single result
+static void report(const char *pName, double baselineNS, double serverNS)
+{
+	if (baselineNS < 0)
+	{
+		printf("  %-40s %12s %12.1f\n", pName, "-", serverNS);
+	}
+	else
+	{
+		printf("  %-40s %12.1f %12.1f\n", pName, baselineNS, serverNS);
+	}
+}
+
+// Prints the heading for a group of results
+static void heading(const char *pTitle)
+{
+	printf("\n%s\n  %-40s %12s %12s\n", pTitle, "", "baseline", "server");
+}
+
+//
+// GattUuid
+//
+
+// Baseline: a UUID kept as a string, cleaned and formatted the way GattUuid used to on construction
+static std::string stringUuid(const std::string &str)
+{
+	std::string clean;
+	for (char c : str)
+	{
+		if (isxdigit(static_cast<unsigned char>(c))) { clean += static_cast<char>(tolower(c)); }
+	}
+
+	if (clean.length() == 4) { clean = "0000" + clean; }
+	if (clean.length() == 8) { clean += "00001000800000805f9b34fb"; }
+	if (clean.length() != 32) { return std::string(); }
+
+	clean.insert(8, 1, '-');
+	clean.insert(13, 1, '-');
+	clean.insert(18, 1, '-');
+	clean.insert(23, 1, '-');
+	return clean;
+}
+
+static void benchmarkUuid()
+{
+	const int kIterations = 2000000;
+
+	// A mix of short and long forms (a power of two of them, so picking one is cheap)
+	const std::vector<std::string> inputs =
+	{
+		"180A", "2A19", "2A2B", "00000001-1E3C-FAD4-74E2-97A033F1BFAA", "0000B002-1E3D-FAD4-74E2-97A033F1BFEE", "2901",
+		"0000B003-1E3D-FAD4-74E2-97A033F1BFEE", "00000002-1E3C-FAD4-74E2-97A033F1BFAA"
+	};
+	const int kMask = 7;
+
+	std::vector<std::string> strings;
+	std::vector<GattUuid> uuids;
+	for (const std::string &input : inputs)
+	{
+		strings.push_back(stringUuid(input));
+		uuids.push_back(GattUuid(input));
+	}
+
+	std::unordered_map<std::string, int> stringMap;
+	std::unordered_map<GattUuid, int> uuidMap;
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		stringMap[strings[i]] = static_cast<int>(i);
+		uuidMap[uuids[i]] = static_cast<int>(i);
+	}
+
+	heading("GattUuid");
+
+	report("construct from string",
+		nsPerOp(kIterations, [&](int i) { sink += stringUuid(inputs[i & kMask]).length(); }),
+		nsPerOp(kIterations, [&](int i) { sink += GattUuid(inputs[i & kMask]).getHigh(); }));
+
+	report("128-bit string (construct + render)",
+		nsPerOp(kIterations, [&](int i) { sink += stringUuid(inputs[i & kMask]).length(); }),
+		nsPerOp(kIterations, [&](int i) { sink += GattUuid(inputs[i & kMask]).toString128().length(); }));
+
+	report("128-bit string (already rendered)",
+		nsPerOp(kIterations, [&](int i) { sink += std::string(strings[i & kMask]).length(); }),
+		nsPerOp(kIterations, [&](int i) { sink += uuids[i & kMask].toString128().length(); }));
+
+	report("16-bit string",
+		nsPerOp(kIterations, [&](int i) { sink += strings[i & kMask].substr(4, 4).length(); }),
+		nsPerOp(kIterations, [&](int i) { sink += uuids[i & kMask].toString16().length(); }));
+
+	report("compare",
+		nsPerOp(kIterations, [&](int i) { sink += strings[i & kMask] == strings[(i + 1) & kMask]; }),
+		nsPerOp(kIterations, [&](int i) { sink += uuids[i & kMask] == uuids[(i + 1) & kMask]; }));
+
+	report("unordered_map lookup",
+		nsPerOp(kIterations, [&](int i) { sink += stringMap.find(strings[i & kMask])->second; }),
+		nsPerOp(kIterations, [&](int i) { sink += uuidMap.find(uuids[i & kMask])->second; }));
+}
+
+//
+// Synthetic object hierarchies
+//
+
+// Builds a hierarchy of `characteristicCount` characteristics, ten to a service, under "/com/bench"
+//
+// Each characteristic can be read, written and notified and has a user description, like a typical application's. The path of
+// every characteristic is added to `characteristicPaths`.
+static void buildTree(std::list<DBusObject> &objects, int characteristicCount, std::vector<std::string> &characteristicPaths)
+{
+	objects.push_back(DBusObject(DBusObjectPath() + "com" + "bench"));
+	DBusObject &root = objects.back();
+
+	for (int serviceIndex = 0; serviceIndex * 10 < characteristicCount; ++serviceIndex)
+	{
+		std::string serviceName = "service" + std::to_string(serviceIndex);
+		GattService &service = root.gattServiceBegin(serviceName, GattUuid(static_cast<uint16_t>(0x1800 + serviceIndex)));
+
+		for (int i = serviceIndex * 10; i < characteristicCount && i < serviceIndex * 10 + 10; ++i)
+		{
+			std::string characteristicName = "characteristic" + std::to_string(i);
+			service.gattCharacteristicBegin(characteristicName, GattUuid(static_cast<uint16_t>(0x2A00 + i % 256)), {"read", "write", "notify"})
+				.gattDescriptorBegin("description", "2901", {"read"})
+				.gattDescriptorEnd()
+			.gattCharacteristicEnd();
+
+			characteristicPaths.push_back("/com/bench/" + serviceName + "/" + characteristicName);
+		}
+
+		service.gattServiceEnd();
+	}
+}
+
+//
+// Data store
+//
+
+// Baseline: an application's data getter, as standalone.cpp had before the data store, which compares the name it's given
+// against each of its values in turn. The last name is a string, the rest are battery-level-style bytes.
+static const char *kDataNames[] =
+{
+	"battery/level", "sensor/temperature", "sensor/humidity", "sensor/pressure", "sensor/light", "device/state", "device/mode",
+	"device/errors", "text/string"
+};
+static const int kDataByteCount = 8;
+static uint8_t getterBytes[kDataByteCount];
+static std::string getterText = "Hello, world!";
+static std::mutex getterMutex;
+
+static const void *stringDataGetter(const char *pName)
+{
+	std::string strName = pName;
+
+	for (int i = 0; i < kDataByteCount; ++i)
+	{
+		if (strName == kDataNames[i])
+		{
+			return &getterBytes[i];
+		}
+	}
+
+	if (strName == kDataNames[kDataByteCount])
+	{
+		return getterText.c_str();
+	}
+
+	return nullptr;
+}
+
+// Returns the average time (in nanoseconds) per read for `readerCount` threads to call `read` `totalReads` times between them,
+// while another thread calls `write` every 100us (a 10kHz producer)
+template<typename Read, typename Write>
+static double nsPerRead(int readerCount, int totalReads, Read read, Write write)
+{
+	std::atomic<bool> go(false);
+	std::atomic<int> running(readerCount);
+
+	std::thread writer([&]()
+	{
+		for (int i = 0; running > 0; ++i)
+		{
+			write(i);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+
+	std::vector<std::thread> readers;
+	for (int t = 0; t < readerCount; ++t)
+	{
+		readers.push_back(std::thread([&]()
+		{
+			while (!go) { std::this_thread::yield(); }
+
+			for (int i = 0; i < totalReads / readerCount; ++i)
+			{
+				read(i);
+			}
+
+			running -= 1;
+		}));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	go = true;
+	for (std::thread &reader : readers)
+	{
+		reader.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	writer.join();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / totalReads;
+}
+
+static void benchmarkDataStore()
+{
+	const int kIterations = 2000000;
+	const int kMask = kDataByteCount - 1;
+
+	DataStore::Key byteKeys[kDataByteCount];
+	for (int i = 0; i < kDataByteCount; ++i)
+	{
+		byteKeys[i] = DataStore::intern(kDataNames[i]);
+		DataStore::setValue<uint8_t>(byteKeys[i], 0);
+	}
+	DataStore::Key textKey = DataStore::intern(kDataNames[kDataByteCount]);
+	DataStore::setString(textKey, getterText.c_str());
+
+	std::string text;
+
+	heading("Data store reads");
+
+	report("byte",
+		nsPerOp(kIterations, [&](int i) { sink += *static_cast<const uint8_t *>(stringDataGetter(kDataNames[i & kMask])); }),
+		nsPerOp(kIterations, [&](int i) { sink += DataStore::getValue<uint8_t>(byteKeys[i & kMask], 0); }));
+
+	report("string",
+		nsPerOp(kIterations, [&](int) { text = static_cast<const char *>(stringDataGetter(kDataNames[kDataByteCount])); sink += text.length(); }),
+		nsPerOp(kIterations, [&](int) { DataStore::getString(textKey, text); sink += text.length(); }));
+
+	// With another thread writing, the getter's data needs a lock (the store's readers never wait for one)
+	for (int readerCount = 1; readerCount <= 4; readerCount *= 2)
+	{
+		std::string readers = std::to_string(readerCount) + (readerCount == 1 ? " reader" : " readers") + " + writer, ";
+
+		report((readers + "byte").c_str(),
+			nsPerRead(readerCount, kIterations,
+				[&](int i)
+				{
+					std::lock_guard<std::mutex> lock(getterMutex);
+					sink += *static_cast<const uint8_t *>(stringDataGetter(kDataNames[i & kMask]));
+				},
+				[&](int i)
+				{
+					std::lock_guard<std::mutex> lock(getterMutex);
+					getterBytes[i & kMask] = static_cast<uint8_t>(i);
+				}),
+			nsPerRead(readerCount, kIterations,
+				[&](int i) { sink += DataStore::getValue<uint8_t>(byteKeys[i & kMask], 0); },
+				[&](int i) { DataStore::setValue<uint8_t>(byteKeys[i & kMask], static_cast<uint8_t>(i)); }));
+
+		report((readers + "string").c_str(),
+			nsPerRead(readerCount, kIterations,
+				[&](int)
+				{
+					std::string value;
+					{
+						std::lock_guard<std::mutex> lock(getterMutex);
+						value = static_cast<const char *>(stringDataGetter(kDataNames[kDataByteCount]));
+					}
+					sink += value.length();
+				},
+				[&](int i)
+				{
+					std::lock_guard<std::mutex> lock(getterMutex);
+					getterText = (i & 1) ? "Hello, world!" : "Goodbye, world!";
+				}),
+			nsPerRead(readerCount, kIterations,
+				[&](int)
+				{
+					std::string value;
+					DataStore::getString(textKey, value);
+					sink += value.length();
+				},
+				[&](int i) { DataStore::setString(textKey, (i & 1) ? "Hello, world!" : "Goodbye, world!"); }));
+	}
+}
+
+//
+// Update queue wake-up
+//
+
+// When the most recent update was delivered to its characteristic (see `steadyNS()`)
+static std::atomic<int64_t> updateDeliveredNS(0);
+
+// Baseline: the idle function the server thread used to run, which slept for 10ms whenever the queue had nothing for it
+static gboolean sleepingIdle(gpointer pUserData)
+{
+	if (0 == processUpdateQueue(pUserData))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	return TRUE;
+}
+
+// Our characteristic's update handler, which notes when it was called
+static bool noteDelivery(const GattCharacteristic &, GDBusConnection *, void *)
+{
+	updateDeliveredNS = steadyNS();
+	return true;
+}
+
+// The results of a run of `measureWake()`, in microseconds and percent of a core
+struct WakeResult
+{
+	double meanLatencyUS;
+	double maxLatencyUS;
+	double idleCpuPercent;
+};
+
+// Runs the main loop while another thread pushes updates to the characteristic at `pObjectPath` and measures how long each one
+// takes to be delivered. Then lets the main loop sit idle for a second and measures the CPU time it used.
+//
+// Updates are pushed one at a time (the next one isn't pushed until the last was delivered), after a pause of up to 10ms, so
+// they arrive at different points in the baseline's sleep.
+static WakeResult measureWake(GMainLoop *pLoop, const char *pObjectPath, int samples)
+{
+	WakeResult result = { 0.0, 0.0, 0.0 };
+
+	std::thread producer([&]()
+	{
+		for (int i = 0; i < samples; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds((i * 7919) % 10000));
+
+			updateDeliveredNS = 0;
+			int64_t pushNS = steadyNS();
+			ggkNofifyUpdatedCharacteristic(pObjectPath);
+			while (0 == updateDeliveredNS && steadyNS() - pushNS < 1000000000LL)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(20));
+			}
+
+			double latencyUS = (updateDeliveredNS - pushNS) / 1000.0;
+			result.meanLatencyUS += latencyUS / samples;
+			if (latencyUS > result.maxLatencyUS) { result.maxLatencyUS = latencyUS; }
+		}
+
+		g_main_loop_quit(pLoop);
+	});
+
+	g_main_loop_run(pLoop);
+	producer.join();
+
+	g_timeout_add(1000, [](gpointer pUserData) -> gboolean
+	{
+		g_main_loop_quit(static_cast<GMainLoop *>(pUserData));
+		return FALSE;
+	}, pLoop);
+
+	int64_t startNS = steadyNS();
+	int64_t startCpuUS = cpuMicroseconds();
+	g_main_loop_run(pLoop);
+	result.idleCpuPercent = 100.0 * (cpuMicroseconds() - startCpuUS) * 1000.0 / (steadyNS() - startNS);
+
+	return result;
+}
+
+static void benchmarkWake()
+{
+	const int kSamples = 200;
+
+	// A single characteristic that notes when its update arrives
+	std::list<DBusObject> objects;
+	objects.push_back(DBusObject(DBusObjectPath() + "com" + "bench"));
+	objects.back()
+		.gattServiceBegin("service", "180F")
+			.gattCharacteristicBegin("update", "2A19", {"read"})
+				.onUpdatedValue(noteDelivery)
+			.gattCharacteristicEnd()
+		.gattServiceEnd();
+
+	// Resolve its update queue ID, as the server does when it starts
+	const char *pObjectPath = "/com/bench/service/update";
+	const char *pInterfaceName = "org.bluez.GattCharacteristic1";
+	DBusIndex index;
+	index.build(objects);
+	UpdateQueue::setTarget(UpdateQueue::intern(pObjectPath, pInterfaceName), index.findInterface(pObjectPath, pInterfaceName).get());
+
+	setServerRunState(ERunning);
+	GMainLoop *pLoop = g_main_loop_new(nullptr, FALSE);
+
+	guint idleId = g_idle_add(sleepingIdle, nullptr);
+	WakeResult baseline = measureWake(pLoop, pObjectPath, kSamples);
+	g_source_remove(idleId);
+
+	createUpdateQueueSource();
+	WakeResult server = measureWake(pLoop, pObjectPath, kSamples);
+	destroyUpdateQueueSource();
+
+	g_main_loop_unref(pLoop);
+	setServerRunState(EStopped);
+
+	heading("Update queue wake-up");
+	report("push to delivery, mean (us)", baseline.meanLatencyUS, server.meanLatencyUS);
+	report("push to delivery, max (us)", baseline.maxLatencyUS, server.maxLatencyUS);
+	report("idle CPU (% of a core)", baseline.idleCpuPercent, server.idleCpuPercent);
+}
+
+//
+// Update queue producers
+//
+
+// Baseline: the update queue as it used to be, a deque of heap-allocated string pairs behind a mutex
+struct LockedQueue
+{
+	struct Entry
+	{
+		Entry(const char *pObjectPath, const char *pInterfaceName)
+		: objectPath(pObjectPath), interfaceName(pInterfaceName), pushTime(std::chrono::steady_clock::now())
+		{
+		}
+
+		std::string objectPath;
+		std::string interfaceName;
+		std::chrono::steady_clock::time_point pushTime;
+	};
+
+	void push(const char *pObjectPath, const char *pInterfaceName)
+	{
+		Entry entry(pObjectPath, pInterfaceName);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		entries.push_front(std::move(entry));
+	}
+
+	bool pop()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		if (entries.empty()) { return false; }
+		sink += entries.back().objectPath.length();
+		entries.pop_back();
+		return true;
+	}
+
+	std::mutex mutex;
+	std::deque<Entry> entries;
+};
+
+// Returns the average time (in nanoseconds) per update for `producerCount` threads to push `totalPushes` updates between them,
+// while a single consumer thread drains the queue
+//
+// `push(path)` pushes one update and returns false if the queue was full (in which case it is retried). `pop()` removes one or
+// more updates and returns the number removed.
+template<typename Push, typename Pop>
+static double nsPerPush(int producerCount, int totalPushes, const std::vector<std::string> &paths, Push push, Pop pop)
+{
+	std::atomic<bool> go(false);
+	std::atomic<int> remaining(totalPushes);
+
+	std::thread consumer([&]()
+	{
+		while (remaining > 0)
+		{
+			int popped = pop();
+			if (0 == popped) { std::this_thread::yield(); }
+			remaining -= popped;
+		}
+	});
+
+	std::vector<std::thread> producers;
+	for (int t = 0; t < producerCount; ++t)
+	{
+		producers.push_back(std::thread([&, t]()
+		{
+			while (!go) { std::this_thread::yield(); }
+
+			const char *pObjectPath = paths[t].c_str();
+			for (int i = 0; i < totalPushes / producerCount; ++i)
+			{
+				while (!push(pObjectPath)) { std::this_thread::yield(); }
+			}
+		}));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	go = true;
+	for (std::thread &producer : producers)
+	{
+		producer.join();
+	}
+	consumer.join();
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / totalPushes;
+}
+
+static void benchmarkQueue()
+{
+	const int kTotalPushes = 960000;
+	const char *pInterfaceName = "org.bluez.GattCharacteristic1";
+
+	// Each producer updates its own characteristic, interned up front as the server does for its description
+	std::vector<std::string> paths;
+	for (int t = 0; t < 16; ++t)
+	{
+		paths.push_back("/com/bench/service/characteristic" + std::to_string(t));
+		UpdateQueue::intern(paths.back().c_str(), pInterfaceName);
+	}
+
+	LockedQueue lockedQueue;
+	UpdateQueue::Batch batch;
+	UpdateQueue::clear();
+	UpdateQueue::resetStats();
+
+	auto lockedPush = [&](const char *pObjectPath) { lockedQueue.push(pObjectPath, pInterfaceName); return true; };
+	auto lockedPop = [&]() { return lockedQueue.pop() ? 1 : 0; };
+	auto serverPush = [&](const char *pObjectPath) { return ggkPushUpdateQueue(pObjectPath, pInterfaceName) != 0; };
+	auto serverPop = [&]() { return static_cast<int>(UpdateQueue::takeBatch(batch)); };
+
+	heading("Update queue producers (per update)");
+
+	for (int producerCount = 1; producerCount <= 16; producerCount *= 2)
+	{
+		std::string name = std::to_string(producerCount) + (producerCount == 1 ? " producer" : " producers");
+		report(name.c_str(),
+			nsPerPush(producerCount, kTotalPushes, paths, lockedPush, lockedPop),
+			nsPerPush(producerCount, kTotalPushes, paths, serverPush, serverPop));
+	}
+
+	GGKUpdateQueueStats stats;
+	UpdateQueue::getStats(stats);
+	printf("  (server: %llu updates taken in %llu batches, %llu pushes found the queue full and were retried)\n", stats.entryCount, stats.batchCount, stats.droppedCount);
+}
+
+//
+// D-Bus dispatch lookups
+//
+
+// Baseline: the recursive walk the server used to find an interface, building the path of every object it visits
+static std::shared_ptr<const DBusInterface> walkFindInterface(const DBusObject &object, const DBusObjectPath &path, const std::string &interfaceName, const DBusObjectPath &basePath = DBusObjectPath())
+{
+	if ((basePath + object.getPathNode()) == path)
+	{
+		for (std::shared_ptr<const DBusInterface> interface : object.getInterfaces())
+		{
+			if (interfaceName == interface->getName())
+			{
+				return interface;
+			}
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		std::shared_ptr<const DBusInterface> pInterface = walkFindInterface(child, path, interfaceName, basePath + object.getPathNode());
+		if (nullptr != pInterface)
+		{
+			return pInterface;
+		}
+	}
+
+	return nullptr;
+}
+
+static void benchmarkDispatch()
+{
+	const char *pInterfaceName = "org.bluez.GattCharacteristic1";
+	const int kMask = 63;
+
+	heading("D-Bus dispatch lookups (per call)");
+
+	for (int characteristicCount : {10, 100, 1000, 5000})
+	{
+		std::list<DBusObject> objects;
+		std::vector<std::string> allPaths;
+		buildTree(objects, characteristicCount, allPaths);
+
+		DBusIndex index;
+		index.build(objects);
+
+		// Look up characteristics from all over the tree
+		std::vector<std::string> paths;
+		for (int i = 0; i <= kMask; ++i)
+		{
+			paths.push_back(allPaths[i * allPaths.size() / (kMask + 1)]);
+		}
+
+		// The walk's cost grows with the tree, so it gets fewer iterations
+		int walkIterations = 2000000 / (characteristicCount + 10);
+		int indexIterations = 2000000;
+
+		std::string name = "find interface, " + std::to_string(characteristicCount) + " characteristics";
+		report(name.c_str(),
+			nsPerOp(walkIterations, [&](int i)
+			{
+				sink += nullptr != walkFindInterface(objects.front(), DBusObjectPath(paths[i & kMask].c_str()), pInterfaceName);
+			}),
+			nsPerOp(indexIterations, [&](int i)
+			{
+				sink += nullptr != index.findInterface(paths[i & kMask].c_str(), pInterfaceName);
+			}));
+
+		name = "find property, " + std::to_string(characteristicCount) + " characteristics";
+		report(name.c_str(),
+			nsPerOp(walkIterations, [&](int i)
+			{
+				std::shared_ptr<const DBusInterface> pInterface = walkFindInterface(objects.front(), DBusObjectPath(paths[i & kMask].c_str()), pInterfaceName);
+				sink += nullptr != Server::findProperty(pInterface, "UUID");
+			}),
+			nsPerOp(indexIterations, [&](int i)
+			{
+				sink += nullptr != index.findProperty(paths[i & kMask].c_str(), pInterfaceName, "UUID");
+			}));
+	}
+}
+
+//
+// GetManagedObjects
+//
+
+// Serializes a message carrying `pParams`, as GDBus does before sending it
+static void serializeMessage(GVariant *pParams)
+{
+	GDBusMessage *pMessage = g_dbus_message_new();
+	g_dbus_message_set_message_type(pMessage, G_DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	g_dbus_message_set_reply_serial(pMessage, 1);
+	g_dbus_message_set_serial(pMessage, 2);
+	g_dbus_message_set_body(pMessage, pParams);
+
+	gsize size = 0;
+	guchar *pBlob = g_dbus_message_to_blob(pMessage, &size, G_DBUS_CAPABILITY_FLAGS_NONE, nullptr);
+	sink += size;
+	g_free(pBlob);
+	g_object_unref(pMessage);
+}
+
+static void benchmarkManagedObjects()
+{
+	// The cached reply is for the server's own hierarchy, so we need one
+	TheServer = std::make_shared<Server>("gobbledegook", "", "", nullptr, nullptr);
+	ServerUtils::invalidateManagedObjects();
+
+	heading("GetManagedObjects");
+
+	for (int characteristicCount : {10, 100, 1000, 5000})
+	{
+		std::list<DBusObject> objects;
+		std::vector<std::string> paths;
+		buildTree(objects, characteristicCount, paths);
+
+		int iterations = characteristicCount < 1000 ? 1000 : 20;
+		GVariant *pCached = ServerUtils::buildManagedObjects(objects);
+
+		// Baseline: the reply is rebuilt for every call. The server hands out a reference to its cached reply, which costs the same
+		// whatever the size of the hierarchy.
+		std::string name = std::to_string(characteristicCount) + " characteristics, reply";
+		report(name.c_str(),
+			nsPerOp(iterations, [&](int)
+			{
+				GVariant *pParams = ServerUtils::buildManagedObjects(objects);
+				g_variant_unref(pParams);
+			}),
+			nsPerOp(1000000, [&](int)
+			{
+				GVariant *pParams = ServerUtils::getManagedObjectsReply();
+				sink += g_variant_is_floating(pParams);
+				g_variant_unref(pParams);
+			}));
+
+		// Either way, GDBus serializes the reply each time it's sent
+		name = std::to_string(characteristicCount) + " characteristics, reply + serialize";
+		report(name.c_str(),
+			nsPerOp(iterations, [&](int)
+			{
+				GVariant *pParams = ServerUtils::buildManagedObjects(objects);
+				serializeMessage(pParams);
+				g_variant_unref(pParams);
+			}),
+			nsPerOp(iterations, [&](int)
+			{
+				GVariant *pParams = g_variant_ref(pCached);
+				serializeMessage(pParams);
+				g_variant_unref(pParams);
+			}));
+
+		g_variant_unref(pCached);
+	}
+
+	ServerUtils::invalidateManagedObjects();
+	TheServer = nullptr;
+}
+
+//
+// Binary values
+//
+
+// Baseline: the vector overload of `Utils::gvariantFromByteArray()` as it used to be, taking its argument by value
+static GVariant *gvariantFromByteVector(const std::vector<guint8> bytes)
+{
+	GBytes *pGbytes = g_bytes_new(bytes.data(), bytes.size());
+	GVariant *pGVariant = g_variant_new_from_bytes(G_VARIANT_TYPE_BYTESTRING, pGbytes, bytes.size());
+	g_bytes_unref(pGbytes);
+	return pGVariant;
+}
+
+// Wraps a value in the body of a `PropertiesChanged` signal and serializes it, as a notification does (see
+// `GattCharacteristic::emitChangeNotification()`)
+static void serializeNotification(GVariant *pValue)
+{
+	GVariantBuilder builder;
+	g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
+	g_variant_builder_add(&builder, "{sv}", "Value", pValue);
+	GVariant *pSasv = g_variant_ref_sink(g_variant_new("(sa{sv})", "org.bluez.GattCharacteristic1", &builder));
+	serializeMessage(pSasv);
+	g_variant_unref(pSasv);
+}
+
+static void benchmarkBytes()
+{
+	const int kIterations = 1000000;
+	const size_t kFrameSize = 244;
+
+	// A sensor frame, as an application might hold it: in a vector, or in a GBytes it shares with the server
+	std::vector<guint8> frame(kFrameSize);
+	for (size_t i = 0; i < kFrameSize; ++i) { frame[i] = static_cast<guint8>(i); }
+	GBytes *pFrame = g_bytes_new(frame.data(), frame.size());
+
+	heading("Binary values (244-byte frame)");
+
+	report("value from vector (copied)",
+		nsPerOp(kIterations, [&](int) { g_variant_unref(g_variant_ref_sink(gvariantFromByteVector(frame))); }),
+		nsPerOp(kIterations, [&](int) { g_variant_unref(g_variant_ref_sink(Utils::gvariantFromByteArray(frame))); }));
+
+	report("value from shared GBytes",
+		-1.0,
+		nsPerOp(kIterations, [&](int) { g_variant_unref(g_variant_ref_sink(Utils::gvariantFromBytes(pFrame))); }));
+
+	report("notification (value + serialize)",
+		nsPerOp(kIterations, [&](int)
+		{
+			GVariant *pValue = g_variant_ref_sink(gvariantFromByteVector(frame));
+			serializeNotification(pValue);
+			g_variant_unref(pValue);
+		}),
+		nsPerOp(kIterations, [&](int)
+		{
+			GVariant *pValue = g_variant_ref_sink(Utils::gvariantFromBytes(pFrame));
+			serializeNotification(pValue);
+			g_variant_unref(pValue);
+		}));
+
+	g_bytes_unref(pFrame);
+}
+
+//
+// Object registration
+//
+
+// Builds the introspection data for every interface of an object and its children, the way the server does when registering
+// them with D-Bus
+static void buildInterfaceInfo(const DBusObject &object)
+{
+	for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+	{
+		GDBusInterfaceInfo *pInterfaceInfo = pInterface->generateInterfaceInfo();
+		sink += nullptr != pInterfaceInfo->methods;
+		g_dbus_interface_info_unref(pInterfaceInfo);
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		buildInterfaceInfo(child);
+	}
+}
+
+static void benchmarkRegistration()
+{
+	// The XML names our server, so we need one
+	TheServer = std::make_shared<Server>("gobbledegook", "", "", nullptr, nullptr);
+
+	heading("Object registration (microseconds per pass)");
+
+	for (int characteristicCount : {10, 100, 1000, 5000})
+	{
+		std::list<DBusObject> objects;
+		std::vector<std::string> paths;
+		buildTree(objects, characteristicCount, paths);
+
+		int iterations = characteristicCount < 1000 ? 200 : 10;
+
+		// Baseline: generate the XML for the whole hierarchy and parse it back into introspection data
+		double xmlNS = nsPerOp(iterations, [&](int)
+		{
+			GError *pError = nullptr;
+			std::string xml = objects.front().generateIntrospectionXML();
+			GDBusNodeInfo *pNode = g_dbus_node_info_new_for_xml(xml.c_str(), &pError);
+			sink += nullptr != pNode;
+			if (nullptr != pNode) { g_dbus_node_info_unref(pNode); }
+			g_clear_error(&pError);
+		});
+
+		double directNS = nsPerOp(iterations, [&](int)
+		{
+			buildInterfaceInfo(objects.front());
+		});
+
+		std::string name = std::to_string(characteristicCount) + " characteristics";
+		report(name.c_str(), xmlNS / 1000.0, directNS / 1000.0);
+	}
+
+	TheServer = nullptr;
+}
+
+//
+// Entry point
+//
+
+struct Benchmark
+{
+	const char *pName;
+	void (*run)();
+};
+
+static const Benchmark kBenchmarks[] =
+{
+	{ "uuid", benchmarkUuid },
+	{ "datastore", benchmarkDataStore },
+	{ "wake", benchmarkWake },
+	{ "queue", benchmarkQueue },
+	{ "dispatch", benchmarkDispatch },
+	{ "managed", benchmarkManagedObjects },
+	{ "bytes", benchmarkBytes },
+	{ "registration", benchmarkRegistration },
+};
+
+int main(int argc, char **ppArgv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		bool known = false;
+		for (const Benchmark &benchmark : kBenchmarks)
+		{
+			known = known || strcmp(ppArgv[i], benchmark.pName) == 0;
+		}
+
+		if (!known)
+		{
+			fprintf(stderr, "Unknown benchmark: '%s'\n\nUsage: benchmark [name...]\n\nBenchmarks:", ppArgv[i]);
+			for (const Benchmark &benchmark : kBenchmarks)
+			{
+				fprintf(stderr, " %s", benchmark.pName);
+			}
+			fprintf(stderr, "\n");
+			return -1;
+		}
+	}
+
+	for (const Benchmark &benchmark : kBenchmarks)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; ++i)
+		{
+			selected = selected || strcmp(ppArgv[i], benchmark.pName) == 0;
+		}
+
+		if (selected)
+		{
+			benchmark.run();
+		}
+	}
+
+	return 0;
+}
@@ -31,10 +31,17 @@
 //         example, "battery/level") and returns a void pointer to that data (for example: `(void *)&batteryLevel`). The setter does
 //         the same only in reverse.
 //
-//         While the server is running, you will likely need to update the data being served. This is done by calling
-//         `ggkNofifyUpdatedCharacteristic()` or `ggkNofifyUpdatedDescriptor()` with the full path to the characteristic or delegate
-//         whose data has been updated. This will trigger your server's `onUpdatedValue()` method, which can perform whatever
-//         actions are needed such as sending out a change notification (or in BlueZ parlance, a "PropertiesChanged" signal.)
+//         This example passes `nullptr` for both instead, and keeps its data in the server's built-in data store. It looks up a
+//         key for each name once with `ggkDataStoreIntern()`, then stores values with `ggkDataStoreSetValue()` (for fixed-size
+//         values such as the battery level) or `ggkDataStoreSetString()`. Reads from the store are considerably cheaper than a
+//         getter that matches names as strings.
+//
+//         While the server is running, you will likely need to update the data being served. Characteristics that are bound to
+//         their data (see `bindData()` in Server.cpp) notify their subscribers whenever it is changed in the store. For anything
+//         else, call `ggkNofifyUpdatedCharacteristic()` or `ggkNofifyUpdatedDescriptor()` with the full path to the
+//         characteristic or delegate whose data has been updated. This will trigger your server's `onUpdatedValue()` method,
+//         which can perform whatever actions are needed such as sending out a change notification (or in BlueZ parlance, a
+//         "PropertiesChanged" signal.)
 //
 // * A stand-alone application SHOULD:
 //
@@ -110,11 +117,11 @@ static const int kMaxAsyncInitTimeoutMS = 30 * 1000;
 // Server data values
 //
 
-// The battery level ("battery/level") reported by the server (see Server.cpp)
-static uint8_t serverDataBatteryLevel = 78;
+// The initial battery level ("battery/level") reported by the server (see Server.cpp)
+static const uint8_t kInitialBatteryLevel = 78;
 
-// The text string ("text/string") used by our custom text string service (see Server.cpp)
-static std::string serverDataTextString = "Hello, world!";
+// The initial text string ("text/string") used by our custom text string service (see Server.cpp)
+static const char *kInitialTextString = "Hello, world!";
 
 //
 // Logging
@@ -163,78 +170,6 @@ void signalHandler(int signum)
 	}
 }
 
-//
-// Server data management
-//
-
-// Called by the server when it wants to retrieve a named value
-//
-// This method conforms to `GGKServerDataGetter` and is passed to the server via our call to `ggkStart()`.
-//
-// The server calls this method from its own thread, so we must ensure our implementation is thread-safe. In our case, we're simply
-// sending over stored values, so we don't need to take any additional steps to ensure thread-safety.
-const void *dataGetter(const char *pName)
-{
-	if (nullptr == pName)
-	{
-		LogError("NULL name sent to server data getter");
-		return nullptr;
-	}
-
-	std::string strName = pName;
-
-	if (strName == "battery/level")
-	{
-		return &serverDataBatteryLevel;
-	}
-	else if (strName == "text/string")
-	{
-		return serverDataTextString.c_str();
-	}
-
-	LogWarn((std::string("Unknown name for server data getter request: '") + pName + "'").c_str());
-	return nullptr;
-}
-
-// Called by the server when it wants to update a named value
-//
-// This method conforms to `GGKServerDataSetter` and is passed to the server via our call to `ggkStart()`.
-//
-// The server calls this method from its own thread, so we must ensure our implementation is thread-safe. In our case, we're simply
-// sending over stored values, so we don't need to take any additional steps to ensure thread-safety.
-int dataSetter(const char *pName, const void *pData)
-{
-	if (nullptr == pName)
-	{
-		LogError("NULL name sent to server data setter");
-		return 0;
-	}
-	if (nullptr == pData)
-	{
-		LogError("NULL pData sent to server data setter");
-		return 0;
-	}
-
-	std::string strName = pName;
-
-	if (strName == "battery/level")
-	{
-		serverDataBatteryLevel = *static_cast<const uint8_t *>(pData);
-		LogDebug((std::string("Server data: battery level set to ") + std::to_string(serverDataBatteryLevel)).c_str());
-		return 1;
-	}
-	else if (strName == "text/string")
-	{
-		serverDataTextString = static_cast<const char *>(pData);
-		LogDebug((std::string("Server data: text string set to '") + serverDataTextString + "'").c_str());
-		return 1;
-	}
-
-	LogWarn((std::string("Unknown name for server data setter request: '") + pName + "'").c_str());
-
-	return 0;
-}
-
 //
 // Entry point
 //
@@ -280,6 +215,12 @@ int main(int argc, char **ppArgv)
 	ggkLogRegisterAlways(LogAlways);
 	ggkLogRegisterTrace(LogTrace);
 
+	// Put our initial values in the server's data store
+	int batteryLevelKey = ggkDataStoreIntern("battery/level");
+	uint8_t batteryLevel = kInitialBatteryLevel;
+	ggkDataStoreSetValue(batteryLevelKey, &batteryLevel, sizeof(batteryLevel));
+	ggkDataStoreSetString(ggkDataStoreIntern("text/string"), kInitialTextString);
+
 	// Start the server's ascync processing
 	//
 	// This starts the server on a thread and begins the initialization process
@@ -289,20 +230,21 @@ int main(int argc, char **ppArgv)
 	//     This first parameter (the service name) must match tha name configured in the D-Bus permissions. See the Readme.md file
 	//     for more information.
 	//
-	if (!ggkStart("gobbledegook", "Gobbledegook", "Gobbledegook", dataGetter, dataSetter, kMaxAsyncInitTimeoutMS))
+	if (!ggkStart("gobbledegook", "Gobbledegook", "Gobbledegook", nullptr, nullptr, kMaxAsyncInitTimeoutMS))
 	{
 		return -1;
 	}
 
 	// Wait for the server to start the shutdown process
 	//
-	// While we wait, every 15 ticks, drop the battery level by one percent until we reach 0
+	// While we wait, every 15 ticks, drop the battery level by one percent until we reach 0. The battery level characteristic is
+	// bound to its data, so storing the new level is all it takes to notify subscribers.
 	while (ggkGetServerRunState() < EStopping)
 	{
 		std::this_thread::sleep_for(std::chrono::seconds(15));
 
-		serverDataBatteryLevel = std::max(serverDataBatteryLevel - 1, 0);
-		ggkNofifyUpdatedCharacteristic("/com/gobbledegook/battery/level");
+		batteryLevel = std::max(batteryLevel - 1, 0);
+		ggkDataStoreSetValue(batteryLevelKey, &batteryLevel, sizeof(batteryLevel));
 	}
 
 	// Wait for the server to come to a complete stop (CTRL-C from the command line)